@@ -0,0 +1,40 @@
+# zeitmachine application
+
+QT += core      \
+      gui       \
+      widgets
+
+TARGET = zeitmachine
+
+TEMPLATE = app
+
+VERSION = 0.6.2
+
+CONFIG += c++11
+
+include(../core/core.pri)
+
+HEADERS  += ../src/glvideowidget.h \
+            ../src/mainwindow.h \
+            ../src/settingsdialog.h \
+            ../src/exportqueuedialog.h \
+            ../src/version.h \
+            ../src/aboutdialog.h
+
+SOURCES +=  ../src/main.cpp \
+            ../src/glvideowidget.cpp \
+            ../src/mainwindow.cpp \
+            ../src/settingsdialog.cpp \
+            ../src/exportqueuedialog.cpp \
+            ../src/aboutdialog.cpp
+
+FORMS    += ../forms/mainwindow.ui \
+            ../forms/settingsdialog.ui \
+            ../forms/exportqueuedialog.ui \
+            ../forms/aboutdialog.ui
+
+RESOURCES = ../zeitmachine.qrc # menu icons and about image
+
+include(../win.pri)
+include(../mac.pri)
+include(../linux.pri)
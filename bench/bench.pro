@@ -0,0 +1,23 @@
+# zeitmachine engine benchmarks
+
+QT += core      \
+      gui
+
+TARGET = zeitbench
+
+TEMPLATE = app
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+include(../core/core.pri)
+include(../tools/zdgen/sequencegenerator.pri)
+
+HEADERS  += zeitbench.h
+
+SOURCES +=  main.cpp \
+            zeitbench.cpp
+
+include(../win.pri)
+include(../mac.pri)
+include(../linux.pri)
@@ -0,0 +1,81 @@
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QFile>
+#include <QJsonDocument>
+
+#include <cstdio>
+
+#include "zeitbench.h"
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication application(argc, argv);
+    application.setApplicationName("zeitbench");
+
+    QThread::currentThread()->setObjectName("Bench");
+    Tracer::Init();
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Benchmarks the zeitmachine engine's hot paths");
+    parser.addHelpOption();
+
+    QCommandLineOption iterations_option("iterations", "Timed iterations per benchmark.", "count", "20");
+    QCommandLineOption filter_option("filter", "Only run benchmarks matching this expression.", "regex", ".*");
+    QCommandLineOption output_option("output", "Write results as JSON to this file.", "file", "zeitbench.json");
+    QCommandLineOption baseline_option("baseline", "Compare results against this earlier JSON output.", "file");
+    QCommandLineOption threshold_option("threshold", "Allowed slowdown against the baseline in percent.", "percent", "10");
+
+    parser.addOption(iterations_option);
+    parser.addOption(filter_option);
+    parser.addOption(output_option);
+    parser.addOption(baseline_option);
+    parser.addOption(threshold_option);
+    parser.process(application);
+
+    ZeitBench bench(std::max(1, parser.value(iterations_option).toInt()),
+                    QRegularExpression(parser.value(filter_option)));
+
+    if(!bench.Run()) {
+        std::fprintf(stderr, "Could not write the benchmark fixtures\n");
+        return 2;
+    }
+
+    QJsonObject results = bench.Results();
+
+    QFile output(parser.value(output_option));
+
+    if(!output.open(QIODevice::WriteOnly | QIODevice::Truncate) ||
+       output.write(QJsonDocument(results).toJson()) < 0) {
+        std::fprintf(stderr, "Could not write %s\n", output.fileName().toUtf8().constData());
+        return 2;
+    }
+
+    // Wrong results fail the run, whatever the timings
+    const int failures = bench.Failures();
+
+    if(failures > 0) {
+        std::printf("\n%d check(s) failed\n", failures);
+    }
+
+    if(!parser.isSet(baseline_option)) {
+        return (failures > 0) ? 1 : 0;
+    }
+
+    QFile baseline(parser.value(baseline_option));
+
+    if(!baseline.open(QIODevice::ReadOnly)) {
+        std::fprintf(stderr, "Could not read %s\n", baseline.fileName().toUtf8().constData());
+        return 2;
+    }
+
+    int regressions = ZeitBench::Compare(results,
+                                         QJsonDocument::fromJson(baseline.readAll()).object(),
+                                         parser.value(threshold_option).toDouble() / 100.0,
+                                         QRegularExpression(parser.value(filter_option)));
+
+    if(regressions > 0) {
+        std::printf("\n%d benchmark(s) regressed or missing\n", regressions);
+    }
+
+    return (regressions > 0 || failures > 0) ? 1 : 0;
+}
@@ -0,0 +1,617 @@
+#include "zeitbench.h"
+
+#include <QElapsedTimer>
+#include <QVector>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <numeric>
+
+#include "version.h"
+
+/*!
+ * \brief Whether two frames have the same size, format and pixels
+ */
+static bool SameFrame(const AVFrame* a, const AVFrame* b)
+{
+    if(a->width != b->width || a->height != b->height || a->format != b->format) {
+        return false;
+    }
+
+    const AVPixelFormat format = (AVPixelFormat)a->format;
+    const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get(format);
+
+    for(int p = 0; p < av_pix_fmt_count_planes(format); p++) {
+        int shift = (p == 1 || p == 2) ? desc->log2_chroma_h : 0;
+        int rows = -((-a->height) >> shift);
+        int bytes = av_image_get_linesize(format, a->width, p);
+
+        for(int y = 0; y < rows; y++) {
+            if(memcmp(a->data[p] + y * a->linesize[p], b->data[p] + y * b->linesize[p], bytes) != 0) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+ZeitBench::ZeitBench(const int iterations, const QRegularExpression& filter)
+{
+    this->iterations = iterations;
+    this->filter = filter;
+
+    failures = 0;
+}
+
+ZeitEngine* ZeitBench::OpenEngine(const QFileInfoList& sequence)
+{
+    ZeitEngine* engine = new ZeitEngine(&display, DISPLAY_MAX_WIDTH, DISPLAY_MAX_HEIGHT);
+
+    engine->source_sequence = sequence;
+    engine->operation_mode = (sequence.first().suffix() == "zd") ? ZEIT_MODE_ZD : ZEIT_MODE_GENERAL;
+
+    if(!engine->InitDecoder() || !engine->DecodeFrame(0)) {
+        delete engine;
+        return NULL;
+    }
+
+    engine->InitDisplay(false);
+
+    return engine;
+}
+
+void ZeitBench::Measure(const QString& name, std::function<void(int)> body)
+{
+    if(!filter.match(name).hasMatch()) {
+        return;
+    }
+
+    for(int i = 0; i < WARMUP_ITERATIONS; i++) {
+        body(i);
+    }
+
+    QVector<double> timings;
+    QElapsedTimer timer;
+
+    for(int i = 0; i < iterations; i++) {
+        timer.start();
+        body(WARMUP_ITERATIONS + i);
+        timings.append(timer.nsecsElapsed() / 1e6);
+    }
+
+    std::sort(timings.begin(), timings.end());
+
+    BenchResult result;
+    result.name = name;
+    result.iterations = iterations;
+    result.min = timings.first();
+    result.median = (iterations % 2 == 1) ?
+                    timings[iterations / 2] :
+                    (timings[iterations / 2 - 1] + timings[iterations / 2]) / 2.0;
+    result.mean = std::accumulate(timings.begin(), timings.end(), 0.0) / iterations;
+
+    std::printf("%-40s %10.3f %10.3f %10.3f\n",
+                name.toUtf8().constData(), result.min, result.median, result.mean);
+    std::fflush(stdout);
+
+    results.append(result);
+}
+
+void ZeitBench::BenchSequence(const QString& label, const QFileInfoList& sequence)
+{
+    ZeitEngine* engine = OpenEngine(sequence);
+
+    if(engine == NULL) {
+        std::fprintf(stderr, "Could not open the %s fixture\n", label.toUtf8().constData());
+        failures++;
+        return;
+    }
+
+    const bool zd = (engine->operation_mode == ZEIT_MODE_ZD);
+    const int length = sequence.size();
+
+    try {
+        // Stages, one at a time on the first frame
+
+        Measure("decode_" + label, [&](int i) {
+            engine->DecodeFrame(i % length);
+        });
+
+        engine->DecodeFrame(0);
+        AVFrame* source = engine->decoder_frame;
+
+        if(zd) {
+            Measure("debayer_fast_" + label, [&](int) {
+                engine->DebayerFrame(engine->decoder_frame, true);
+            });
+
+            Measure("debayer_malvar_" + label, [&](int) {
+                engine->DebayerFrame(engine->decoder_frame, false);
+            });
+
+            Measure("debayer_deep_" + label, [&](int) {
+                engine->DeepDebayerFrame(engine->decoder_frame);
+            });
+
+            // A typical sensor's correction, so the fused stage is measured too
+            const ZdFormat plain = engine->zd_format;
+            const float gains[3] = {1.9f, 1.0f, 1.5f};
+            const float matrix[9] = {1.6f, -0.4f, -0.2f, -0.3f, 1.5f, -0.2f, 0.0f, -0.5f, 1.5f};
+
+            engine->zd_format.black_level = 256;
+            engine->zd_format.transfer = Debayer::TRANSFER_SRGB;
+            std::copy(gains, gains + 3, engine->zd_format.gains);
+            std::copy(matrix, matrix + 9, engine->zd_format.matrix);
+            engine->SelectDebayer();
+
+            Measure("debayer_colour_" + label, [&](int) {
+                engine->DebayerFrame(engine->decoder_frame, false);
+            });
+
+            engine->zd_format = plain;
+            engine->SelectDebayer();
+
+            engine->DebayerFrame(engine->decoder_frame, true);
+            source = engine->debayered_frame;
+        }
+
+        Measure("scale_display_" + label, [&](int) {
+            engine->ScaleFrame(source,
+                               engine->display_width,
+                               engine->display_height,
+                               ZeitEngine::DISPLAY_AV_PIXEL_FORMAT);
+        });
+
+        engine->ScaleFrame(source,
+                           engine->display_width,
+                           engine->display_height,
+                           ZeitEngine::DISPLAY_AV_PIXEL_FORMAT);
+
+        Measure("present_" + label, [&](int) {
+            engine->PresentFrame(engine->scaler_frame, true, true, false);
+        });
+
+        const struct {
+            ZeitFilter filter;
+            const char* name;
+        } filters[] = {
+            { ZEIT_FILTER_VIGNETTE, "vignette" },
+            { ZEIT_FILTER_BLACKWHITE, "blackwhite" },
+            { ZEIT_FILTER_SEPIA, "sepia" },
+            { ZEIT_FILTER_HIPSTAGRAM, "hipstagram" }
+        };
+
+        for(const auto& entry : filters) {
+            Measure(QString("filter_%1_").arg(entry.name) + label, [&](int) {
+                engine->FilterFrame(engine->scaler_frame, entry.filter);
+                engine->FreeFilterData();
+            });
+        }
+
+        engine->FreeFilter();
+
+        // Decode to display, bypassing the frame caches
+
+        Measure("display_end_to_end_" + label, [&](int i) {
+            engine->display_cache.Clear();
+            engine->proxy_cache.Clear();
+            engine->ShowFrame(i % length, ZEIT_FILTER_NONE, true, true, false);
+        });
+
+        // Export conversion at full resolution, in a single band and in
+        // bands on the pool; both have to give the very same picture
+
+        engine->DecodeFrame(0);
+        AVFrame* full = engine->decoder_frame;
+
+        if(zd) {
+            engine->DebayerFrame(engine->decoder_frame, false);
+            full = engine->debayered_frame;
+        }
+
+        const AVPixelFormat export_format = ZeitEngine::EXPORT_PIXELFORMAT;
+        const int export_flags = engine->ScalerFlags(ZEIT_SCALE_EXPORT, full->width, full->height, full->width, full->height);
+
+        SliceScaler single;
+        SliceScaler sliced;
+
+        uint8_t* single_data[4];
+        uint8_t* sliced_data[4];
+        int single_linesize[4];
+        int sliced_linesize[4];
+
+        if(single.Init(full->width, full->height, (AVPixelFormat)full->format, full->width, full->height, export_format, export_flags, &engine->band_pool, 1)
+           && sliced.Init(full->width, full->height, (AVPixelFormat)full->format, full->width, full->height, export_format, export_flags, &engine->band_pool)
+           && av_image_alloc(single_data, single_linesize, full->width, full->height, export_format, 32) >= 0) {
+
+            if(av_image_alloc(sliced_data, sliced_linesize, full->width, full->height, export_format, 32) >= 0) {
+                Measure("scale_export_single_" + label, [&](int) {
+                    single.Scale((const uint8_t * const*)full->data, full->linesize, single_data, single_linesize);
+                });
+
+                Measure(QString("scale_export_%1_slices_").arg(sliced.Slices()) + label, [&](int) {
+                    sliced.Scale((const uint8_t * const*)full->data, full->linesize, sliced_data, sliced_linesize);
+                });
+
+                single.Scale((const uint8_t * const*)full->data, full->linesize, single_data, single_linesize);
+                sliced.Scale((const uint8_t * const*)full->data, full->linesize, sliced_data, sliced_linesize);
+
+                const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get(export_format);
+                bool identical = true;
+
+                for(int p = 0; p < av_pix_fmt_count_planes(export_format); p++) {
+                    int shift = (p == 1 || p == 2) ? desc->log2_chroma_h : 0;
+                    int rows = -((-full->height) >> shift);
+                    int bytes = av_image_get_linesize(export_format, full->width, p);
+
+                    for(int y = 0; y < rows; y++) {
+                        if(memcmp(single_data[p] + y * single_linesize[p], sliced_data[p] + y * sliced_linesize[p], bytes) != 0) {
+                            identical = false;
+                        }
+                    }
+                }
+
+                if(!identical) {
+                    std::fprintf(stderr, "Sliced export conversion of the %s fixture differs from a single band\n", label.toUtf8().constData());
+                    failures++;
+                }
+
+                av_freep(&sliced_data[0]);
+            }
+
+            av_freep(&single_data[0]);
+        }
+
+        // Encoding, at full resolution as `Export()` does
+
+        engine->FreeScaler();
+        engine->DecodeFrame(0);
+        source = engine->decoder_frame;
+
+        if(zd) {
+            engine->DebayerFrame(engine->decoder_frame, false);
+            source = engine->debayered_frame;
+        }
+
+        engine->ScaleFrame(source, source->width, source->height, ZeitEngine::EXPORT_PIXELFORMAT);
+
+        QFileInfo encode_file(fixture_dir.filePath(label + "_encode.mp4"));
+        ExportRendition encode_rendition = { encode_file, 0, ZEIT_PROFILE_STANDARD };
+        ZeitEngine::ExportEncoder encoder(encode_rendition);
+        int64_t pts = 0;
+
+        Measure("encode_" + label, [&](int) {
+            engine->ExportFrame(&encoder, engine->scaler_frame, encode_file, pts++);
+        });
+
+        if(encoder.initialized) {
+            while(engine->ExportFrame(&encoder, NULL, encode_file, 0));
+            engine->CloseExport(&encoder);
+        }
+
+        // Renditions encode side by side, so three of them should take about
+        // as long as the largest one alone rather than all three in a row
+        const unsigned int rendition_heights[3] = {0, 720, 480};
+        QList<ZeitEngine::ExportEncoder*> one_rendition;
+        QList<ZeitEngine::ExportEncoder*> three_renditions;
+
+        for(int i = 0; i < 4; i++) {
+            QFileInfo rendition_file(fixture_dir.filePath(QString("%1_rendition_%2.mp4").arg(label).arg(i)));
+            ExportRendition rendition = { rendition_file, rendition_heights[std::max(0, i - 1)], ZEIT_PROFILE_STANDARD };
+            ZeitEngine::ExportEncoder* rendition_encoder = new ZeitEngine::ExportEncoder(rendition);
+
+            rendition_encoder->segment_file = rendition_file;
+            (i == 0 ? one_rendition : three_renditions).append(rendition_encoder);
+        }
+
+        // Both within the same budget, as a queued export would run them;
+        // encoders take their share of it when the first frame opens them
+        int64_t one_pts = 0;
+        int64_t three_pts = 0;
+
+        engine->BudgetThreads(one_rendition.size());
+
+        Measure("encode_renditions_1_" + label, [&](int) {
+            engine->EncodeRenditions(one_rendition, engine->scaler_frame, 0, one_pts++);
+        });
+
+        engine->BudgetThreads(three_renditions.size());
+
+        Measure("encode_renditions_3_" + label, [&](int) {
+            engine->EncodeRenditions(three_renditions, engine->scaler_frame, 0, three_pts++);
+        });
+
+        // The other benchmarks use the whole machine
+        engine->band_pool.setMaxThreadCount(QThread::idealThreadCount());
+        engine->rendition_encoder_threads = 0;
+
+        QList<ZeitEngine::ExportEncoder*> rendition_encoders = one_rendition + three_renditions;
+
+        for(int i = 0; i < rendition_encoders.size(); i++) {
+            ZeitEngine::ExportEncoder* rendition_encoder = rendition_encoders.at(i);
+
+            if(rendition_encoder->initialized) {
+                while(engine->ExportFrame(rendition_encoder, NULL, rendition_encoder->segment_file, 0));
+                engine->CloseExport(rendition_encoder);
+            }
+
+            engine->FreeRenditionScaler(rendition_encoder);
+            delete rendition_encoder;
+        }
+
+        QFileInfo end_to_end_file(fixture_dir.filePath(label + "_end_to_end.mp4"));
+        ExportRendition end_to_end_rendition = { end_to_end_file, 0, ZEIT_PROFILE_STANDARD };
+        ZeitEngine::ExportEncoder end_to_end_encoder(end_to_end_rendition);
+        pts = 0;
+
+        Measure("encode_end_to_end_" + label, [&](int i) {
+            engine->DecodeFrame(i % length);
+            AVFrame* frame = engine->decoder_frame;
+
+            if(zd) {
+                engine->DebayerFrame(frame, false);
+                frame = engine->debayered_frame;
+            }
+
+            engine->ScaleFrame(frame, frame->width, frame->height, ZeitEngine::EXPORT_PIXELFORMAT);
+            engine->ExportFrame(&end_to_end_encoder, engine->scaler_frame, end_to_end_file, pts++);
+        });
+
+        if(end_to_end_encoder.initialized) {
+            while(engine->ExportFrame(&end_to_end_encoder, NULL, end_to_end_file, 0));
+            engine->CloseExport(&end_to_end_encoder);
+        }
+    }
+    catch(...) {
+        std::fprintf(stderr, "Benchmarking the %s fixture failed\n", label.toUtf8().constData());
+        failures++;
+    }
+
+    delete engine;
+}
+
+void ZeitBench::CheckDescribed(const QFileInfoList& bare, const QFileInfoList& described)
+{
+    ZeitEngine* bare_engine = OpenEngine(bare);
+    ZeitEngine* described_engine = OpenEngine(described);
+
+    if(bare_engine == NULL || described_engine == NULL ||
+       described_engine->zd_format.header_size == 0 || !described_engine->zd_format.timestamp.isValid()) {
+        std::fprintf(stderr, "Could not open the described ZD fixture\n");
+        failures++;
+    } else {
+        Measure("decode_described_zd1944", [&](int i) {
+            described_engine->DecodeFrame(i % described.size());
+        });
+
+        for(int i = 0; i < bare.size(); i++) {
+            if(!bare_engine->DecodeFrame(i) ||
+               !described_engine->DecodeFrame(i) ||
+               !SameFrame(bare_engine->decoder_frame, described_engine->decoder_frame)) {
+                std::fprintf(stderr, "Frame %d of the described ZD fixture differs from the bare one\n", i);
+                failures++;
+            }
+        }
+    }
+
+    delete bare_engine;
+    delete described_engine;
+}
+
+void ZeitBench::CheckDebayer()
+{
+    // 327 leaves columns 320 to 326 to the scalar code, the crop is 321 wide
+    // and vectorises up to column 319, i.e. 325 of the frame
+    const int width = 327;
+    const int height = 130;
+    const int crop = 6;
+
+    const float gains[3] = {1.9f, 1.0f, 1.4f};
+    const float matrix[9] = { 1.6f, -0.4f, -0.2f,
+                             -0.3f,  1.5f, -0.2f,
+                              0.0f, -0.5f,  1.5f};
+
+    QThreadPool pool;
+    quint32 state = FIXTURE_SEED;
+
+    for(int pattern = ZEIT_BAYER_RGGB; pattern <= ZEIT_BAYER_BGGR; pattern++) {
+        for(int bits = Debayer::MIN_BITS; bits <= Debayer::MAX_BITS; bits += 2) {
+            const Debayer::Colour colours[2] = {
+                Debayer::Colour(),
+                Debayer::Colour(bits, 1 << (bits - 4), (1 << bits) - 1, gains, matrix, Debayer::TRANSFER_SRGB)
+            };
+
+            AVFrame* frames[2] = {av_frame_alloc(), av_frame_alloc()};
+
+            for(int f = 0; f < 2; f++) {
+                frames[f]->width = f ? width - crop : width;
+                frames[f]->height = height;
+                frames[f]->format = Debayer::SourceFormat((ZeitBayerPattern)pattern);
+                av_frame_get_buffer(frames[f], 32);
+            }
+
+            // Noise over the whole range, so clamping is exercised as well
+            for(int y = 0; y < height; y++) {
+                uint16_t* row = (uint16_t*)(frames[0]->data[0] + y * frames[0]->linesize[0]);
+
+                for(int x = 0; x < width; x++) {
+                    state = state * 1664525 + 1013904223;
+                    row[x] = (state >> 16) & ((1 << bits) - 1);
+                }
+
+                memcpy(frames[1]->data[0] + y * frames[1]->linesize[0], row + crop, (width - crop) * sizeof(uint16_t));
+            }
+
+            for(int output = Debayer::OUTPUT_RGB32; output <= Debayer::OUTPUT_PLANAR; output++) {
+                for(int colour = 0; colour < 2; colour++) {
+                    Debayer::Kernel kernel = Debayer::Select((ZeitBayerPattern)pattern, bits, Debayer::METHOD_MALVAR,
+                                                             (Debayer::Output)output, colour == 1);
+                    AVFrame* targets[2] = {av_frame_alloc(), av_frame_alloc()};
+                    bool same = (kernel != NULL);
+
+                    for(int f = 0; f < 2 && same; f++) {
+                        targets[f]->width = frames[f]->width;
+                        targets[f]->height = height;
+                        if(output == Debayer::OUTPUT_RGB32) {
+                            targets[f]->format = ZeitEngine::DEBAYER_PIXEL_FORMAT;
+                        } else {
+                            targets[f]->format = Debayer::PlanarFormat(bits);
+                        }
+
+                        av_frame_get_buffer(targets[f], 32);
+                        kernel(frames[f], targets[f], &colours[colour], &pool);
+                    }
+
+                    // Pixels whose filters reach past the crop's left or the frame's right border see different samples
+                    const int planes = (output == Debayer::OUTPUT_RGB32) ? 1 : 3;
+                    const int bytes = (output == Debayer::OUTPUT_RGB32) ? 4 : 2;
+
+                    for(int p = 0; p < planes && same; p++) {
+                        for(int y = 0; y < height && same; y++) {
+                            same = memcmp(targets[0]->data[p] + y * targets[0]->linesize[p] + (crop + 2) * bytes,
+                                          targets[1]->data[p] + y * targets[1]->linesize[p] + 2 * bytes,
+                                          (width - crop - 4) * bytes) == 0;
+                        }
+                    }
+
+                    if(!same) {
+                        std::fprintf(stderr, "Vectorised and scalar debayering differ for pattern %d, %d bit, %s output%s\n",
+                                     pattern, bits, (output == Debayer::OUTPUT_RGB32) ? "RGB32" : "planar",
+                                     colour ? " with correction" : "");
+                        failures++;
+                    }
+
+                    av_frame_free(&targets[0]);
+                    av_frame_free(&targets[1]);
+                }
+            }
+
+            av_frame_free(&frames[0]);
+            av_frame_free(&frames[1]);
+        }
+    }
+}
+
+bool ZeitBench::Run()
+{
+    if(!fixture_dir.isValid()) {
+        return false;
+    }
+
+    QDir directory(fixture_dir.path());
+
+    // Gradients and moving edges for the debayer and the scaler, noise so
+    // the JPEG decoder and the encoder don't get off too easy
+    SequenceGenerator generator(FIXTURE_SEED, ZEIT_PATTERN_GRADIENT |
+                                              ZEIT_PATTERN_EDGES |
+                                              ZEIT_PATTERN_NOISE);
+
+    QFileInfoList zd = generator.WriteSequence(directory, "zd", "zd", 0, FIXTURE_FRAMES);
+
+    // The same frames once more with a sidecar and headers, in a directory
+    // of their own as the sidecar describes all frames next to it
+    QDir described_directory(directory.filePath("described"));
+    QFileInfoList described;
+
+    if(described_directory.mkpath(".")) {
+        generator.SetDescribed(true);
+        described = generator.WriteSequence(described_directory, "zd", "zd", 0, FIXTURE_FRAMES);
+        generator.SetDescribed(false);
+    }
+
+    generator.SetSize(1920, 1080);
+    QFileInfoList hd = generator.WriteSequence(directory, "hd", "jpg", 0, FIXTURE_FRAMES);
+
+    generator.SetSize(4000, 3000);
+    QFileInfoList mp12 = generator.WriteSequence(directory, "mp12", "jpg", 0, FIXTURE_FRAMES);
+
+    if(zd.isEmpty() || described.isEmpty() || hd.isEmpty() || mp12.isEmpty()) {
+        return false;
+    }
+
+    results.clear();
+    failures = 0;
+
+    std::printf("%-40s %10s %10s %10s\n", "ms", "min", "median", "mean");
+
+    BenchSequence("zd1944", zd);
+    CheckDescribed(zd, described);
+    CheckDebayer();
+    BenchSequence("jpeg1080p", hd);
+    BenchSequence("jpeg12mp", mp12);
+
+    return true;
+}
+
+int ZeitBench::Failures() const
+{
+    return failures;
+}
+
+QJsonObject ZeitBench::Results() const
+{
+    QJsonObject benchmarks;
+
+    for(const BenchResult& result : results) {
+        QJsonObject entry;
+        entry["iterations"] = result.iterations;
+        entry["min_ms"] = result.min;
+        entry["median_ms"] = result.median;
+        entry["mean_ms"] = result.mean;
+
+        benchmarks[result.name] = entry;
+    }
+
+    QJsonObject root;
+    root["version"] = ZEITDICE_APPLICATION_VERSION;
+    root["benchmarks"] = benchmarks;
+
+    return root;
+}
+
+int ZeitBench::Compare(const QJsonObject& results, const QJsonObject& baseline, const double threshold, const QRegularExpression& filter)
+{
+    const QJsonObject current = results["benchmarks"].toObject();
+    const QJsonObject previous = baseline["benchmarks"].toObject();
+
+    int regressions = 0;
+
+    std::printf("\n%-40s %10s %10s %8s\n", "median ms", "baseline", "current", "change");
+
+    for(const QString& name : current.keys()) {
+        const double now = current[name].toObject()["median_ms"].toDouble();
+
+        if(!previous.contains(name)) {
+            std::printf("%-40s %10s %10.3f %8s\n", name.toUtf8().constData(), "-", now, "new");
+            continue;
+        }
+
+        const double before = previous[name].toObject()["median_ms"].toDouble();
+        const double change = (before > 0.0) ? now / before - 1.0 : 0.0;
+        const bool regressed = change > threshold;
+
+        if(regressed) {
+            regressions++;
+        }
+
+        std::printf("%-40s %10.3f %10.3f %+7.1f%%%s\n",
+                    name.toUtf8().constData(), before, now, change * 100.0,
+                    regressed ? "  REGRESSION" : "");
+    }
+
+    // Benchmarks that crashed or were skipped have no result at all
+    for(const QString& name : previous.keys()) {
+        if(current.contains(name) || !filter.match(name).hasMatch()) {
+            continue;
+        }
+
+        regressions++;
+
+        std::printf("%-40s %10.3f %10s %8s  MISSING\n",
+                    name.toUtf8().constData(), previous[name].toObject()["median_ms"].toDouble(), "-", "");
+    }
+
+    return regressions;
+}
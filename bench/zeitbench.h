@@ -0,0 +1,126 @@
+#ifndef ZEITBENCH_H
+#define ZEITBENCH_H
+
+/** \file
+ * ZeitBench header
+ * Declares the `ZeitBench` class, running microbenchmarks on the engine
+ */
+
+#include <QFileInfoList>
+#include <QJsonObject>
+#include <QList>
+#include <QRegularExpression>
+#include <QString>
+#include <QTemporaryDir>
+
+#include <functional>
+
+#include "sequencegenerator.h"
+#include "triplebuffer.h"
+#include "zeitengine.h"
+
+/*!
+ * \brief Timings of a single benchmark, in ms
+ */
+struct BenchResult {
+    QString name;
+    int iterations;
+    double min;
+    double median;
+    double mean;
+};
+
+/*!
+ * \brief Runs the engine's hot paths in isolation and end to end
+ *
+ * Generates its own fixtures (a 1944x1944 ZD sequence, bare and described,
+ * and HD and 12 MP JPEG sequences, see `SequenceGenerator`) in a temporary
+ * directory and drives the engine's stages directly, bypassing `Play()` and
+ * `Export()` and their pacing.
+ */
+class ZeitBench
+{
+    const static int FIXTURE_FRAMES = 4;
+    const static quint32 FIXTURE_SEED = 1;
+    const static int WARMUP_ITERATIONS = 2;
+
+    // The display size usually depends on the screen, pinned for comparable results
+    const static unsigned int DISPLAY_MAX_WIDTH = 1280;
+    const static unsigned int DISPLAY_MAX_HEIGHT = 1280;
+
+    QTemporaryDir fixture_dir;
+    TripleBuffer display;       //!< Frames are presented, but never read
+    int iterations;
+    QRegularExpression filter;
+
+    QList<BenchResult> results;
+    int failures;               //!< Checks of the last run whose results were wrong
+
+    /*!
+     * \brief Create an engine with a decoded first frame and initialized display
+     */
+    ZeitEngine* OpenEngine(const QFileInfoList& sequence);
+
+    /*!
+     * \brief Time a benchmark body, if its name passes the filter
+     * \param name Name of the benchmark
+     * \param body Called once per iteration with the iteration index
+     */
+    void Measure(const QString& name, std::function<void(int)> body);
+
+    void BenchSequence(const QString& label, const QFileInfoList& sequence);
+
+    /*!
+     * \brief Check that a sequence described by a sidecar and frame headers
+     *        decodes to the same samples as its bare frames
+     */
+    void CheckDescribed(const QFileInfoList& bare, const QFileInfoList& described);
+
+    /*!
+     * \brief Check that the vectorised and scalar Malvar kernels agree, for
+     *        every pattern, depth and output, with and without correction
+     *
+     * A frame whose width is odd and no multiple of 8 leaves its last columns
+     * to the scalar code; cropped by a few columns on the left, the same
+     * pixels fall into the vectorised columns instead. Without SSE2 both
+     * are scalar and the check passes trivially.
+     */
+    void CheckDebayer();
+
+public:
+    /*!
+     * \param iterations Timed iterations per benchmark
+     * \param filter Only run benchmarks whose name matches
+     */
+    ZeitBench(const int iterations, const QRegularExpression& filter);
+
+    /*!
+     * \brief Run all benchmarks
+     * \return false if the fixtures could not be written
+     */
+    bool Run();
+
+    /*!
+     * \brief Number of checks of the last run that failed, e.g. sliced
+     *        conversions that differ from a single band
+     */
+    int Failures() const;
+
+    /*!
+     * \brief Results of the last run as JSON
+     */
+    QJsonObject Results() const;
+
+    /*!
+     * \brief Compare results against a baseline
+     * \param results Results as returned by `Results()`
+     * \param baseline Earlier results in the same format
+     * \param threshold Allowed slowdown of the median, e.g. 0.1 for 10%
+     * \param filter Benchmarks of the baseline that were meant to run
+     * \return Number of benchmarks slower than the threshold allows or
+     *         missing from the results
+     */
+    static int Compare(const QJsonObject& results, const QJsonObject& baseline, const double threshold, const QRegularExpression& filter);
+};
+
+#endif // ZEITBENCH_H
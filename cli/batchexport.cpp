@@ -0,0 +1,115 @@
+#include "batchexport.h"
+
+#include <QJsonDocument>
+
+#include <cstdio>
+
+BatchExport::BatchExport(ZeitEngine* engine, QObject *parent) :
+    QObject(parent)
+{
+    this->engine = engine;
+    frames_encoded = 0;
+
+    connect(engine, &ZeitEngine::ProgressUpdated, this, &BatchExport::Progress);
+    connect(engine, &ZeitEngine::MessageUpdated, this, &BatchExport::Message);
+}
+
+void BatchExport::Print(const QJsonObject& line)
+{
+    std::printf("%s\n", QJsonDocument(line).toJson(QJsonDocument::Compact).constData());
+    std::fflush(stdout);
+}
+
+bool BatchExport::Run(const QFileInfoList& sequence,
+                      const QFileInfo& output,
+                      const QList<ExportRendition>& extra_renditions)
+{
+    run_timer.start();
+    frames_encoded = 0;
+
+    QJsonObject start;
+    start["event"] = "start";
+    engine->control_mutex.lock();
+    start["frames"] = ZeitEngine::ExportLength(sequence.size(),
+                                               engine->export_in_flag,
+                                               engine->export_out_flag,
+                                               engine->export_stride_flag);
+    engine->control_mutex.unlock();
+    start["output"] = output.absoluteFilePath();
+    Print(start);
+
+    if(!engine->Open(sequence)) {
+        QJsonObject error;
+        error["event"] = "error";
+        error["message"] = "Not a single frame of the sequence could be decoded";
+        Print(error);
+        return false;
+    }
+
+    engine->control_mutex.lock();
+    ExportRendition rendition = { output, 0, engine->profile_flag };
+    engine->control_mutex.unlock();
+
+    QList<ExportRendition> renditions = extra_renditions;
+    renditions.prepend(rendition);
+
+    bool exported = engine->ExportRenditions(renditions);
+
+    const double seconds = run_timer.elapsed() / 1000.0;
+
+    QJsonObject done;
+    done["event"] = exported ? "done" : "error";
+    done["frames"] = frames_encoded;
+    done["seconds"] = seconds;
+    done["fps"] = (seconds > 0.0) ? frames_encoded / seconds : 0.0;
+    done["output"] = output.absoluteFilePath();
+
+    if(exported) {
+        done["bytes"] = QFileInfo(output.absoluteFilePath()).size();
+    } else {
+        done["message"] = "Export failed";
+    }
+
+    Print(done);
+
+    return exported;
+}
+
+void BatchExport::Progress(const QString text, const int current, const int total)
+{
+    if(text == "Encoding complete") {
+        frames_encoded = current;
+        return;
+    }
+
+    if(text != "Encoding frames") {
+        return;
+    }
+
+    // Reported before each frame, so `current` frames are done by now
+    frames_encoded = current;
+
+    if(progress_timer.isValid() && progress_timer.elapsed() < PROGRESS_INTERVAL) {
+        return;
+    }
+
+    const double seconds = run_timer.elapsed() / 1000.0;
+
+    QJsonObject progress;
+    progress["event"] = "progress";
+    progress["frame"] = current;
+    progress["total"] = total;
+    progress["seconds"] = seconds;
+    progress["fps"] = (seconds > 0.0) ? current / seconds : 0.0;
+    Print(progress);
+
+    progress_timer.start();
+}
+
+void BatchExport::Message(const QString text)
+{
+    QJsonObject message;
+    message["event"] = "message";
+    message["text"] = text;
+    Print(message);
+}
@@ -0,0 +1,57 @@
+#ifndef BATCHEXPORT_H
+#define BATCHEXPORT_H
+
+/** \file
+ * BatchExport header
+ * Declares the `BatchExport` class, reporting a headless export
+ */
+
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QObject>
+#include <QString>
+
+#include "zeitengine.h"
+
+/*!
+ * \brief Runs an export without any display and reports it as JSON lines
+ *
+ * Every line on stdout is one JSON object with an "event" member: "start",
+ * "progress" (at most a few times a second), "message" and finally "done"
+ * or "error", so scripts can follow thousands of exports without parsing
+ * free text.
+ */
+class BatchExport : public QObject
+{
+    Q_OBJECT
+
+    const static int PROGRESS_INTERVAL = 250;   //!< Minimum ms between two progress lines
+
+    ZeitEngine* engine;
+
+    QElapsedTimer run_timer;
+    QElapsedTimer progress_timer;
+    int frames_encoded;
+
+    void Print(const QJsonObject& line);
+
+public:
+    explicit BatchExport(ZeitEngine* engine, QObject *parent = 0);
+
+    /*!
+     * \brief Export a sequence
+     * \param sequence The frames to export
+     * \param output The file to write
+     * \param extra_renditions Further videos to write in the same pass
+     * \return false if the sequence could not be opened or exporting failed
+     */
+    bool Run(const QFileInfoList& sequence,
+             const QFileInfo& output,
+             const QList<ExportRendition>& extra_renditions = QList<ExportRendition>());
+
+private slots:
+    void Progress(const QString text, const int current, const int total);
+    void Message(const QString text);
+};
+
+#endif // BATCHEXPORT_H
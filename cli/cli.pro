@@ -0,0 +1,22 @@
+# zeitmachine-cli, the headless batch exporter
+
+QT += core      \
+      gui
+
+TARGET = zeitmachine-cli
+
+TEMPLATE = app
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+include(../core/core.pri)
+
+HEADERS  += batchexport.h
+
+SOURCES +=  main.cpp \
+            batchexport.cpp
+
+include(../win.pri)
+include(../mac.pri)
+include(../linux.pri)
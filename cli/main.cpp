@@ -0,0 +1,256 @@
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QHash>
+
+#include <cmath>
+#include <cstdio>
+
+#include "batchexport.h"
+#include "triplebuffer.h"
+#include "tracer.h"
+#include "version.h"
+
+/*!
+ * \brief Exit codes, stable for scripts
+ */
+enum CliResult {
+    CLI_RESULT_SUCCESS = 0,
+    CLI_RESULT_USAGE = 1,           //!< Invalid arguments
+    CLI_RESULT_NO_FOOTAGE = 2,      //!< No supported footage in the input folder
+    CLI_RESULT_OUTPUT_EXISTS = 3,   //!< Output exists and --overwrite was not given
+    CLI_RESULT_EXPORT_FAILED = 4    //!< Decoding or encoding failed
+};
+
+static int Fail(const int code, const QString& message)
+{
+    std::fprintf(stderr, "%s\n", message.toUtf8().constData());
+    return code;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication application(argc, argv);
+    application.setApplicationName("zeitmachine-cli");
+    application.setApplicationVersion(ZEITDICE_APPLICATION_VERSION);
+
+    QThread::currentThread()->setObjectName("ZeitEngine");
+    Tracer::Init();
+
+    QHash<QString, ZeitRate> framerates;
+    framerates["23.976"] = ZEIT_RATE_23_976;
+    framerates["24"] = ZEIT_RATE_24p;
+    framerates["25"] = ZEIT_RATE_25p;
+    framerates["29.97"] = ZEIT_RATE_29_97;
+    framerates["30"] = ZEIT_RATE_30p;
+    framerates["48"] = ZEIT_RATE_48p;
+    framerates["50"] = ZEIT_RATE_50p;
+    framerates["60"] = ZEIT_RATE_60p;
+
+    QHash<QString, ZeitFilter> filters;
+    filters["none"] = ZEIT_FILTER_NONE;
+    filters["vignette"] = ZEIT_FILTER_VIGNETTE;
+    filters["blackwhite"] = ZEIT_FILTER_BLACKWHITE;
+    filters["sepia"] = ZEIT_FILTER_SEPIA;
+    filters["hipstagram"] = ZEIT_FILTER_HIPSTAGRAM;
+
+    QHash<QString, ZeitResolution> sizes;
+    sizes["source"] = ZEIT_RESOLUTION_SOURCE;
+    sizes["4k"] = ZEIT_RESOLUTION_2160p;
+    sizes["1080p"] = ZEIT_RESOLUTION_1080p;
+    sizes["720p"] = ZEIT_RESOLUTION_720p;
+
+    QHash<QString, ZeitProfile> profiles;
+    profiles["standard"] = ZEIT_PROFILE_STANDARD;
+    profiles["draft"] = ZEIT_PROFILE_DRAFT;
+    profiles["web"] = ZEIT_PROFILE_WEB;
+    profiles["archive"] = ZEIT_PROFILE_ARCHIVE;
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Exports a folder of .zd/.jpg/.png frames to a movie without a display.\n"
+                                     "Progress is printed as one JSON object per line.");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    parser.addPositionalArgument("folder", "Folder with the footage.");
+    parser.addPositionalArgument("output", "Movie file to write (.mp4, .mkv or .mov).");
+
+    QCommandLineOption framerate_option("framerate", "23.976, 24, 25, 29.97, 30, 48, 50 or 60.", "fps", "24");
+    QCommandLineOption filter_option("filter", "none, vignette, blackwhite, sepia or hipstagram.", "filter", "none");
+    QCommandLineOption profile_option("profile", "standard, draft, web or archive.", "profile", "standard");
+    QCommandLineOption flip_x_option("flip-x", "Mirror horizontally, relative to the application's default orientation.");
+    QCommandLineOption flip_y_option("flip-y", "Mirror vertically, relative to the application's default orientation.");
+    QCommandLineOption rotate_option("rotate-cw", "Rotate by 90 degrees clockwise.");
+    QCommandLineOption overwrite_option("overwrite", "Replace an existing output file.");
+    QCommandLineOption in_option("in", "First frame to export, counting from 1.", "frame", "1");
+    QCommandLineOption out_option("out", "Last frame to export, counting from 1 (default: the last frame).", "frame");
+    QCommandLineOption stride_option("stride", "Export only every n-th frame of the range.", "n", "1");
+    QCommandLineOption duration_option("duration", "Pick the stride so the video lasts about this long.", "seconds");
+    QCommandLineOption size_option("size", "source, 4k, 1080p, 720p or the height of the video in pixels.", "size", "source");
+    QCommandLineOption depth_option("depth", "8 or 10 bits per sample; 10 bit keeps the range of ZD footage, and needs .mkv or .mov unless x264 was built for 10 bit.", "bits", "8");
+    QCommandLineOption rendition_option("rendition", "Also write a downscaled video in the same pass, e.g. 1080:web:clip-1080p.mp4 (repeatable).", "height:profile:file");
+
+    parser.addOption(framerate_option);
+    parser.addOption(filter_option);
+    parser.addOption(profile_option);
+    parser.addOption(flip_x_option);
+    parser.addOption(flip_y_option);
+    parser.addOption(rotate_option);
+    parser.addOption(overwrite_option);
+    parser.addOption(in_option);
+    parser.addOption(out_option);
+    parser.addOption(stride_option);
+    parser.addOption(duration_option);
+    parser.addOption(size_option);
+    parser.addOption(depth_option);
+    parser.addOption(rendition_option);
+
+    if(!parser.parse(application.arguments())) {
+        return Fail(CLI_RESULT_USAGE, parser.errorText());
+    }
+
+    if(parser.isSet("help")) {
+        parser.showHelp(CLI_RESULT_SUCCESS);
+    }
+
+    if(parser.isSet("version")) {
+        parser.showVersion();
+    }
+
+    if(parser.positionalArguments().size() != 2) {
+        return Fail(CLI_RESULT_USAGE, "Expected a footage folder and an output file, see --help");
+    }
+
+    if(!framerates.contains(parser.value(framerate_option))) {
+        return Fail(CLI_RESULT_USAGE, "Unknown framerate " + parser.value(framerate_option));
+    }
+
+    if(!filters.contains(parser.value(filter_option))) {
+        return Fail(CLI_RESULT_USAGE, "Unknown filter " + parser.value(filter_option));
+    }
+
+    if(!profiles.contains(parser.value(profile_option))) {
+        return Fail(CLI_RESULT_USAGE, "Unknown profile " + parser.value(profile_option));
+    }
+
+    bool valid;
+
+    const int in_point = parser.value(in_option).toInt(&valid) - 1;
+    if(!valid || in_point < 0) {
+        return Fail(CLI_RESULT_USAGE, "Invalid first frame " + parser.value(in_option));
+    }
+
+    int out_point = -1;
+    if(parser.isSet(out_option)) {
+        out_point = parser.value(out_option).toInt(&valid) - 1;
+        if(!valid || out_point < in_point) {
+            return Fail(CLI_RESULT_USAGE, "Invalid last frame " + parser.value(out_option));
+        }
+    }
+
+    int stride = parser.value(stride_option).toInt(&valid);
+    if(!valid || stride < 1) {
+        return Fail(CLI_RESULT_USAGE, "Invalid stride " + parser.value(stride_option));
+    }
+
+    double duration = 0.0;
+    if(parser.isSet(duration_option)) {
+        if(parser.isSet(stride_option)) {
+            return Fail(CLI_RESULT_USAGE, "Pass either --stride or --duration");
+        }
+
+        duration = parser.value(duration_option).toDouble(&valid);
+        if(!valid || duration <= 0.0) {
+            return Fail(CLI_RESULT_USAGE, "Invalid duration " + parser.value(duration_option));
+        }
+    }
+
+    unsigned int height = ZEIT_RESOLUTION_SOURCE;
+    if(sizes.contains(parser.value(size_option))) {
+        height = sizes[parser.value(size_option)];
+    } else {
+        height = parser.value(size_option).toUInt(&valid);
+        if(!valid || height < 2) {
+            return Fail(CLI_RESULT_USAGE, "Invalid size " + parser.value(size_option));
+        }
+    }
+
+    ZeitDepth depth = ZEIT_DEPTH_8;
+    if(parser.value(depth_option) == "10") {
+        depth = ZEIT_DEPTH_10;
+    } else if(parser.value(depth_option) != "8") {
+        return Fail(CLI_RESULT_USAGE, "Invalid depth " + parser.value(depth_option));
+    }
+
+    QList<ExportRendition> renditions;
+    QStringList rendition_values = parser.values(rendition_option);
+
+    for(int i = 0; i < rendition_values.size(); i++) {
+        const QString value = rendition_values.at(i);
+        ExportRendition rendition;
+
+        // The file comes last, so it may contain colons itself
+        rendition.max_height = value.section(':', 0, 0).toUInt(&valid);
+        if(!valid || !profiles.contains(value.section(':', 1, 1)) || value.section(':', 2).isEmpty()) {
+            return Fail(CLI_RESULT_USAGE, "Invalid rendition " + value);
+        }
+
+        rendition.profile = profiles[value.section(':', 1, 1)];
+        rendition.file = QFileInfo(value.section(':', 2));
+        renditions.append(rendition);
+    }
+
+    QFileInfoList sequence = ZeitEngine::FindSequence(QDir(parser.positionalArguments().at(0)));
+
+    if(sequence.isEmpty()) {
+        return Fail(CLI_RESULT_NO_FOOTAGE, "No supported footage found in " + parser.positionalArguments().at(0));
+    }
+
+    if(in_point >= sequence.size()) {
+        return Fail(CLI_RESULT_USAGE, QString("The footage has only %1 frames").arg(sequence.size()));
+    }
+
+    if(duration > 0.0) {
+        // As many frames of the range as fit into the duration, evenly spread
+        const int range = ZeitEngine::ExportLength(sequence.size(), in_point, out_point, 1);
+        const double wanted = std::max(1.0, duration * parser.value(framerate_option).toDouble());
+
+        stride = std::max(1, (int)std::ceil(range / wanted));
+    }
+
+    QFileInfo output(parser.positionalArguments().at(1));
+
+    if(output.exists() && !parser.isSet(overwrite_option)) {
+        return Fail(CLI_RESULT_OUTPUT_EXISTS, output.absoluteFilePath() + " exists, pass --overwrite to replace it");
+    }
+
+    for(int i = 0; i < renditions.size(); i++) {
+        if(renditions.at(i).file.exists() && !parser.isSet(overwrite_option)) {
+            return Fail(CLI_RESULT_OUTPUT_EXISTS, renditions.at(i).file.absoluteFilePath() + " exists, pass --overwrite to replace it");
+        }
+    }
+
+    // Nothing is displayed, frames only ever land in here when previewing
+    TripleBuffer sink;
+    ZeitEngine engine(&sink, 1920, 1080);
+
+    engine.control_mutex.lock();
+    engine.configured_framerate = framerates[parser.value(framerate_option)];
+    engine.filter_flag = filters[parser.value(filter_option)];
+    engine.profile_flag = profiles[parser.value(profile_option)];
+    engine.flip_x_flag = !parser.isSet(flip_x_option);
+    engine.flip_y_flag = !parser.isSet(flip_y_option);
+    engine.rotate_90d_cw_flag = parser.isSet(rotate_option);
+    engine.export_in_flag = in_point;
+    engine.export_out_flag = out_point;
+    engine.export_stride_flag = stride;
+    engine.export_height_flag = height;
+    engine.export_depth_flag = depth;
+    engine.control_mutex.unlock();
+
+    BatchExport batch(&engine);
+
+    if(!batch.Run(sequence, output, renditions)) {
+        return CLI_RESULT_EXPORT_FAILED;
+    }
+
+    return CLI_RESULT_SUCCESS;
+}
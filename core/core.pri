@@ -0,0 +1,15 @@
+# Links zeitcore, include before the platform .pri files so the FFmpeg
+# libraries follow it on the linker command line
+
+INCLUDEPATH += $$PWD/../src
+DEPENDPATH += $$PWD/../src
+
+ZEITCORE_DIR = $$shadowed($$PWD)
+
+win32:CONFIG(release, debug|release): ZEITCORE_DIR = $$ZEITCORE_DIR/release
+else:win32:CONFIG(debug, debug|release): ZEITCORE_DIR = $$ZEITCORE_DIR/debug
+
+LIBS += -L$$ZEITCORE_DIR -lzeitcore
+
+win32-msvc*: PRE_TARGETDEPS += $$ZEITCORE_DIR/zeitcore.lib
+else: PRE_TARGETDEPS += $$ZEITCORE_DIR/libzeitcore.a
@@ -0,0 +1,37 @@
+# zeitcore, the GUI-free engine library
+
+QT = core      \
+     gui
+
+TARGET = zeitcore
+
+TEMPLATE = lib
+
+CONFIG += c++11 staticlib
+
+INCLUDEPATH += ../src
+
+HEADERS  += ../src/zeitengine.h \
+            ../src/framesink.h \
+            ../src/triplebuffer.h \
+            ../src/framecache.h \
+            ../src/pipelinestats.h \
+            ../src/tracer.h \
+            ../src/exportqueue.h \
+            ../src/slicescaler.h \
+            ../src/debayer.h \
+            ../src/zdformat.h
+
+SOURCES +=  ../src/zeitengine.cpp \
+            ../src/triplebuffer.cpp \
+            ../src/framecache.cpp \
+            ../src/pipelinestats.cpp \
+            ../src/tracer.cpp \
+            ../src/exportqueue.cpp \
+            ../src/slicescaler.cpp \
+            ../src/debayer.cpp \
+            ../src/zdformat.cpp
+
+include(../win.pri)
+include(../mac.pri)
+include(../linux.pri)
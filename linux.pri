@@ -1,11 +1,11 @@
 linux {
 
-    INCLUDEPATH +=  ../zeitmachine-qt/dependencies/installed/x264-snapshot-20170816-2245-stable/include \
-                    ../zeitmachine-qt/dependencies/installed/ffmpeg-3.3.3/include
+    INCLUDEPATH +=  $$PWD/dependencies/installed/x264-snapshot-20170816-2245-stable/include \
+                    $$PWD/dependencies/installed/ffmpeg-3.3.3/include
 
     QMAKE_LIBDIR += /usr/lib/nvidia-384 \
-                    ../zeitmachine-qt/dependencies/installed/x264-snapshot-20170816-2245-stable/lib \
-                    ../zeitmachine-qt/dependencies/installed/ffmpeg-3.3.3/lib
+                    $$PWD/dependencies/installed/x264-snapshot-20170816-2245-stable/lib \
+                    $$PWD/dependencies/installed/ffmpeg-3.3.3/lib
 
     LIBS += -lavfilter      \
             -lavformat      \
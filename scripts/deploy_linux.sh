@@ -12,7 +12,7 @@ HOME_DIR="$ZEITDICE_DIR"
 BUILDS_DIR="$PROJECT_DIR/builds"
 BUILD_COPY_DIR="zeitmachine-linux-$1"
 BUILD_ZIP="$BUILDS_DIR/zeitmachine-linux-$1.zip"
-BUILD_DIR="$ZEITDICE_DIR/build-zeitmachine-Desktop_Qt_5_9_2_GCC_64bit-Release/"
+BUILD_DIR="$ZEITDICE_DIR/build-zeitmachine-Desktop_Qt_5_9_2_GCC_64bit-Release/app/"
 QT_LIB_DIR="$HOME_DIR/Qt/5.9.2/gcc_64/lib"
 FFMPEG_LIB_DIR="$PROJECT_DIR/dependencies/installed/ffmpeg-3.3.3/lib"
 X264_LIB_DIR="$PROJECT_DIR/dependencies/installed/x264-snapshot-20170816-2245-stable/lib"
@@ -12,7 +12,7 @@ HOME_DIR="$ZEITDICE_DIR/.."
 ASSETS_DIR="$PROJECT_DIR/assets"
 BUILDS_DIR="$PROJECT_DIR/builds"
 BUILD_ZIP="$BUILDS_DIR/zeitmachine-macos-$1.zip"
-BUILD_DIR="$ZEITDICE_DIR/build-zeitmachine-Desktop_Qt_5_9_1_clang_64bit-Release"
+BUILD_DIR="$ZEITDICE_DIR/build-zeitmachine-Desktop_Qt_5_9_1_clang_64bit-Release/app"
 QT_REDIST_BIN_DIR="$HOME_DIR/Qt/5.9.1/clang_64/bin"
 
 # Deploy with macdeployqt
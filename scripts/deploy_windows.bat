@@ -3,7 +3,7 @@
 SETLOCAL
 SET "PROJECT_DIR=%~dp0.."
 SET "ZEITDICE_DIR=%PROJECT_DIR%\.."
-SET "BUILD_DIR=%ZEITDICE_DIR%\build-zeitmachine-Desktop-Release\release"
+SET "BUILD_DIR=%ZEITDICE_DIR%\build-zeitmachine-Desktop-Release\app\release"
 SET "FFMPEG_LIB_DIR=%PROJECT_DIR%\dependencies\ffmpeg-3.3.3-win64-shared\bin"
 SET "VC_REDIST_DIR=C:\Program Files (x86)\Microsoft Visual Studio\2017\Community\VC\Redist\MSVC\14.11.25325\x64\Microsoft.VC141.CRT"
 SET "VC_UCRT_REDIST_DIR=C:\Program Files (x86)\Windows Kits\10\Redist\ucrt\DLLs\x64"
@@ -0,0 +1,602 @@
+#include "debayer.h"
+
+#include <QRunnable>
+#include <QSemaphore>
+#include <QThreadPool>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/*!
+ * \brief Demosaics one band of a frame on the pool
+ */
+class DebayerTask : public QRunnable
+{
+    const AVFrame* source;
+    AVFrame* target;
+    const Debayer::Colour* colour;
+    Debayer::Band band;
+    int first;
+    int end;
+    QSemaphore* done;
+
+public:
+    DebayerTask(const AVFrame* source,
+                AVFrame* target,
+                const Debayer::Colour* colour,
+                const Debayer::Band band,
+                const int first,
+                const int end,
+                QSemaphore* done)
+    {
+        this->source = source;
+        this->target = target;
+        this->colour = colour;
+        this->band = band;
+        this->first = first;
+        this->end = end;
+        this->done = done;
+    }
+
+    void run()
+    {
+        band(source, target, colour, first, end);
+        done->release();
+    }
+};
+
+// The Malvar filters, scaled by 16 so all weights are whole (Malvar, He and
+// Cutler give them in eighths). Each interpolates one channel at the sites of
+// another; which one depends on the site:
+//
+//   at R sites:                G from cross, B from diagonal
+//   at B sites:                G from cross, R from diagonal
+//   at G sites of red rows:    R from horizontal, B from vertical
+//   at G sites of blue rows:   B from horizontal, R from vertical
+
+static inline int Scaled(const int sum, const int max_value)
+{
+    return std::min(std::max((sum + 8) >> 4, 0), max_value);
+}
+
+template<bool RED_ROW, int RED_X>
+static inline void MalvarPixel(const uint16_t* const rows[5],
+                               const int x,
+                               const int max_value,
+                               int* red,
+                               int* green,
+                               int* blue)
+{
+    const int c = rows[2][x];
+    const int ns = rows[1][x] + rows[3][x];
+    const int we = rows[2][x - 1] + rows[2][x + 1];
+    const int far_ns = rows[0][x] + rows[4][x];
+    const int far_we = rows[2][x - 2] + rows[2][x + 2];
+    const int diagonal = rows[1][x - 1] + rows[1][x + 1] + rows[3][x - 1] + rows[3][x + 1];
+
+    const int cross_value = Scaled(8 * c + 4 * (ns + we) - 2 * (far_ns + far_we), max_value);
+    const int horizontal_value = Scaled(10 * c + 8 * we - 2 * far_we - 2 * diagonal + far_ns, max_value);
+    const int vertical_value = Scaled(10 * c + 8 * ns - 2 * far_ns - 2 * diagonal + far_we, max_value);
+    const int diagonal_value = Scaled(12 * c + 4 * diagonal - 3 * (far_ns + far_we), max_value);
+
+    // Red and blue rows have red and green sites in the same columns
+    const bool red_column = ((x & 1) == RED_X);
+
+    if(RED_ROW) {
+        *red = red_column ? c : horizontal_value;
+        *green = red_column ? cross_value : c;
+        *blue = red_column ? diagonal_value : vertical_value;
+    } else {
+        *red = red_column ? vertical_value : diagonal_value;
+        *green = red_column ? c : cross_value;
+        *blue = red_column ? horizontal_value : c;
+    }
+}
+
+/*!
+ * \brief Correct a pixel's colour, through the folded matrix and the transfer LUT
+ */
+static inline void CorrectPixel(const Debayer::Colour* colour, int* red, int* green, int* blue)
+{
+    const float* m = colour->matrix;
+    const float r = *red;
+    const float g = *green;
+    const float b = *blue;
+
+    int* values[3] = {red, green, blue};
+
+    for(int o = 0; o < 3; o++) {
+        const float index = (r * m[3 * o] + g * m[3 * o + 1]) + (b * m[3 * o + 2] + colour->offset[o]);
+        *values[o] = colour->lut[(int)(std::min(std::max(index, 0.0f), (float)(Debayer::LUT_SIZE - 1)) + 0.5f)];
+    }
+}
+
+#ifdef __SSE2__
+static inline __m128i Load4(const uint16_t* samples)
+{
+    return _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i*)samples), _mm_setzero_si128());
+}
+
+static inline __m128i Shift4(const __m128i sum)
+{
+    return _mm_srai_epi32(_mm_add_epi32(sum, _mm_set1_epi32(8)), 4);
+}
+
+/*!
+ * \brief The four filters for 4 pixels, in 32 bit lanes, before clamping
+ */
+static inline void MalvarFilters4(const uint16_t* const rows[5],
+                                  const int x,
+                                  __m128i* cross_value,
+                                  __m128i* horizontal_value,
+                                  __m128i* vertical_value,
+                                  __m128i* diagonal_value)
+{
+    const __m128i c = Load4(rows[2] + x);
+    const __m128i ns = _mm_add_epi32(Load4(rows[1] + x), Load4(rows[3] + x));
+    const __m128i we = _mm_add_epi32(Load4(rows[2] + x - 1), Load4(rows[2] + x + 1));
+    const __m128i far_ns = _mm_add_epi32(Load4(rows[0] + x), Load4(rows[4] + x));
+    const __m128i far_we = _mm_add_epi32(Load4(rows[2] + x - 2), Load4(rows[2] + x + 2));
+    const __m128i diagonal = _mm_add_epi32(_mm_add_epi32(Load4(rows[1] + x - 1), Load4(rows[1] + x + 1)),
+                                           _mm_add_epi32(Load4(rows[3] + x - 1), Load4(rows[3] + x + 1)));
+
+    const __m128i far = _mm_add_epi32(far_ns, far_we);
+    const __m128i c2 = _mm_slli_epi32(c, 1);
+    const __m128i c8 = _mm_slli_epi32(c, 3);
+    const __m128i c10 = _mm_add_epi32(c8, c2);
+    const __m128i diagonal2 = _mm_slli_epi32(diagonal, 1);
+
+    // 8c + 4 (ns + we) - 2 far
+    *cross_value = Shift4(_mm_sub_epi32(_mm_add_epi32(c8, _mm_slli_epi32(_mm_add_epi32(ns, we), 2)),
+                                        _mm_slli_epi32(far, 1)));
+
+    // 10c + 8 we - 2 far_we - 2 diagonal + far_ns
+    *horizontal_value = Shift4(_mm_sub_epi32(_mm_add_epi32(_mm_add_epi32(c10, _mm_slli_epi32(we, 3)), far_ns),
+                                             _mm_add_epi32(_mm_slli_epi32(far_we, 1), diagonal2)));
+
+    // 10c + 8 ns - 2 far_ns - 2 diagonal + far_we
+    *vertical_value = Shift4(_mm_sub_epi32(_mm_add_epi32(_mm_add_epi32(c10, _mm_slli_epi32(ns, 3)), far_we),
+                                           _mm_add_epi32(_mm_slli_epi32(far_ns, 1), diagonal2)));
+
+    // 12c + 4 diagonal - 3 far
+    *diagonal_value = Shift4(_mm_sub_epi32(_mm_add_epi32(_mm_add_epi32(c8, _mm_slli_epi32(c, 2)), _mm_slli_epi32(diagonal, 2)),
+                                           _mm_add_epi32(_mm_slli_epi32(far, 1), far)));
+}
+
+/*!
+ * \brief Two halves of 4 pixels as 8 clamped 16 bit lanes
+ */
+template<int BITS>
+static inline __m128i Clamp8(__m128i low, __m128i high)
+{
+    const int max_value = (1 << BITS) - 1;
+
+    if(BITS <= 14) {
+        // Filtered values of up to 14 bit samples stay within int16 before clamping
+        return _mm_min_epi16(_mm_max_epi16(_mm_packs_epi32(low, high), _mm_setzero_si128()), _mm_set1_epi16(max_value));
+    }
+
+    // Clamped in 32 bit, then packed around a bias, as SSE2 only packs signed
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i max = _mm_set1_epi32(max_value);
+    const __m128i bias = _mm_set1_epi32(32768);
+
+    low = _mm_and_si128(low, _mm_cmpgt_epi32(low, zero));
+    high = _mm_and_si128(high, _mm_cmpgt_epi32(high, zero));
+
+    const __m128i low_over = _mm_cmpgt_epi32(low, max);
+    const __m128i high_over = _mm_cmpgt_epi32(high, max);
+
+    low = _mm_or_si128(_mm_and_si128(low_over, max), _mm_andnot_si128(low_over, low));
+    high = _mm_or_si128(_mm_and_si128(high_over, max), _mm_andnot_si128(high_over, high));
+
+    return _mm_xor_si128(_mm_packs_epi32(_mm_sub_epi32(low, bias), _mm_sub_epi32(high, bias)),
+                         _mm_set1_epi16((short)0x8000));
+}
+
+static inline __m128i Blend(const __m128i mask, const __m128i at_mask, const __m128i elsewhere)
+{
+    return _mm_or_si128(_mm_and_si128(mask, at_mask), _mm_andnot_si128(mask, elsewhere));
+}
+
+/*!
+ * \brief Correct the colour of 8 pixels
+ * \param coefficients The folded matrix, then the offsets, each broadcast
+ */
+static inline void Correct8(const __m128 coefficients[12], const uint16_t* lut, __m128i* red, __m128i* green, __m128i* blue)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128 limit = _mm_set1_ps(Debayer::LUT_SIZE - 1);
+    const __m128 half_step = _mm_set1_ps(0.5f);
+
+    __m128i indices[3][2];
+
+    for(int half = 0; half < 2; half++) {
+        const __m128 r = _mm_cvtepi32_ps(half ? _mm_unpackhi_epi16(*red, zero) : _mm_unpacklo_epi16(*red, zero));
+        const __m128 g = _mm_cvtepi32_ps(half ? _mm_unpackhi_epi16(*green, zero) : _mm_unpacklo_epi16(*green, zero));
+        const __m128 b = _mm_cvtepi32_ps(half ? _mm_unpackhi_epi16(*blue, zero) : _mm_unpacklo_epi16(*blue, zero));
+
+        for(int o = 0; o < 3; o++) {
+            const __m128 index = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r, coefficients[3 * o]), _mm_mul_ps(g, coefficients[3 * o + 1])),
+                                            _mm_add_ps(_mm_mul_ps(b, coefficients[3 * o + 2]), coefficients[9 + o]));
+
+            // Rounds half up by truncation like `CorrectPixel()`, rather than to even
+            indices[o][half] = _mm_cvttps_epi32(_mm_add_ps(_mm_min_ps(_mm_max_ps(index, _mm_setzero_ps()), limit), half_step));
+        }
+    }
+
+    __m128i* channels[3] = {red, green, blue};
+
+    // SSE2 has no gather, the LUT is read one value at a time; extracting and
+    // inserting lanes avoids the stall of reloading values just stored
+    for(int o = 0; o < 3; o++) {
+        const __m128i packed = _mm_packs_epi32(indices[o][0], indices[o][1]);
+
+        *channels[o] = _mm_set_epi16(lut[_mm_extract_epi16(packed, 7)],
+                                     lut[_mm_extract_epi16(packed, 6)],
+                                     lut[_mm_extract_epi16(packed, 5)],
+                                     lut[_mm_extract_epi16(packed, 4)],
+                                     lut[_mm_extract_epi16(packed, 3)],
+                                     lut[_mm_extract_epi16(packed, 2)],
+                                     lut[_mm_extract_epi16(packed, 1)],
+                                     lut[_mm_extract_epi16(packed, 0)]);
+    }
+}
+#endif
+
+template<int BITS, int OUTPUT>
+static inline void StorePixel(AVFrame* target, const int y, const int x, const int red, const int green, const int blue)
+{
+    if(OUTPUT == Debayer::OUTPUT_RGB32) {
+        uint32_t* packed = (uint32_t*)(target->data[0] + y * target->linesize[0]);
+        packed[x] = 0xff000000u | ((red >> (BITS - 8)) << 16) | ((green >> (BITS - 8)) << 8) | (blue >> (BITS - 8));
+    } else {
+        // GBRP keeps green, blue and red in planes 0, 1 and 2
+        ((uint16_t*)(target->data[0] + y * target->linesize[0]))[x] = green;
+        ((uint16_t*)(target->data[1] + y * target->linesize[1]))[x] = blue;
+        ((uint16_t*)(target->data[2] + y * target->linesize[2]))[x] = red;
+    }
+}
+
+template<int PATTERN, int BITS, int OUTPUT, bool COLOUR, bool RED_ROW>
+void Debayer::MalvarRow(const uint16_t* const rows[5], const int width, const Colour* colour, AVFrame* target, const int y)
+{
+    const int RED_X = PATTERN % 2;
+    const int max_value = (1 << BITS) - 1;
+
+    int x = 0;
+
+#ifdef __SSE2__
+    uint32_t* packed = (uint32_t*)(target->data[0] + y * target->linesize[0]);
+    uint16_t* green_plane = (uint16_t*)(target->data[0] + y * target->linesize[0]);
+    uint16_t* blue_plane = (uint16_t*)(target->data[1] + y * target->linesize[1]);
+    uint16_t* red_plane = (uint16_t*)(target->data[2] + y * target->linesize[2]);
+
+    // Lanes 0, 2, 4 and 6 hold even columns, as x stays even
+    const __m128i even = _mm_set_epi16(0, -1, 0, -1, 0, -1, 0, -1);
+    const __m128i red_columns = (RED_X == 0) ? even : _mm_xor_si128(even, _mm_set1_epi16(-1));
+
+    __m128 coefficients[12];
+    const uint16_t* lut = NULL;
+
+    if(COLOUR) {
+        for(int i = 0; i < 9; i++) {
+            coefficients[i] = _mm_set1_ps(colour->matrix[i]);
+        }
+
+        for(int i = 0; i < 3; i++) {
+            coefficients[9 + i] = _mm_set1_ps(colour->offset[i]);
+        }
+
+        lut = &colour->lut[0];
+    }
+
+    for(; x + 8 <= width; x += 8) {
+        __m128i cross_low, horizontal_low, vertical_low, diagonal_low;
+        __m128i cross_high, horizontal_high, vertical_high, diagonal_high;
+
+        MalvarFilters4(rows, x, &cross_low, &horizontal_low, &vertical_low, &diagonal_low);
+        MalvarFilters4(rows, x + 4, &cross_high, &horizontal_high, &vertical_high, &diagonal_high);
+
+        const __m128i c = _mm_loadu_si128((const __m128i*)(rows[2] + x));
+        const __m128i cross_value = Clamp8<BITS>(cross_low, cross_high);
+        const __m128i horizontal_value = Clamp8<BITS>(horizontal_low, horizontal_high);
+        const __m128i vertical_value = Clamp8<BITS>(vertical_low, vertical_high);
+        const __m128i diagonal_value = Clamp8<BITS>(diagonal_low, diagonal_high);
+
+        __m128i red, green, blue;
+
+        if(RED_ROW) {
+            red = Blend(red_columns, c, horizontal_value);
+            green = Blend(red_columns, cross_value, c);
+            blue = Blend(red_columns, diagonal_value, vertical_value);
+        } else {
+            red = Blend(red_columns, vertical_value, diagonal_value);
+            green = Blend(red_columns, c, cross_value);
+            blue = Blend(red_columns, horizontal_value, c);
+        }
+
+        if(COLOUR) {
+            Correct8(coefficients, lut, &red, &green, &blue);
+        }
+
+        if(OUTPUT == OUTPUT_RGB32) {
+            // Down to 8 bit, then bytes B G R A in memory
+            const __m128i blue_green = _mm_or_si128(_mm_srli_epi16(blue, BITS - 8), _mm_slli_epi16(_mm_srli_epi16(green, BITS - 8), 8));
+            const __m128i red_alpha = _mm_or_si128(_mm_srli_epi16(red, BITS - 8), _mm_set1_epi16((short)0xff00));
+
+            _mm_storeu_si128((__m128i*)(packed + x), _mm_unpacklo_epi16(blue_green, red_alpha));
+            _mm_storeu_si128((__m128i*)(packed + x + 4), _mm_unpackhi_epi16(blue_green, red_alpha));
+        } else {
+            _mm_storeu_si128((__m128i*)(green_plane + x), green);
+            _mm_storeu_si128((__m128i*)(blue_plane + x), blue);
+            _mm_storeu_si128((__m128i*)(red_plane + x), red);
+        }
+    }
+#endif
+
+    for(; x < width; x++) {
+        int red, green, blue;
+
+        MalvarPixel<RED_ROW, RED_X>(rows, x, max_value, &red, &green, &blue);
+
+        if(COLOUR) {
+            CorrectPixel(colour, &red, &green, &blue);
+        }
+
+        StorePixel<BITS, OUTPUT>(target, y, x, red, green, blue);
+    }
+}
+
+template<int PATTERN, int BITS, int OUTPUT, bool COLOUR>
+void Debayer::MalvarRows(const AVFrame* source, AVFrame* target, const Colour* colour, const int first, const int end)
+{
+    const int RED_Y = PATTERN / 2;
+
+    const int width = source->width;
+    const int height = source->height;
+    const int stride = width + 2 * PAD;
+
+    std::vector<uint16_t> padded((CHUNK_ROWS + 2 * PAD) * stride);
+
+    for(int chunk = first; chunk < end; chunk += CHUNK_ROWS) {
+        const int chunk_end = std::min(chunk + (int)CHUNK_ROWS, end);
+
+        // Mirroring around the first and last sample (-1 is 1, -2 is 2)
+        // keeps the colour of every padded site; tiny frames just clamp
+        for(int r = chunk - PAD; r < chunk_end + PAD; r++) {
+            int source_y = (r < 0) ? -r : ((r >= height) ? 2 * height - 2 - r : r);
+            source_y = std::min(std::max(source_y, 0), height - 1);
+
+            const uint16_t* source_row = (const uint16_t*)(source->data[0] + source_y * source->linesize[0]);
+            uint16_t* padded_row = &padded[(r - chunk + PAD) * stride] + PAD;
+
+            std::copy(source_row, source_row + width, padded_row);
+
+            for(int p = 1; p <= PAD; p++) {
+                padded_row[-p] = source_row[std::min(p, width - 1)];
+                padded_row[width - 1 + p] = source_row[std::max(width - 1 - p, 0)];
+            }
+        }
+
+        for(int y = chunk; y < chunk_end; y++) {
+            const uint16_t* rows[5];
+
+            for(int i = 0; i < 5; i++) {
+                rows[i] = &padded[(y - chunk + i) * stride] + PAD;
+            }
+
+            if(y % 2 == RED_Y) {
+                MalvarRow<PATTERN, BITS, OUTPUT, COLOUR, true>(rows, width, colour, target, y);
+            } else {
+                MalvarRow<PATTERN, BITS, OUTPUT, COLOUR, false>(rows, width, colour, target, y);
+            }
+        }
+    }
+}
+
+template<int PATTERN, int BITS, int OUTPUT, bool COLOUR>
+void Debayer::Malvar(const AVFrame* source, AVFrame* target, const Colour* colour, QThreadPool* pool)
+{
+    Run(source, target, colour, pool, &MalvarRows<PATTERN, BITS, OUTPUT, COLOUR>);
+}
+
+template<int PATTERN, int BITS, int OUTPUT, bool COLOUR>
+void Debayer::NearestRows(const AVFrame* source, AVFrame* target, const Colour* colour, const int first, const int end)
+{
+    const int RED_Y = PATTERN / 2;
+    const int RED_X = PATTERN % 2;
+
+    const int width = source->width;
+    const int height = source->height;
+
+    // Every 2x2 block holds one red, one blue and two green samples; all four
+    // pixels take red and blue from it, and green from themselves or the
+    // green sample next to them in the same row
+    for(int y = first; y < end && y + 1 < height; y += 2) {
+        const uint16_t* block[2] = {
+            (const uint16_t*)(source->data[0] + y * source->linesize[0]),
+            (const uint16_t*)(source->data[0] + (y + 1) * source->linesize[0])
+        };
+
+        for(int x = 0; x + 1 < width; x += 2) {
+            // The greens sit where the row is red's and the column isn't, and vice versa
+            int red_row[3] = {block[RED_Y][x + RED_X], block[RED_Y][x + 1 - RED_X], block[1 - RED_Y][x + 1 - RED_X]};
+            int blue_row[3] = {red_row[0], block[1 - RED_Y][x + RED_X], red_row[2]};
+
+            if(COLOUR) {
+                CorrectPixel(colour, &red_row[0], &red_row[1], &red_row[2]);
+                CorrectPixel(colour, &blue_row[0], &blue_row[1], &blue_row[2]);
+            }
+
+            StorePixel<BITS, OUTPUT>(target, y + RED_Y, x + RED_X, red_row[0], red_row[1], red_row[2]);
+            StorePixel<BITS, OUTPUT>(target, y + RED_Y, x + 1 - RED_X, red_row[0], red_row[1], red_row[2]);
+            StorePixel<BITS, OUTPUT>(target, y + 1 - RED_Y, x + RED_X, blue_row[0], blue_row[1], blue_row[2]);
+            StorePixel<BITS, OUTPUT>(target, y + 1 - RED_Y, x + 1 - RED_X, blue_row[0], blue_row[1], blue_row[2]);
+        }
+    }
+
+    // Odd sizes repeat the last whole column or row
+    const int planes = (OUTPUT == OUTPUT_RGB32) ? 1 : 3;
+    const int bytes = (OUTPUT == OUTPUT_RGB32) ? 4 : 2;
+
+    if(width % 2 == 1 && width > 1) {
+        for(int y = first; y < std::min(end, height - height % 2); y++) {
+            for(int p = 0; p < planes; p++) {
+                uint8_t* row = target->data[p] + y * target->linesize[p];
+                std::copy(row + (width - 2) * bytes, row + (width - 1) * bytes, row + (width - 1) * bytes);
+            }
+        }
+    }
+
+    if(height % 2 == 1 && height > 1 && end == height) {
+        for(int p = 0; p < planes; p++) {
+            const uint8_t* above = target->data[p] + (height - 2) * target->linesize[p];
+            std::copy(above, above + width * bytes, target->data[p] + (height - 1) * target->linesize[p]);
+        }
+    }
+}
+
+template<int PATTERN, int BITS, int OUTPUT, bool COLOUR>
+void Debayer::Nearest(const AVFrame* source, AVFrame* target, const Colour* colour, QThreadPool* pool)
+{
+    Run(source, target, colour, pool, &NearestRows<PATTERN, BITS, OUTPUT, COLOUR>);
+}
+
+void Debayer::Run(const AVFrame* source, AVFrame* target, const Colour* colour, QThreadPool* pool, const Band band)
+{
+    const int height = source->height;
+    const int bands = std::max(1, std::min(pool->maxThreadCount(), height / (int)MIN_BAND_ROWS));
+
+    // Bands start on even rows, so every 2x2 block lies within one band
+    QSemaphore done;
+
+    for(int i = 1; i < bands; i++) {
+        const int first = (i * height / bands) & ~1;
+        const int end = (i == bands - 1) ? height : ((i + 1) * height / bands) & ~1;
+
+        pool->start(new DebayerTask(source, target, colour, band, first, end, &done));
+    }
+
+    band(source, target, colour, 0, (bands == 1) ? height : (height / bands) & ~1);
+
+    done.acquire(bands - 1);
+}
+
+template<int PATTERN, int BITS, bool COLOUR>
+Debayer::Kernel Debayer::SelectMethod(const Method method, const Output output)
+{
+    if(method == METHOD_NEAREST) {
+        return (output == OUTPUT_RGB32) ? &Nearest<PATTERN, BITS, OUTPUT_RGB32, COLOUR> : &Nearest<PATTERN, BITS, OUTPUT_PLANAR, COLOUR>;
+    }
+
+    return (output == OUTPUT_RGB32) ? &Malvar<PATTERN, BITS, OUTPUT_RGB32, COLOUR> : &Malvar<PATTERN, BITS, OUTPUT_PLANAR, COLOUR>;
+}
+
+template<int PATTERN, int BITS>
+Debayer::Kernel Debayer::SelectColour(const bool colour, const Method method, const Output output)
+{
+    return colour ? SelectMethod<PATTERN, BITS, true>(method, output) : SelectMethod<PATTERN, BITS, false>(method, output);
+}
+
+template<int PATTERN>
+Debayer::Kernel Debayer::SelectBits(const int bits, const bool colour, const Method method, const Output output)
+{
+    switch(bits) {
+        case 10: return SelectColour<PATTERN, 10>(colour, method, output);
+        case 12: return SelectColour<PATTERN, 12>(colour, method, output);
+        case 14: return SelectColour<PATTERN, 14>(colour, method, output);
+        case 16: return SelectColour<PATTERN, 16>(colour, method, output);
+        default: return NULL;
+    }
+}
+
+Debayer::Kernel Debayer::Select(const ZeitBayerPattern pattern,
+                                const int bits,
+                                const Method method,
+                                const Output output,
+                                const bool colour)
+{
+    switch(pattern) {
+        case ZEIT_BAYER_RGGB: return SelectBits<ZEIT_BAYER_RGGB>(bits, colour, method, output);
+        case ZEIT_BAYER_GRBG: return SelectBits<ZEIT_BAYER_GRBG>(bits, colour, method, output);
+        case ZEIT_BAYER_GBRG: return SelectBits<ZEIT_BAYER_GBRG>(bits, colour, method, output);
+        case ZEIT_BAYER_BGGR: return SelectBits<ZEIT_BAYER_BGGR>(bits, colour, method, output);
+        default: return NULL;
+    }
+}
+
+Debayer::Colour::Colour()
+{
+    static const float identity[9] = {1, 0, 0, 0, 1, 0, 0, 0, 1};
+
+    neutral = true;
+    std::copy(identity, identity + 9, matrix);
+    std::fill(offset, offset + 3, 0.0f);
+}
+
+Debayer::Colour::Colour(const int bits,
+                        const int black_level,
+                        const int white_level,
+                        const float gains[3],
+                        const float camera_to_srgb[9],
+                        const Transfer transfer)
+{
+    const int max_value = (1 << bits) - 1;
+
+    // Black to white spans the LUT
+    const float scale = (float)(LUT_SIZE - 1) / (white_level - black_level);
+
+    neutral = (black_level == 0 && white_level == max_value && transfer == TRANSFER_LINEAR);
+
+    for(int o = 0; o < 3; o++) {
+        offset[o] = 0.0f;
+
+        for(int i = 0; i < 3; i++) {
+            const float identity = (o == i) ? 1.0f : 0.0f;
+
+            neutral = neutral && camera_to_srgb[3 * o + i] == identity && gains[i] == 1.0f;
+
+            matrix[3 * o + i] = camera_to_srgb[3 * o + i] * gains[i] * scale;
+            offset[o] -= matrix[3 * o + i] * black_level;
+        }
+    }
+
+    lut.resize(LUT_SIZE);
+
+    for(int i = 0; i < LUT_SIZE; i++) {
+        const double linear = (double)i / (LUT_SIZE - 1);
+        double encoded = linear;
+
+        if(transfer == TRANSFER_SRGB) {
+            encoded = (linear <= 0.0031308) ? 12.92 * linear : 1.055 * std::pow(linear, 1.0 / 2.4) - 0.055;
+        }
+
+        lut[i] = (uint16_t)std::min((int)(encoded * max_value + 0.5), max_value);
+    }
+}
+
+AVPixelFormat Debayer::SourceFormat(const ZeitBayerPattern pattern)
+{
+    switch(pattern) {
+        case ZEIT_BAYER_RGGB: return AV_PIX_FMT_BAYER_RGGB16LE;
+        case ZEIT_BAYER_GBRG: return AV_PIX_FMT_BAYER_GBRG16LE;
+        case ZEIT_BAYER_BGGR: return AV_PIX_FMT_BAYER_BGGR16LE;
+        default: return AV_PIX_FMT_BAYER_GRBG16LE;
+    }
+}
+
+AVPixelFormat Debayer::PlanarFormat(const int bits)
+{
+    switch(bits) {
+        case 10: return AV_PIX_FMT_GBRP10;
+        case 12: return AV_PIX_FMT_GBRP12;
+        case 14: return AV_PIX_FMT_GBRP14;
+        default: return AV_PIX_FMT_GBRP16;
+    }
+}
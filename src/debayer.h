@@ -0,0 +1,197 @@
+#ifndef DEBAYER_H
+#define DEBAYER_H
+
+/** \file
+ * Debayer header
+ * Declares the `Debayer` kernels, turning raw sensor frames into RGB
+ */
+
+#include <stdint.h>
+
+#include <vector>
+
+class QThreadPool;
+
+extern "C" {
+#include <libavutil/frame.h>
+#include <libavutil/pixfmt.h>
+}
+
+/*!
+ * \brief Identifies the colour filter array layout, named by the top left 2x2 block
+ *
+ * The values encode where red sits: row parity * 2 + column parity.
+ */
+enum ZeitBayerPattern {
+    ZEIT_BAYER_RGGB = 0,
+    ZEIT_BAYER_GRBG = 1,    //!< The layout of the original camera
+    ZEIT_BAYER_GBRG = 2,
+    ZEIT_BAYER_BGGR = 3
+};
+
+/*!
+ * \brief Demosaicing kernels, specialised for every layout, depth and output
+ *
+ * Two methods are offered:
+ * - Nearest neighbour, taking all channels from the 2x2 block a pixel is in.
+ * - Malvar, He and Cutler's linear demosaic: bilinear interpolation
+ *   corrected by the Laplacian of the channel that was sampled, which keeps
+ *   fine detail free of the colour fringes plain bilinear filtering leaves.
+ *
+ * The kernels are templates on the CFA pattern, the bit depth of the samples
+ * and the output format, so every combination compiles to inner loops
+ * without any per-pixel decisions. `Select()` picks one when a sequence is
+ * loaded.
+ *
+ * Colour correction is fused into the same loop: every pixel's demosaiced
+ * values go through one 3x3 matrix and offset, which fold together black
+ * level subtraction, white balance, the camera to sRGB matrix and scaling to
+ * the range of a transfer LUT, and then through that LUT. Sensors that need no
+ * correction get kernels without the stage.
+ *
+ * The Malvar filters reach two samples in every direction. Instead of
+ * testing for the picture borders per pixel, chunks of rows are copied into
+ * a scratch buffer with two mirrored samples around them; on SSE2 the inner
+ * loop works on 8 pixels at a time. Bands of rows run in parallel on the pool
+ * the caller hands in, at most as many as it has threads.
+ */
+class Debayer
+{
+public:
+    /*!
+     * \brief Identifies the demosaicing method
+     */
+    enum Method {
+        METHOD_NEAREST,     //!< Fast, for previews
+        METHOD_MALVAR       //!< Gradient-corrected, for exports
+    };
+
+    /*!
+     * \brief Identifies the formats kernels write
+     */
+    enum Output {
+        OUTPUT_RGB32,       //!< Native endian 0xffRRGGBB, 8 bit
+        OUTPUT_PLANAR       //!< Planar GBR at the depth of the samples, see `PlanarFormat()`
+    };
+
+    /*!
+     * \brief Identifies the transfer function corrected values are encoded with
+     */
+    enum Transfer {
+        TRANSFER_LINEAR,    //!< As the sensor measured
+        TRANSFER_SRGB       //!< The sRGB curve, for display
+    };
+
+    const static int MIN_BITS = 10;     //!< Shallowest samples with a specialisation
+    const static int MAX_BITS = 16;     //!< Samples are stored in 16 bit words
+
+    const static int LUT_BITS = 14;                 //!< Precision of linear values, above that of 12 bit sensors
+    const static int LUT_SIZE = 1 << LUT_BITS;
+
+    /*!
+     * \brief Colour correction of a sensor, prepared for the kernels
+     */
+    struct Colour {
+        bool neutral;               //!< Nothing to correct, kernels without the stage suffice
+        float matrix[9];            //!< Row major, demosaiced RGB to LUT indices
+        float offset[3];            //!< Black level through `matrix`, negated
+        std::vector<uint16_t> lut;  //!< Transfer of `LUT_SIZE` linear values, at the depth of the samples
+
+        /*!
+         * \brief No correction
+         */
+        Colour();
+
+        /*!
+         * \brief Fold a sensor's correction into one matrix and a LUT
+         * \param bits Significant bits of the samples, and of the corrected values
+         * \param gains White balance of red, green and blue
+         * \param camera_to_srgb Row major, applied after the gains
+         */
+        Colour(const int bits,
+               const int black_level,
+               const int white_level,
+               const float gains[3],
+               const float camera_to_srgb[9],
+               const Transfer transfer);
+    };
+
+    /*!
+     * \brief A kernel, demosaicing a whole frame into one of the same size
+     * \param colour Correction of the sensor, ignored by kernels without the stage
+     * \param pool Runs the bands besides the one of the calling thread
+     */
+    typedef void (*Kernel)(const AVFrame* source, AVFrame* target, const Colour* colour, QThreadPool* pool);
+
+    /*!
+     * \brief Pick the kernel for a sensor
+     * \param bits Significant bits of the 16 bit samples, 10, 12, 14 or 16
+     * \param colour Whether to correct colour, false for a neutral `Colour`
+     * \return NULL if there is no specialisation for the combination
+     */
+    static Kernel Select(const ZeitBayerPattern pattern,
+                         const int bits,
+                         const Method method,
+                         const Output output,
+                         const bool colour);
+
+    /*!
+     * \brief Raw format to read frames of a pattern as, 16 bit little endian
+     */
+    static AVPixelFormat SourceFormat(const ZeitBayerPattern pattern);
+
+    /*!
+     * \brief Format of `OUTPUT_PLANAR` frames at a depth
+     */
+    static AVPixelFormat PlanarFormat(const int bits);
+
+private:
+    friend class DebayerTask;   //!< Runs a band on the pool
+
+    const static int PAD = 2;               //!< Mirrored samples around the picture, the reach of the filters
+    const static int CHUNK_ROWS = 32;       //!< Rows padded at a time, so the scratch buffer stays in cache
+    const static int MIN_BAND_ROWS = 64;    //!< Smaller bands cost more in padding and handover than they gain
+
+    /*!
+     * \brief Demosaics a band of rows
+     * \param first First row of the band, even
+     * \param end Row after the last one of the band
+     */
+    typedef void (*Band)(const AVFrame* source, AVFrame* target, const Colour* colour, const int first, const int end);
+
+    /*!
+     * \brief Split a frame into bands and demosaic them on the pool
+     */
+    static void Run(const AVFrame* source, AVFrame* target, const Colour* colour, QThreadPool* pool, const Band band);
+
+    template<int PATTERN, int BITS, int OUTPUT, bool COLOUR>
+    static void Nearest(const AVFrame* source, AVFrame* target, const Colour* colour, QThreadPool* pool);
+
+    template<int PATTERN, int BITS, int OUTPUT, bool COLOUR>
+    static void NearestRows(const AVFrame* source, AVFrame* target, const Colour* colour, const int first, const int end);
+
+    template<int PATTERN, int BITS, int OUTPUT, bool COLOUR>
+    static void Malvar(const AVFrame* source, AVFrame* target, const Colour* colour, QThreadPool* pool);
+
+    template<int PATTERN, int BITS, int OUTPUT, bool COLOUR>
+    static void MalvarRows(const AVFrame* source, AVFrame* target, const Colour* colour, const int first, const int end);
+
+    /*!
+     * \brief Demosaic a row
+     * \param rows The padded rows two above to two below, pointing at column 0
+     * \param RED_ROW The row holds red rather than blue samples
+     */
+    template<int PATTERN, int BITS, int OUTPUT, bool COLOUR, bool RED_ROW>
+    static void MalvarRow(const uint16_t* const rows[5], const int width, const Colour* colour, AVFrame* target, const int y);
+
+    template<int PATTERN, int BITS, bool COLOUR>
+    static Kernel SelectMethod(const Method method, const Output output);
+
+    template<int PATTERN, int BITS>
+    static Kernel SelectColour(const bool colour, const Method method, const Output output);
+
+    template<int PATTERN>
+    static Kernel SelectBits(const int bits, const bool colour, const Method method, const Output output);
+};
+
+#endif // DEBAYER_H
@@ -0,0 +1,479 @@
+#include "exportqueue.h"
+
+#if defined(Q_OS_WIN)
+#define NOMINMAX
+#include <windows.h>
+#elif defined(Q_OS_MAC)
+#include <sys/sysctl.h>
+#include <sys/types.h>
+#else
+#include <unistd.h>
+#endif
+
+#if defined(Q_OS_LINUX)
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#endif
+
+/*!
+ * \brief Bytes of physical memory, 0 if unknown
+ */
+static qint64 PhysicalMemory()
+{
+#if defined(Q_OS_WIN)
+    MEMORYSTATUSEX status;
+    status.dwLength = sizeof(status);
+
+    return GlobalMemoryStatusEx(&status) ? (qint64)status.ullTotalPhys : 0;
+#elif defined(Q_OS_MAC)
+    int64_t memory = 0;
+    size_t size = sizeof(memory);
+
+    return (sysctlbyname("hw.memsize", &memory, &size, NULL, 0) == 0) ? (qint64)memory : 0;
+#else
+    const long pages = sysconf(_SC_PHYS_PAGES);
+    const long page_size = sysconf(_SC_PAGE_SIZE);
+
+    return (pages > 0 && page_size > 0) ? (qint64)pages * page_size : 0;
+#endif
+}
+
+/*!
+ * \brief Nice value of a job's threads on Linux, the preview runs at 0
+ */
+static int NiceValue(const ZeitJobPriority priority)
+{
+    switch(priority) {
+        case ZEIT_PRIORITY_HIGH:
+            return 5;
+
+        case ZEIT_PRIORITY_LOW:
+            return 19;
+
+        default:
+            return 10;
+    }
+}
+
+ExportJob::ExportJob()
+{
+    id = -1;
+
+    framerate = ZEIT_RATE_24p;
+    filter = ZEIT_FILTER_NONE;
+    profile = ZEIT_PROFILE_STANDARD;
+    flip_x = true;
+    flip_y = true;
+    rotate_90d_cw = false;
+
+    in_point = 0;
+    out_point = -1;
+    stride = 1;
+    height = ZEIT_RESOLUTION_SOURCE;
+    depth = ZEIT_DEPTH_8;
+
+    priority = ZEIT_PRIORITY_NORMAL;
+    state = ZEIT_JOB_QUEUED;
+
+    frames_done = 0;
+    encoder_threads = 0;
+}
+
+ExportWorker::ExportWorker(const ExportJob& job, QObject *parent) :
+    QObject(parent)
+{
+    this->job = job;
+    engine = NULL;
+    cancelled = false;
+}
+
+void ExportWorker::Cancel(const bool keep_partial)
+{
+    mutex.lock();
+    cancelled = true;
+
+    if(engine != NULL) {
+        engine->control_mutex.lock();
+        engine->keep_partial_flag = keep_partial;
+        engine->stop_flag = true;
+        engine->control_mutex.unlock();
+    }
+    mutex.unlock();
+}
+
+void ExportWorker::SetThreads(const int encoder_threads)
+{
+    mutex.lock();
+    job.encoder_threads = encoder_threads;
+
+    if(engine != NULL) {
+        engine->control_mutex.lock();
+        engine->encoder_threads = encoder_threads;
+        engine->control_mutex.unlock();
+    }
+    mutex.unlock();
+}
+
+void ExportWorker::Run()
+{
+#if defined(Q_OS_LINUX)
+    // Linux ignores thread priorities other than idle, but every thread has
+    // a nice value of its own, which the threads it starts inherit: the
+    // engine's pools and encoders, all started from here
+    if(setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), NiceValue(job.priority)) != 0) {
+        av_log(NULL, AV_LOG_WARNING, "Could not lower the priority of export %d\n", job.id);
+    }
+#endif
+
+    // Nothing is displayed, the sink only satisfies the engine
+    TripleBuffer sink;
+    ZeitEngine job_engine(&sink, 1280, 1280);
+
+    connect(&job_engine, &ZeitEngine::ProgressUpdated, this, [this](const QString text, const int current, const int total) {
+        if(text == "Encoding frames" || text == "Encoding complete") {
+            emit Progress(job.id, current, total);
+        }
+    });
+
+    job_engine.control_mutex.lock();
+    job_engine.configured_framerate = job.framerate;
+    job_engine.filter_flag = job.filter;
+    job_engine.profile_flag = job.profile;
+    job_engine.flip_x_flag = job.flip_x;
+    job_engine.flip_y_flag = job.flip_y;
+    job_engine.rotate_90d_cw_flag = job.rotate_90d_cw;
+    job_engine.export_in_flag = job.in_point;
+    job_engine.export_out_flag = job.out_point;
+    job_engine.export_stride_flag = job.stride;
+    job_engine.export_height_flag = job.height;
+    job_engine.export_depth_flag = job.depth;
+    job_engine.control_mutex.unlock();
+
+    mutex.lock();
+    bool cancelled_early = cancelled;
+
+    // Taken over together with the engine, so no rebalancing gets lost
+    if(!cancelled_early) {
+        job_engine.control_mutex.lock();
+        job_engine.encoder_threads = job.encoder_threads;
+        job_engine.control_mutex.unlock();
+
+        engine = &job_engine;
+    }
+    mutex.unlock();
+
+    if(cancelled_early) {
+        emit Finished(job.id, false, true);
+        return;
+    }
+
+    ExportRendition rendition = { job.output, 0, job.profile };
+    QList<ExportRendition> renditions = job.extra_renditions;
+    renditions.prepend(rendition);
+
+    bool success = job_engine.Open(job.sequence) && job_engine.ExportRenditions(renditions);
+
+    mutex.lock();
+    engine = NULL;
+    bool was_cancelled = cancelled;
+    mutex.unlock();
+
+    emit Finished(job.id, success, was_cancelled && !success);
+}
+
+ExportQueue::ExportQueue(QObject *parent) :
+    QObject(parent)
+{
+    next_id = 0;
+
+    core_budget = std::max(2, QThread::idealThreadCount() - (int)PREVIEW_THREADS);
+
+    // The other half is left to the preview's caches and everything else
+    const qint64 physical_memory = PhysicalMemory();
+    memory_budget = (physical_memory > 0) ? physical_memory / 2 : FALLBACK_MEMORY_BUDGET;
+
+    // Each job keeps one thread busy decoding and at least one encoding
+    int by_cores = core_budget / 2;
+    int by_memory = (int)(memory_budget / JOB_MEMORY);
+
+    max_running = std::max(1, std::min(by_cores, by_memory));
+}
+
+ExportQueue::~ExportQueue()
+{
+    for(QHash<int, ExportWorker*>::iterator it = workers.begin(); it != workers.end(); ++it) {
+        it.value()->Cancel(false);
+    }
+
+    for(QHash<int, QThread*>::iterator it = threads.begin(); it != threads.end(); ++it) {
+        it.value()->quit();
+        it.value()->wait();
+        delete workers.value(it.key());
+        delete it.value();
+    }
+}
+
+int ExportQueue::IndexOf(const int id) const
+{
+    for(int i = 0; i < jobs.size(); i++) {
+        if(jobs.at(i).id == id) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+int ExportQueue::Enqueue(ExportJob job)
+{
+    job.id = next_id++;
+    job.state = ZEIT_JOB_QUEUED;
+    job.frames_done = 0;
+    job.encoder_threads = 0;
+
+    jobs.append(job);
+
+    emit JobUpdated(job.id);
+
+    Schedule();
+
+    return job.id;
+}
+
+qint64 ExportQueue::JobMemory(const ExportJob& job)
+{
+    // Every rendition has an encoder, and its lookahead, of its own
+    return JOB_MEMORY * (1 + job.extra_renditions.size());
+}
+
+void ExportQueue::Schedule()
+{
+    int running = workers.size();
+    qint64 memory = 0;
+
+    for(int i = 0; i < jobs.size(); i++) {
+        if(workers.contains(jobs.at(i).id)) {
+            memory += JobMemory(jobs.at(i));
+        }
+    }
+
+    // Picked first, so the jobs that start together get the same share
+    QList<int> starting;
+
+    while(running + starting.size() < max_running) {
+        int next = -1;
+
+        for(int i = 0; i < jobs.size(); i++) {
+            if(jobs.at(i).state != ZEIT_JOB_QUEUED || starting.contains(i)) {
+                continue;
+            }
+
+            if(next == -1 || jobs.at(i).priority > jobs.at(next).priority) {
+                next = i;
+            }
+        }
+
+        // Jobs of many renditions wait for memory, unless nothing runs at all
+        if(next == -1 || (running + starting.size() > 0 && memory + JobMemory(jobs.at(next)) > memory_budget)) {
+            break;
+        }
+
+        memory += JobMemory(jobs.at(next));
+        starting.append(next);
+    }
+
+    if(!starting.isEmpty()) {
+        // Each job's engine thread decodes, the rest of its share is split
+        // between its encoders and pools
+        const int encoder_threads = std::max(1, core_budget / (running + starting.size()) - 1);
+
+        for(int i = 0; i < starting.size(); i++) {
+            Start(starting.at(i), encoder_threads);
+        }
+    }
+
+    Rebalance();
+}
+
+void ExportQueue::Rebalance()
+{
+    if(workers.isEmpty()) {
+        return;
+    }
+
+    const int encoder_threads = std::max(1, core_budget / workers.size() - 1);
+
+    for(int i = 0; i < jobs.size(); i++) {
+        ExportJob& job = jobs[i];
+
+        if(!workers.contains(job.id) || job.encoder_threads == encoder_threads) {
+            continue;
+        }
+
+        job.encoder_threads = encoder_threads;
+        workers.value(job.id)->SetThreads(encoder_threads);
+
+        emit JobUpdated(job.id);
+    }
+}
+
+void ExportQueue::Start(const int index, const int encoder_threads)
+{
+    ExportJob& job = jobs[index];
+
+    job.state = ZEIT_JOB_RUNNING;
+    job.encoder_threads = encoder_threads;
+
+    QThread* thread = new QThread();
+    ExportWorker* worker = new ExportWorker(job);
+
+    thread->setObjectName(QString("Export %1").arg(job.id));
+    worker->moveToThread(thread);
+
+    connect(thread, &QThread::started, worker, &ExportWorker::Run);
+    connect(worker, &ExportWorker::Progress, this, &ExportQueue::JobProgressed);
+    connect(worker, &ExportWorker::Finished, this, &ExportQueue::JobFinished);
+
+    workers.insert(job.id, worker);
+    threads.insert(job.id, thread);
+
+    // Below the preview in any case; low priority jobs only get idle time,
+    // which is also the only level Linux tells apart for normal threads,
+    // `ExportWorker::Run()` sets nice values there. Encoder threads inherit
+    // the priority of the job thread.
+    QThread::Priority thread_priority;
+
+    switch(job.priority) {
+        case ZEIT_PRIORITY_HIGH:
+            thread_priority = QThread::LowPriority;
+            break;
+
+        case ZEIT_PRIORITY_LOW:
+            thread_priority = QThread::IdlePriority;
+            break;
+
+        default:
+            thread_priority = QThread::LowestPriority;
+            break;
+    }
+
+    thread->start(thread_priority);
+
+    emit JobUpdated(job.id);
+}
+
+void ExportQueue::JobProgressed(const int id, const int current, const int total)
+{
+    int index = IndexOf(id);
+
+    if(index == -1) {
+        return;
+    }
+
+    jobs[index].frames_done = current;
+
+    emit JobProgress(id, current, total);
+}
+
+void ExportQueue::JobFinished(const int id, const bool success, const bool cancelled)
+{
+    QThread* thread = threads.take(id);
+    ExportWorker* worker = workers.take(id);
+
+    if(thread != NULL) {
+        thread->quit();
+        thread->wait();
+        delete worker;
+        delete thread;
+    }
+
+    int index = IndexOf(id);
+
+    if(index != -1) {
+        if(success) {
+            jobs[index].state = ZEIT_JOB_DONE;
+        } else if(cancelled) {
+            jobs[index].state = ZEIT_JOB_CANCELLED;
+        } else {
+            jobs[index].state = ZEIT_JOB_FAILED;
+        }
+
+        emit JobUpdated(id);
+    }
+
+    Schedule();
+}
+
+void ExportQueue::Cancel(const int id, const bool keep_partial)
+{
+    int index = IndexOf(id);
+
+    if(index == -1) {
+        return;
+    }
+
+    if(jobs.at(index).state == ZEIT_JOB_QUEUED) {
+        jobs[index].state = ZEIT_JOB_CANCELLED;
+        emit JobUpdated(id);
+    } else if(workers.contains(id)) {
+        // Reported back through `JobFinished()` once the engine stopped
+        workers.value(id)->Cancel(keep_partial);
+    }
+}
+
+bool ExportQueue::IsRunning(const int id) const
+{
+    return workers.contains(id);
+}
+
+void ExportQueue::SetPriority(const int id, const ZeitJobPriority priority)
+{
+    int index = IndexOf(id);
+
+    if(index == -1 || jobs.at(index).state != ZEIT_JOB_QUEUED) {
+        return;
+    }
+
+    jobs[index].priority = priority;
+
+    emit JobUpdated(id);
+}
+
+void ExportQueue::RemoveFinished()
+{
+    for(int i = jobs.size() - 1; i >= 0; i--) {
+        ZeitJobState state = jobs.at(i).state;
+
+        if(state == ZEIT_JOB_DONE || state == ZEIT_JOB_FAILED || state == ZEIT_JOB_CANCELLED) {
+            int id = jobs.at(i).id;
+            jobs.removeAt(i);
+            emit JobRemoved(id);
+        }
+    }
+}
+
+ExportJob ExportQueue::Job(const int id) const
+{
+    int index = IndexOf(id);
+
+    if(index == -1) {
+        return ExportJob();
+    }
+
+    return jobs.at(index);
+}
+
+QList<ExportJob> ExportQueue::Jobs() const
+{
+    return jobs;
+}
+
+int ExportQueue::MaxRunning() const
+{
+    return max_running;
+}
+
+int ExportQueue::CoreBudget() const
+{
+    return core_budget;
+}
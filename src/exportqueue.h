@@ -0,0 +1,247 @@
+#ifndef EXPORTQUEUE_H
+#define EXPORTQUEUE_H
+
+/** \file
+ * ExportQueue header
+ * Declares the `ExportQueue` class, which runs many exports side by side
+ */
+
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QThread>
+
+#include "triplebuffer.h"
+#include "zeitengine.h"
+
+/*!
+ * \brief Lifecycle of a queued export
+ */
+enum ZeitJobState {
+    ZEIT_JOB_QUEUED,
+    ZEIT_JOB_RUNNING,
+    ZEIT_JOB_DONE,
+    ZEIT_JOB_FAILED,
+    ZEIT_JOB_CANCELLED
+};
+
+/*!
+ * \brief Order in which queued exports are started
+ *
+ * Also decides the priority of the thread a job runs in, so interactive work
+ * and more urgent jobs are served first when the machine is saturated.
+ */
+enum ZeitJobPriority {
+    ZEIT_PRIORITY_LOW,
+    ZEIT_PRIORITY_NORMAL,
+    ZEIT_PRIORITY_HIGH
+};
+
+/*!
+ * \brief Everything needed to export one sequence, independently of the GUI
+ */
+struct ExportJob {
+    int id;                     //!< Assigned by `ExportQueue::Enqueue()`
+    QFileInfoList sequence;
+    QFileInfo output;
+
+    ZeitRate framerate;
+    ZeitFilter filter;
+    ZeitProfile profile;
+    bool flip_x;
+    bool flip_y;
+    bool rotate_90d_cw;
+
+    int in_point;               //!< First position to export
+    int out_point;              //!< Last position to export, -1 for the end
+    int stride;                 //!< Export every n-th frame of the range
+    unsigned int height;        //!< Height of the video, see `ZeitResolution`
+    ZeitDepth depth;
+
+    QList<ExportRendition> extra_renditions;   //!< Further videos made in the same pass as `output`
+
+    ZeitJobPriority priority;
+    ZeitJobState state;
+
+    int frames_done;            //!< Progress, as last reported by the job's engine
+    int encoder_threads;        //!< Threads the job may use besides its engine's, for encoders and pools; 0 while queued
+
+    ExportJob();
+};
+
+/*!
+ * \brief Runs a single `ExportJob` on its own `ZeitEngine`
+ *
+ * Lives in a thread of its own; the engine is created inside `Run()` so it
+ * belongs to that thread as well.
+ */
+class ExportWorker : public QObject
+{
+    Q_OBJECT
+
+    ExportJob job;
+
+    QMutex mutex;           //!< Guards `engine`, `cancelled` and `job.encoder_threads`
+    ZeitEngine* engine;     //!< The running engine, NULL before and after `Run()`
+    bool cancelled;
+
+public:
+    ExportWorker(const ExportJob& job, QObject *parent = 0);
+
+    /*!
+     * \brief Ask the job to stop, thread-safe
+     * \param keep_partial Finalize the frames encoded so far instead of removing the file
+     */
+    void Cancel(const bool keep_partial);
+
+    /*!
+     * \brief Change the job's thread budget, thread-safe
+     *
+     * The engine splits it anew before its next segment.
+     */
+    void SetThreads(const int encoder_threads);
+
+signals:
+    void Progress(const int id, const int current, const int total);
+    void Finished(const int id, const bool success, const bool cancelled);
+
+public slots:
+    void Run();
+};
+
+/*!
+ * \brief Schedules exports so that several run at the same time
+ *
+ * Every job gets its own engine and thread, so exports never hold up the
+ * previewing engine. As many jobs run concurrently as the core budget and
+ * the memory budget (half the physical memory) allow, each one taking at
+ * least a decode and an encode thread and `JOB_MEMORY` for each of its
+ * renditions. The core budget is split evenly between the running jobs and
+ * split again whenever a job starts or finishes; each job's engine divides
+ * its share between its encoders and thread pools. The core budget leaves
+ * `PREVIEW_THREADS` cores to the GUI and preview, and job threads run below
+ * normal priority. Queued jobs start by priority, then in the order they
+ * were added.
+ *
+ * All methods are meant to be called from the thread the queue lives in.
+ */
+class ExportQueue : public QObject
+{
+    Q_OBJECT
+
+    const static qint64 FALLBACK_MEMORY_BUDGET = 2048LL * 1024 * 1024;    //!< Used if the physical memory is unknown
+    const static qint64 JOB_MEMORY = 384LL * 1024 * 1024;      //!< Estimated peak of one rendition, mostly encoder lookahead
+    const static int PREVIEW_THREADS = 2;                       //!< Cores kept free for the GUI and preview engine
+
+    QList<ExportJob> jobs;                  //!< All jobs, in the order they were added
+    QHash<int, ExportWorker*> workers;      //!< Running jobs by id
+    QHash<int, QThread*> threads;           //!< Threads of running jobs by id
+
+    int next_id;
+    int core_budget;        //!< Cores the running jobs may use together
+    qint64 memory_budget;   //!< Memory the running jobs may use together
+    int max_running;
+
+    /*!
+     * \brief Index of a job in `jobs`, -1 if unknown
+     */
+    int IndexOf(const int id) const;
+
+    /*!
+     * \brief Estimated peak memory of a job
+     */
+    static qint64 JobMemory(const ExportJob& job);
+
+    /*!
+     * \brief Start queued jobs while there is room, then rebalance
+     */
+    void Schedule();
+
+    /*!
+     * \brief Split the core budget evenly between the running jobs
+     */
+    void Rebalance();
+
+    /*!
+     * \brief Run a job on a new thread
+     * \param index Index of the job in `jobs`
+     * \param encoder_threads Threads the job may use besides its engine's
+     */
+    void Start(const int index, const int encoder_threads);
+
+private slots:
+    void JobProgressed(const int id, const int current, const int total);
+    void JobFinished(const int id, const bool success, const bool cancelled);
+
+public:
+    explicit ExportQueue(QObject *parent = 0);
+
+    /*!
+     * \brief Cancel all running jobs and wait for them
+     */
+    ~ExportQueue();
+
+    /*!
+     * \brief Add a job and start it as soon as there is room
+     * \return The id of the job
+     */
+    int Enqueue(ExportJob job);
+
+    /*!
+     * \brief Cancel a job, queued ones are dropped right away
+     * \param keep_partial For running jobs, keep what was exported so far as a shorter video
+     */
+    void Cancel(const int id, const bool keep_partial = false);
+
+    /*!
+     * \brief Check whether a job has started and not finished yet
+     */
+    bool IsRunning(const int id) const;
+
+    /*!
+     * \brief Change the priority of a job, only affects jobs that have not started yet
+     */
+    void SetPriority(const int id, const ZeitJobPriority priority);
+
+    /*!
+     * \brief Forget all jobs that are done, failed or cancelled
+     */
+    void RemoveFinished();
+
+    /*!
+     * \brief Look up a job
+     * \return A copy of the job, with `id` -1 if unknown
+     */
+    ExportJob Job(const int id) const;
+
+    /*!
+     * \brief All jobs, in the order they were added
+     */
+    QList<ExportJob> Jobs() const;
+
+    /*!
+     * \brief Number of jobs that may run at the same time
+     */
+    int MaxRunning() const;
+
+    /*!
+     * \brief Number of cores the running jobs may use together
+     */
+    int CoreBudget() const;
+
+signals:
+    /*!
+     * \brief A job was added, started, finished or changed priority
+     */
+    void JobUpdated(const int id);
+
+    /*!
+     * \brief A job was removed from the queue
+     */
+    void JobRemoved(const int id);
+
+    void JobProgress(const int id, const int current, const int total);
+};
+
+#endif // EXPORTQUEUE_H
@@ -0,0 +1,324 @@
+#include "exportqueuedialog.h"
+#include "ui_exportqueuedialog.h"
+
+ExportQueueDialog::ExportQueueDialog(ZeitEngine* engine, QWidget *parent) :
+    QDialog(parent),
+    ui(new Ui::ExportQueueDialog)
+{
+    ui->setupUi(this);
+
+    this->engine = engine;
+
+    ui->jobTable->setColumnWidth(0, 200);
+    ui->jobTable->setColumnWidth(1, 200);
+    ui->jobTable->setColumnWidth(2, 90);
+    ui->jobTable->setColumnWidth(3, 130);
+
+    ui->sizeComboBox->addItem("Source size", ZEIT_RESOLUTION_SOURCE);
+    ui->sizeComboBox->addItem("4K (2160p)", ZEIT_RESOLUTION_2160p);
+    ui->sizeComboBox->addItem("1080p", ZEIT_RESOLUTION_1080p);
+    ui->sizeComboBox->addItem("720p", ZEIT_RESOLUTION_720p);
+
+    connect(&queue, &ExportQueue::JobUpdated, this, &ExportQueueDialog::UpdateJob);
+    connect(&queue, &ExportQueue::JobRemoved, this, &ExportQueueDialog::RemoveJob);
+    connect(&queue, &ExportQueue::JobProgress, this, &ExportQueueDialog::UpdateJobProgress);
+
+    setWindowTitle(QString("Export queue - up to %1 at a time on %2 cores").arg(queue.MaxRunning()).arg(queue.CoreBudget()));
+}
+
+ExportQueueDialog::~ExportQueueDialog()
+{
+    delete ui;
+}
+
+void ExportQueueDialog::SetBrowseDirectory(const QDir& dir)
+{
+    browse_dir = dir;
+}
+
+int ExportQueueDialog::RowOf(const int id) const
+{
+    for(int row = 0; row < ui->jobTable->rowCount(); row++) {
+        if(ui->jobTable->item(row, 0)->data(Qt::UserRole).toInt() == id) {
+            return row;
+        }
+    }
+
+    return -1;
+}
+
+bool ExportQueueDialog::AddFolder(const QDir& folder)
+{
+    QFileInfoList files = ZeitEngine::FindSequence(folder);
+
+    if(files.empty()) {
+        return false;
+    }
+
+    QString directory = output_dir;
+
+    if(directory.isEmpty()) {
+        QDir parent_dir(folder);
+        parent_dir.cdUp();
+        directory = parent_dir.absolutePath();
+    }
+
+    // Matroska holds 10 bit video of any encoder, see `ZeitEngine::export_depth_flag`
+    const QString extension = ui->depthCheckBox->isChecked() ? ".mkv" : ".mp4";
+
+    QFileInfo output(QDir(directory).filePath(folder.dirName() + extension));
+
+    // Never overwrite silently, nobody is around to confirm it
+    if(output.exists()) {
+        return false;
+    }
+
+    Enqueue(files, output, ZEIT_PRIORITY_NORMAL);
+
+    return true;
+}
+
+int ExportQueueDialog::Enqueue(const QFileInfoList& sequence,
+                               const QFileInfo& output,
+                               const ZeitJobPriority priority,
+                               const int in_point,
+                               const int out_point)
+{
+    ExportJob job;
+    job.sequence = sequence;
+    job.output = output;
+    job.priority = priority;
+    job.in_point = in_point;
+    job.out_point = out_point;
+    job.stride = ui->strideSpinBox->value();
+    job.height = ui->sizeComboBox->currentData().toUInt();
+    job.depth = ui->depthCheckBox->isChecked() ? ZEIT_DEPTH_10 : ZEIT_DEPTH_8;
+
+    engine->control_mutex.lock();
+    job.framerate = engine->configured_framerate;
+    job.filter = engine->filter_flag;
+    job.profile = engine->profile_flag;
+    job.flip_x = engine->flip_x_flag;
+    job.flip_y = engine->flip_y_flag;
+    job.rotate_90d_cw = engine->rotate_90d_cw_flag;
+    engine->control_mutex.unlock();
+
+    return queue.Enqueue(job);
+}
+
+void ExportQueueDialog::on_addButton_clicked()
+{
+    QString dir_name = QFileDialog::getExistingDirectory(this,
+                                                         "Add Footage Folders",
+                                                         browse_dir.absolutePath(),
+                                                         QFileDialog::ShowDirsOnly | QFileDialog::DontResolveSymlinks);
+
+    if(dir_name.isEmpty()) {
+        return;
+    }
+
+    QDir dir(dir_name);
+    browse_dir = dir;
+    browse_dir.cdUp();
+
+    int added = 0;
+    int skipped = 0;
+
+    if(!ZeitEngine::FindSequence(dir).empty()) {
+        if(AddFolder(dir)) {
+            added++;
+        } else {
+            skipped++;
+        }
+    } else {
+        // A folder of footage folders, e.g. one per camera
+        QStringList subdirs = dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name);
+
+        for(int i = 0; i < subdirs.size(); i++) {
+            QDir subdir(dir.filePath(subdirs.at(i)));
+
+            if(ZeitEngine::FindSequence(subdir).empty()) {
+                continue;
+            }
+
+            if(AddFolder(subdir)) {
+                added++;
+            } else {
+                skipped++;
+            }
+        }
+    }
+
+    if(added == 0 && skipped == 0) {
+        QMessageBox::information(this,
+                                 "No supported footage found",
+                                 "Neither your chosen folder nor the folders inside it contain footage of a supported format (.jpg/.jpeg/.png/.zd).");
+    } else if(skipped > 0) {
+        QMessageBox::information(this,
+                                 "Some folders were skipped",
+                                 QString("%1 folder(s) were not queued because their video already exists.").arg(skipped));
+    }
+}
+
+void ExportQueueDialog::on_outputButton_clicked()
+{
+    QString dir_name = QFileDialog::getExistingDirectory(this,
+                                                         "Choose Output Folder",
+                                                         output_dir.isEmpty() ? browse_dir.absolutePath() : output_dir,
+                                                         QFileDialog::ShowDirsOnly | QFileDialog::DontResolveSymlinks);
+
+    if(dir_name.isEmpty()) {
+        return;
+    }
+
+    output_dir = dir_name;
+    ui->outputLabel->setText("Videos are written to " + QDir::toNativeSeparators(output_dir));
+}
+
+void ExportQueueDialog::on_cancelButton_clicked()
+{
+    QList<QTableWidgetItem*> selected = ui->jobTable->selectedItems();
+    QList<int> ids;
+
+    for(int i = 0; i < selected.size(); i++) {
+        int id = ui->jobTable->item(selected.at(i)->row(), 0)->data(Qt::UserRole).toInt();
+
+        if(!ids.contains(id)) {
+            ids.append(id);
+        }
+    }
+
+    bool keep_partial = false;
+    bool any_running = false;
+
+    for(int i = 0; i < ids.size(); i++) {
+        any_running = any_running || queue.IsRunning(ids.at(i));
+    }
+
+    if(any_running) {
+        QMessageBox question(this);
+        QPushButton* keep = question.addButton("Keep partial videos", QMessageBox::AcceptRole);
+        question.addButton("Remove partial videos", QMessageBox::DestructiveRole);
+        QPushButton* resume = question.addButton("Continue exporting", QMessageBox::RejectRole);
+
+        question.setDefaultButton(resume);
+        question.setWindowTitle("Cancel exports");
+        question.setText("What should happen to the frames that were exported so far?");
+
+        question.exec();
+
+        if((QPushButton*)question.clickedButton() == resume) {
+            return;
+        }
+
+        keep_partial = ((QPushButton*)question.clickedButton() == keep);
+    }
+
+    for(int i = 0; i < ids.size(); i++) {
+        queue.Cancel(ids.at(i), keep_partial);
+    }
+}
+
+void ExportQueueDialog::on_clearButton_clicked()
+{
+    queue.RemoveFinished();
+}
+
+void ExportQueueDialog::UpdateJob(const int id)
+{
+    ExportJob job = queue.Job(id);
+
+    if(job.id == -1) {
+        return;
+    }
+
+    int row = RowOf(id);
+
+    if(row == -1) {
+        row = ui->jobTable->rowCount();
+        ui->jobTable->insertRow(row);
+
+        QTableWidgetItem* footage = new QTableWidgetItem(QDir(job.sequence.first().absolutePath()).dirName());
+        footage->setData(Qt::UserRole, id);
+        footage->setToolTip(QDir::toNativeSeparators(job.sequence.first().absolutePath()));
+        ui->jobTable->setItem(row, 0, footage);
+
+        QTableWidgetItem* output = new QTableWidgetItem(job.output.fileName());
+        output->setToolTip(QDir::toNativeSeparators(job.output.absoluteFilePath()));
+        ui->jobTable->setItem(row, 1, output);
+
+        QComboBox* priority = new QComboBox;
+        priority->addItem("Low", ZEIT_PRIORITY_LOW);
+        priority->addItem("Normal", ZEIT_PRIORITY_NORMAL);
+        priority->addItem("High", ZEIT_PRIORITY_HIGH);
+        priority->setCurrentIndex(priority->findData(job.priority));
+        ui->jobTable->setCellWidget(row, 2, priority);
+
+        connect(priority, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged), this, [this, id, priority](int) {
+            queue.SetPriority(id, (ZeitJobPriority)priority->currentData().toInt());
+        });
+
+        ui->jobTable->setItem(row, 3, new QTableWidgetItem);
+
+        QProgressBar* progress = new QProgressBar;
+        progress->setRange(0, ZeitEngine::ExportLength(job.sequence.size(), job.in_point, job.out_point, job.stride));
+        progress->setValue(0);
+        ui->jobTable->setCellWidget(row, 4, progress);
+    }
+
+    QString status;
+
+    switch(job.state) {
+        case ZEIT_JOB_RUNNING:
+            status = QString("Running, %1 threads").arg(job.encoder_threads + 1);
+            break;
+
+        case ZEIT_JOB_DONE:
+            status = "Done";
+            break;
+
+        case ZEIT_JOB_FAILED:
+            status = "Failed";
+            break;
+
+        case ZEIT_JOB_CANCELLED:
+            status = "Cancelled";
+            break;
+
+        default:
+            status = "Queued";
+            break;
+    }
+
+    ui->jobTable->item(row, 3)->setText(status);
+
+    // The priority only decides when a job starts
+    ui->jobTable->cellWidget(row, 2)->setEnabled(job.state == ZEIT_JOB_QUEUED);
+
+    if(job.state == ZEIT_JOB_DONE) {
+        QProgressBar* progress = (QProgressBar*)ui->jobTable->cellWidget(row, 4);
+        progress->setValue(progress->maximum());
+    }
+}
+
+void ExportQueueDialog::RemoveJob(const int id)
+{
+    int row = RowOf(id);
+
+    if(row != -1) {
+        ui->jobTable->removeRow(row);
+    }
+}
+
+void ExportQueueDialog::UpdateJobProgress(const int id, const int current, const int total)
+{
+    int row = RowOf(id);
+
+    if(row == -1) {
+        return;
+    }
+
+    QProgressBar* progress = (QProgressBar*)ui->jobTable->cellWidget(row, 4);
+    progress->setRange(0, total);
+    progress->setValue(current);
+}
@@ -0,0 +1,88 @@
+#ifndef EXPORTQUEUEDIALOG_H
+#define EXPORTQUEUEDIALOG_H
+
+#include <QComboBox>
+#include <QDialog>
+#include <QDir>
+#include <QFileDialog>
+#include <QMessageBox>
+#include <QProgressBar>
+
+#include "exportqueue.h"
+
+namespace Ui {
+class ExportQueueDialog;
+}
+
+/*!
+ * \brief Lists the jobs of an `ExportQueue` and adds footage folders to it
+ *
+ * New jobs take over the settings (framerate, filter, orientation, profile)
+ * the footage is currently previewed with.
+ */
+class ExportQueueDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    /*!
+     * \brief Create the dialog and its queue
+     * \param engine The previewing engine, whose settings new jobs use
+     */
+    explicit ExportQueueDialog(ZeitEngine* engine, QWidget *parent = 0);
+    ~ExportQueueDialog();
+
+    /*!
+     * \brief Start browsing for footage folders here
+     */
+    void SetBrowseDirectory(const QDir& dir);
+
+    /*!
+     * \brief Queue a sequence with the current settings
+     * \param sequence The footage to export
+     * \param output The file to export to, overwritten if it exists
+     * \param priority Jobs with a higher priority start first
+     * \param in_point First position to export
+     * \param out_point Last position to export, -1 for the end
+     * \return The id of the job
+     *
+     * The frame stride and output size are taken from the dialog.
+     */
+    int Enqueue(const QFileInfoList& sequence,
+                const QFileInfo& output,
+                const ZeitJobPriority priority,
+                const int in_point = 0,
+                const int out_point = -1);
+
+private slots:
+    void on_addButton_clicked();
+    void on_outputButton_clicked();
+    void on_cancelButton_clicked();
+    void on_clearButton_clicked();
+
+    void UpdateJob(const int id);
+    void RemoveJob(const int id);
+    void UpdateJobProgress(const int id, const int current, const int total);
+
+private:
+    Ui::ExportQueueDialog *ui;
+
+    ExportQueue queue;
+    ZeitEngine* engine;
+
+    QDir browse_dir;
+    QString output_dir;     //!< Empty to write videos next to their footage folders
+
+    /*!
+     * \brief Table row showing a job, -1 if none
+     */
+    int RowOf(const int id) const;
+
+    /*!
+     * \brief Queue a footage folder with the current settings
+     * \return false if the folder holds no footage or its video already exists
+     */
+    bool AddFolder(const QDir& folder);
+};
+
+#endif // EXPORTQUEUEDIALOG_H
@@ -0,0 +1,137 @@
+#include "framecache.h"
+
+FrameCache::FrameCache(const qint64 budget_bytes)
+{
+    budget = budget_bytes;
+    used = 0;
+    usage_counter = 0;
+}
+
+FrameCache::~FrameCache()
+{
+    Clear();
+}
+
+qint64 FrameCache::FrameSize(const AVFrame* frame)
+{
+    return av_image_get_buffer_size((AVPixelFormat)frame->format,
+                                    frame->width,
+                                    frame->height,
+                                    1);
+}
+
+void FrameCache::EvictOne()
+{
+    QHash<int, quint64>::const_iterator oldest = last_used.constEnd();
+
+    for(QHash<int, quint64>::const_iterator it = last_used.constBegin(); it != last_used.constEnd(); ++it) {
+        if(oldest == last_used.constEnd() || it.value() < oldest.value()) {
+            oldest = it;
+        }
+    }
+
+    if(oldest != last_used.constEnd()) {
+        int position = oldest.key();
+        AVFrame* frame = frames.take(position);
+
+        used -= FrameSize(frame);
+        av_frame_free(&frame);
+        last_used.remove(position);
+    }
+}
+
+void FrameCache::Insert(const int position, AVFrame* frame)
+{
+    qint64 size = FrameSize(frame);
+
+    if(size > budget) {
+        av_frame_free(&frame);
+        return;
+    }
+
+    if(frames.contains(position)) {
+        AVFrame* replaced = frames.take(position);
+        used -= FrameSize(replaced);
+        av_frame_free(&replaced);
+        last_used.remove(position);
+    }
+
+    while(used + size > budget && !frames.isEmpty()) {
+        EvictOne();
+    }
+
+    frames.insert(position, frame);
+    last_used.insert(position, ++usage_counter);
+    used += size;
+}
+
+AVFrame* FrameCache::Find(const int position)
+{
+    QMap<int, AVFrame*>::const_iterator it = frames.constFind(position);
+
+    if(it == frames.constEnd()) {
+        return NULL;
+    }
+
+    last_used[position] = ++usage_counter;
+
+    return it.value();
+}
+
+AVFrame* FrameCache::Nearest(const int position, const int max_distance, int* found_position)
+{
+    if(frames.isEmpty()) {
+        return NULL;
+    }
+
+    // First frame at or after the position, and the one right before it
+    QMap<int, AVFrame*>::const_iterator after = frames.lowerBound(position);
+    QMap<int, AVFrame*>::const_iterator best = frames.constEnd();
+
+    if(after != frames.constEnd()) {
+        best = after;
+    }
+
+    if(after != frames.constBegin()) {
+        QMap<int, AVFrame*>::const_iterator before = after - 1;
+
+        if(best == frames.constEnd() || position - before.key() < best.key() - position) {
+            best = before;
+        }
+    }
+
+    if(best == frames.constEnd() || qAbs(best.key() - position) > max_distance) {
+        return NULL;
+    }
+
+    *found_position = best.key();
+    last_used[best.key()] = ++usage_counter;
+
+    return best.value();
+}
+
+bool FrameCache::Contains(const int position) const
+{
+    return frames.contains(position);
+}
+
+void FrameCache::Clear()
+{
+    for(QMap<int, AVFrame*>::iterator it = frames.begin(); it != frames.end(); ++it) {
+        av_frame_free(&it.value());
+    }
+
+    frames.clear();
+    last_used.clear();
+    used = 0;
+}
+
+int FrameCache::Count() const
+{
+    return frames.size();
+}
+
+qint64 FrameCache::Budget() const
+{
+    return budget;
+}
@@ -0,0 +1,97 @@
+#ifndef FRAMECACHE_H
+#define FRAMECACHE_H
+
+/** \file
+ * FrameCache header
+ * Declares the `FrameCache` class, a memory bounded store of rendered frames
+ */
+
+#include <QHash>
+#include <QMap>
+
+extern "C" {
+#include <libavutil/frame.h>
+#include <libavutil/imgutils.h>
+}
+
+/*!
+ * \brief Memory bounded cache of frames, indexed by sequence position
+ *
+ * Holds frames as they are displayed (scaled, filtered, unoriented) so that
+ * seeking, stepping and replaying can skip decoding. When the memory budget
+ * is exhausted, the least recently used frames are evicted first.
+ */
+class FrameCache
+{
+    QMap<int, AVFrame*> frames;             //!< Ordered, for nearest neighbour lookups
+    QHash<int, quint64> last_used;          //!< Usage stamps for LRU eviction
+    quint64 usage_counter;
+
+    qint64 budget;                          //!< Memory budget in bytes
+    qint64 used;                            //!< Memory in use in bytes
+
+    /*!
+     * \brief Get the memory occupied by a frame's picture
+     */
+    static qint64 FrameSize(const AVFrame* frame);
+
+    /*!
+     * \brief Evict the least recently used frame
+     */
+    void EvictOne();
+
+public:
+    /*!
+     * \brief Create an empty cache
+     * \param budget_bytes Memory budget in bytes
+     */
+    explicit FrameCache(const qint64 budget_bytes);
+    ~FrameCache();
+
+    /*!
+     * \brief Store a frame
+     * \param position Sequence position of the frame
+     * \param frame The frame, ownership is taken over by the cache
+     *
+     * Replaces a frame already stored at this position. Frames that are
+     * larger than the whole budget are freed right away.
+     */
+    void Insert(const int position, AVFrame* frame);
+
+    /*!
+     * \brief Look up the frame at a position
+     * \return The frame (still owned by the cache) or NULL if not cached
+     */
+    AVFrame* Find(const int position);
+
+    /*!
+     * \brief Look up the frame closest to a position
+     * \param position The sequence position to search around
+     * \param max_distance Only consider frames at most this far away
+     * \param found_position Receives the position of the returned frame
+     * \return The frame (still owned by the cache) or NULL if none is close enough
+     */
+    AVFrame* Nearest(const int position, const int max_distance, int* found_position);
+
+    /*!
+     * \brief Check whether a position is cached, without touching its LRU stamp
+     */
+    bool Contains(const int position) const;
+
+    /*!
+     * \brief Free all cached frames
+     */
+    void Clear();
+
+    /*!
+     * \brief Number of cached frames
+     */
+    int Count() const;
+
+    /*!
+     * \brief Memory budget in bytes
+     */
+    qint64 Budget() const;
+};
+
+#endif // FRAMECACHE_H
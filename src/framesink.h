@@ -0,0 +1,59 @@
+#ifndef FRAMESINK_H
+#define FRAMESINK_H
+
+/** \file
+ * FrameSink header
+ * Declares the `FrameSink` interface the engine presents frames through
+ */
+
+#include <QImage>
+
+/*!
+ * \brief A frame as handed from the engine to the display
+ *
+ * The image is stored unoriented; flips and rotation are applied by the
+ * display when drawing it.
+ */
+struct DisplayFrame {
+    QImage image;
+    bool flip_x;
+    bool flip_y;
+    bool rotate_90d_cw;
+};
+
+/*!
+ * \brief Receives the frames the `ZeitEngine` presents
+ *
+ * Keeps the engine independent of how (and whether) frames are shown: the
+ * GUI hands a `TripleBuffer` read by its `GLVideoWidget`, headless users
+ * can hand any other implementation. All methods are called from the
+ * engine's thread only.
+ */
+class FrameSink
+{
+public:
+    virtual ~FrameSink() {}
+
+    /*!
+     * \brief Configure size and format of the frames to come
+     */
+    virtual void Configure(const int width, const int height, const QImage::Format format) = 0;
+
+    /*!
+     * \brief Get the frame to render the next frame into
+     * \return A frame whose image matches the configured geometry
+     */
+    virtual DisplayFrame* BackBuffer() = 0;
+
+    /*!
+     * \brief Hand over the frame last returned by `BackBuffer()`
+     */
+    virtual void Publish() = 0;
+
+    /*!
+     * \brief Number of published frames that were never shown
+     */
+    virtual int SkippedFrames() const { return 0; }
+};
+
+#endif // FRAMESINK_H
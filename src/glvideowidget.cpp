@@ -1,38 +1,329 @@
 #include "glvideowidget.h"
 
+// Draws a full viewport quad; the texture coordinates are derived from the
+// vertex position, swapped for the 90 degree rotation and then flipped.
+static const char* VERTEX_SHADER =
+        "attribute vec2 position;\n"
+        "uniform vec2 flip;\n"
+        "uniform float swap;\n"
+        "varying vec2 texcoord;\n"
+        "void main() {\n"
+        "    vec2 uv = vec2(position.x, -position.y) * 0.5 + 0.5;\n"
+        "    uv = mix(uv, uv.yx, swap);\n"
+        "    texcoord = mix(uv, 1.0 - uv, flip);\n"
+        "    gl_Position = vec4(position, 0.0, 1.0);\n"
+        "}\n";
+
+// Frames are QImage::Format_RGB32 (native endian 0xffRRGGBB), uploaded as
+// plain RGBA bytes, so the channels are put in place with a swizzle. This
+// keeps the upload free of driver side conversions, also on OpenGL ES
+// which lacks GL_BGRA.
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+#define FRAME_SWIZZLE "bgr"
+#else
+#define FRAME_SWIZZLE "gba"
+#endif
+
+static const char* FRAGMENT_SHADER =
+        "#ifdef GL_ES\n"
+        "precision mediump float;\n"
+        "#endif\n"
+        "uniform sampler2D frame;\n"
+        "varying vec2 texcoord;\n"
+        "void main() {\n"
+        "    gl_FragColor = vec4(texture2D(frame, texcoord)." FRAME_SWIZZLE ", 1.0);\n"
+        "}\n";
+
+static const GLfloat QUAD_VERTICES[] = { -1.0f, -1.0f,
+                                          1.0f, -1.0f,
+                                         -1.0f,  1.0f,
+                                          1.0f,  1.0f };
+
 GLVideoWidget::GLVideoWidget(QWidget* parent)
-    : QGLWidget(parent)
+    : QOpenGLWidget(parent),
+      pixel_buffer(QOpenGLBuffer::PixelUnpackBuffer)
 {
-    image = NULL;
     main_window = parent;
     needsReposition = false;
+
+    painter_fallback = true;
+    program = NULL;
+    texture = 0;
+    texture_width = 0;
+    texture_height = 0;
+
+    overlay_enabled = false;
+    memset(&engine_summary, 0, sizeof(engine_summary));
+}
+
+GLVideoWidget::~GLVideoWidget()
+{
+    makeCurrent();
+
+    if(texture != 0) {
+        glDeleteTextures(1, &texture);
+    }
+
+    pixel_buffer.destroy();
+    delete program;
+
+    doneCurrent();
+}
+
+void GLVideoWidget::initializeGL()
+{
+    initializeOpenGLFunctions();
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+
+    if(qgetenv("ZEITMACHINE_DISPLAY") == "painter") {
+        painter_fallback = true;
+    } else {
+        painter_fallback = !InitShaderPath();
+    }
+}
+
+bool GLVideoWidget::InitShaderPath()
+{
+    if(!context()->isValid()) {
+        return false;
+    }
+
+    delete program;
+    program = new QOpenGLShaderProgram();
+
+    if(!program->addShaderFromSourceCode(QOpenGLShader::Vertex, VERTEX_SHADER) ||
+       !program->addShaderFromSourceCode(QOpenGLShader::Fragment, FRAGMENT_SHADER) ||
+       !program->link()) {
+        qWarning() << "Display shader unavailable, drawing with QPainter:" << program->log();
+        delete program;
+        program = NULL;
+        return false;
+    }
+
+    if(texture != 0) {
+        glDeleteTextures(1, &texture);
+    }
+
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    texture_width = 0;
+    texture_height = 0;
+
+    // Pixel unpack buffers need desktop OpenGL 2.1 or OpenGL ES 3.0, without
+    // them we upload straight from the frame's memory instead
+    QSurfaceFormat format = context()->format();
+    bool pixel_buffer_supported = context()->isOpenGLES() ?
+                                  format.majorVersion() >= 3 :
+                                  format.version() >= qMakePair(2, 1);
+
+    pixel_buffer.destroy();
+
+    if(pixel_buffer_supported && pixel_buffer.create()) {
+        pixel_buffer.setUsagePattern(QOpenGLBuffer::StreamDraw);
+    }
+
+    return true;
+}
+
+void GLVideoWidget::UploadFrame(const DisplayFrame* frame)
+{
+    const QImage& image = frame->image;
+    const int size = image.bytesPerLine() * image.height();
+
+    glBindTexture(GL_TEXTURE_2D, texture);
+
+    // 4 byte pixels, so QImage scanlines are tightly packed unpack rows
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    if(image.width() != texture_width || image.height() != texture_height) {
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image.width(), image.height(), 0,
+                     GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+        texture_width = image.width();
+        texture_height = image.height();
+    }
+
+    bool uploaded = false;
+
+    if(pixel_buffer.isCreated()) {
+        pixel_buffer.bind();
+
+        // Re-allocating orphans the storage still in use by the previous
+        // upload, so mapping never has to wait for the driver
+        pixel_buffer.allocate(size);
+
+        void* mapped = pixel_buffer.mapRange(0, size, QOpenGLBuffer::RangeWrite |
+                                                      QOpenGLBuffer::RangeInvalidateBuffer);
+        if(mapped == NULL) {
+            mapped = pixel_buffer.map(QOpenGLBuffer::WriteOnly);
+        }
+
+        if(mapped != NULL) {
+            memcpy(mapped, image.constBits(), size);
+            pixel_buffer.unmap();
+
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, image.width(), image.height(),
+                            GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+            uploaded = true;
+        }
+
+        pixel_buffer.release();
+    }
+
+    if(!uploaded) {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, image.width(), image.height(),
+                        GL_RGBA, GL_UNSIGNED_BYTE, image.constBits());
+    }
 }
 
-void GLVideoWidget::paintEvent(QPaintEvent*)
+void GLVideoWidget::DrawShaderPath(const DisplayFrame* frame)
+{
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, texture);
+
+    program->bind();
+    program->setUniformValue("frame", 0);
+    program->setUniformValue("flip", QVector2D(frame->flip_x ? 1.0f : 0.0f,
+                                               frame->flip_y != frame->rotate_90d_cw ? 1.0f : 0.0f));
+    program->setUniformValue("swap", frame->rotate_90d_cw ? 1.0f : 0.0f);
+
+    program->enableAttributeArray("position");
+    program->setAttributeArray("position", GL_FLOAT, QUAD_VERTICES, 2);
+
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+    program->disableAttributeArray("position");
+    program->release();
+}
+
+void GLVideoWidget::DrawPainterPath(const DisplayFrame* frame)
 {
     QPainter painter(this);
 
-    if(image == NULL) {
-        bounds.setRect(0, 0, this->width(), this->height());
-        painter.fillRect(bounds, QColor(0, 0, 0));
+    const qreal image_width = frame->image.width();
+    const qreal image_height = frame->image.height();
+    const bool flip_t = frame->flip_y != frame->rotate_90d_cw;
+
+    // Map image coordinates to normalized, flipped coordinates ...
+    const qreal scale_s = (frame->flip_x ? -1.0 : 1.0) / image_width;
+    const qreal offset_s = frame->flip_x ? 1.0 : 0.0;
+    const qreal scale_t = (flip_t ? -1.0 : 1.0) / image_height;
+    const qreal offset_t = flip_t ? 1.0 : 0.0;
+
+    // ... and those onto the (possibly rotated) widget
+    QTransform transform;
+
+    if(frame->rotate_90d_cw) {
+        transform = QTransform(0.0, height() * scale_s,
+                               width() * scale_t, 0.0,
+                               width() * offset_t, height() * offset_s);
     } else {
-        image_mutex.lock();
-        pixmap.convertFromImage(*image);
-        painter.drawPixmap(bounds, pixmap, bounds);
-        image_mutex.unlock();
+        transform = QTransform(width() * scale_s, 0.0,
+                               0.0, height() * scale_t,
+                               width() * offset_s, height() * offset_t);
+    }
+
+    painter.fillRect(rect(), QColor(0, 0, 0));
+    painter.setRenderHint(QPainter::SmoothPixmapTransform);
+    painter.setTransform(transform);
+    painter.drawImage(0, 0, frame->image);
+}
+
+void GLVideoWidget::DrawOverlay()
+{
+    PipelineSummary paint_summary;
+    paint_stats.Summarize(&paint_summary);
+
+    QStringList lines;
+
+    lines << QString("Engine %1 fps, display %2 fps")
+             .arg(engine_summary.fps, 0, 'f', 1)
+             .arg(paint_summary.fps, 0, 'f', 1);
+
+    lines << QString("%1 %2 %3 %4 %5")
+             .arg("ms", -8).arg("min", 6).arg("avg", 6).arg("p95", 6).arg("p99", 6);
+
+    for(int stage = 0; stage < ZEIT_STAGE_COUNT; stage++) {
+        const StageSummary& summary = (stage == ZEIT_STAGE_REPAINT) ?
+                                      paint_summary.stages[stage] :
+                                      engine_summary.stages[stage];
+
+        if(summary.samples == 0) {
+            continue;
+        }
+
+        lines << QString("%1 %2 %3 %4 %5")
+                 .arg(PipelineStats::StageName((ZeitStage)stage), -8)
+                 .arg(summary.min, 6, 'f', 1)
+                 .arg(summary.avg, 6, 'f', 1)
+                 .arg(summary.p95, 6, 'f', 1)
+                 .arg(summary.p99, 6, 'f', 1);
+    }
+
+    lines << QString("Cached %1 display, %2 proxy frames")
+             .arg(engine_summary.display_cached)
+             .arg(engine_summary.proxy_cached);
+
+    lines << QString("Skipped %1 frames").arg(engine_summary.skipped_frames);
+
+    QPainter painter(this);
+
+    QFont font("monospace");
+    font.setStyleHint(QFont::TypeWriter);
+    painter.setFont(font);
+
+    const QString text = lines.join('\n');
+    QRect bounds = painter.boundingRect(QRect(10, 10, width(), height()), Qt::AlignLeft | Qt::AlignTop, text);
+
+    painter.fillRect(bounds.adjusted(-5, -5, 5, 5), QColor(0, 0, 0, 160));
+    painter.setPen(QColor(255, 255, 255));
+    painter.drawText(bounds, Qt::AlignLeft | Qt::AlignTop, text);
+}
+
+void GLVideoWidget::paintGL()
+{
+    {
+        StageTimer stage_timer(&paint_stats, ZEIT_STAGE_REPAINT);
+
+        bool fresh;
+        const DisplayFrame* frame = frames.FrontBuffer(&fresh);
+
+        if(fresh) {
+            paint_stats.CountFrame();
+        }
+
+        if(frame == NULL) {
+            glClear(GL_COLOR_BUFFER_BIT);
+        } else if(painter_fallback) {
+            DrawPainterPath(frame);
+        } else {
+            if(fresh || texture_width == 0) {
+                UploadFrame(frame);
+            }
+
+            DrawShaderPath(frame);
+        }
+    }
+
+    if(overlay_enabled) {
+        DrawOverlay();
     }
 }
 
 void GLVideoWidget::ConfigureVideo(const unsigned int width, const unsigned int height, const QImage::Format pixel_format)
 {
-    bounds.setRect(0, 0, width, height);
+    Q_UNUSED(pixel_format); // Frame buffers are configured by the engine itself
 
     setFixedSize(width, height);
 
-    image_mutex.lock();
-    image = new QImage(width, height, pixel_format);
-    image_mutex.unlock();
-
     needsReposition = true;
 }
 
@@ -51,3 +342,18 @@ void GLVideoWidget::DelegateUpdate()
         needsReposition = false;
     }
 }
+
+void GLVideoWidget::UpdateStats(const PipelineSummary summary)
+{
+    engine_summary = summary;
+
+    if(overlay_enabled) {
+        update();
+    }
+}
+
+void GLVideoWidget::ShowOverlay(const bool enabled)
+{
+    overlay_enabled = enabled;
+    update();
+}
@@ -2,31 +2,102 @@
 #define GLVIDEOWIDGET_H
 
 #include <QApplication>
-#include <QGLWidget>
-#include <QMutex>
-#include <QPixmap>
+#include <QDebug>
+#include <QOpenGLBuffer>
+#include <QOpenGLContext>
+#include <QOpenGLFunctions>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLWidget>
+#include <QPainter>
 #include <QStyle>
 #include <QScreen>
+#include <QVector2D>
 
-class GLVideoWidget : public QGLWidget
+#include "pipelinestats.h"
+#include "triplebuffer.h"
+
+/*!
+ * \brief Displays the frames published by the `ZeitEngine`
+ *
+ * Frames are streamed into a persistent texture through a pixel unpack
+ * buffer and drawn as a single textured quad; scaling and orientation are
+ * applied in the shader. If no usable OpenGL context is available (or the
+ * `ZEITMACHINE_DISPLAY` environment variable is set to `painter`) the widget
+ * falls back to drawing through `QPainter`.
+ */
+class GLVideoWidget : public QOpenGLWidget, protected QOpenGLFunctions
 {
     Q_OBJECT
 
     bool needsReposition;
 
     QWidget* main_window;
-    QPixmap pixmap;
-    QRectF bounds;
+
+    bool painter_fallback;          //!< True if drawing through QPainter instead of the shader path
+
+    QOpenGLShaderProgram* program;
+    QOpenGLBuffer pixel_buffer;     //!< Pixel unpack buffer used for streaming, if supported
+    GLuint texture;
+    int texture_width;
+    int texture_height;
+
+    bool overlay_enabled;           //!< True if the performance overlay is drawn
+    PipelineSummary engine_summary; //!< Latest stage timings reported by the engine
+    PipelineStats paint_stats;      //!< Repaint timings, recorded in the GUI thread
+
+    /*!
+     * \brief Compile and link the display shader, set up the streaming texture
+     * \return false if the shader path is not usable and QPainter should be used
+     */
+    bool InitShaderPath();
+
+    /*!
+     * \brief Upload a frame into the streaming texture
+     * \param frame The frame to upload
+     */
+    void UploadFrame(const DisplayFrame* frame);
+
+    /*!
+     * \brief Draw a frame through the shader path
+     * \param frame The frame to draw
+     */
+    void DrawShaderPath(const DisplayFrame* frame);
+
+    /*!
+     * \brief Draw a frame through QPainter
+     * \param frame The frame to draw
+     */
+    void DrawPainterPath(const DisplayFrame* frame);
+
+    /*!
+     * \brief Draw the performance overlay on top of the frame
+     */
+    void DrawOverlay();
+
 public:
-    QMutex image_mutex;
-    QImage* image;
+    /*!
+     * \brief Frames handed over from the engine, see `TripleBuffer`
+     */
+    TripleBuffer frames;
 
     GLVideoWidget(QWidget* parent = NULL);
+    ~GLVideoWidget();
 protected:
-    void paintEvent(QPaintEvent*);
+    void initializeGL();
+    void paintGL();
 public slots:
     void ConfigureVideo(const unsigned int width, const unsigned int height, const QImage::Format pixel_format);
     void DelegateUpdate();
+
+    /*!
+     * \brief Take over the latest stage timings from the engine
+     */
+    void UpdateStats(const PipelineSummary summary);
+
+    /*!
+     * \brief Show or hide the overlay with frame rates, stage timings and cache fill
+     */
+    void ShowOverlay(const bool enabled);
 };
 
 #endif // GLVIDEOWIDGET_H
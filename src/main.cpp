@@ -1,4 +1,5 @@
 #include "mainwindow.h"
+#include "tracer.h"
 #include <QApplication>
 #include <QtPlugin>
 #include <QScreen>
@@ -7,6 +8,9 @@ int main(int argc, char *argv[])
 {
     QApplication application(argc, argv);
 
+    QThread::currentThread()->setObjectName("GUI");
+    Tracer::Init();
+
     MainWindow w;
     w.show();
 
@@ -8,6 +8,7 @@ MainWindow::MainWindow(QWidget *parent) :
     qRegisterMetaType<QFileInfo>("QFileInfo");
     qRegisterMetaType<QFileInfoList>("QFileInfoList");
     qRegisterMetaType<QImage::Format>("QImage::Format");
+    qRegisterMetaType<PipelineSummary>("PipelineSummary");
 
     ui->setupUi(this);
 
@@ -18,6 +19,25 @@ MainWindow::MainWindow(QWidget *parent) :
     progressbar->hide();
     ui->statusbar->addPermanentWidget(progressbar, 100);
 
+    // Timeline on its own row, right above the controls
+    timeline = new QSlider(Qt::Horizontal);
+    timeline->setRange(0, 0);
+    timeline->setToolTip("Drag to scrub through the sequence");
+
+    QToolBar* timelinebar = new QToolBar("Timeline", this);
+    timelinebar->setMovable(false);
+    timelinebar->setFloatable(false);
+    timelinebar->addWidget(timeline);
+
+    insertToolBar(ui->toolbar, timelinebar);
+    insertToolBarBreak(ui->toolbar);
+
+    connect(timeline, &QSlider::valueChanged, this, &MainWindow::SeekTimeline);
+
+    display_position = 0;
+    mark_in = 0;
+    mark_out = -1;
+
     EnableControls(false);
     this->ui->actionSettings->setVisible(false);
     this->ui->actionLoop->setChecked(true);
@@ -25,8 +45,20 @@ MainWindow::MainWindow(QWidget *parent) :
 
     InitializeZeitdiceDirectory();
 
-    zeitengine = new ZeitEngine(videoWidget);
+    // Leave some room around the video on screen
+    QSize screen_size = QApplication::primaryScreen()->availableSize();
+
+    zeitengine = new ZeitEngine(&videoWidget->frames,
+                                std::min((int)(screen_size.width() * 0.66), screen_size.width() - 200),
+                                std::min((int)(screen_size.height() * 0.66), screen_size.height() - 200));
+    // Pick the preview scaler that keeps up on this machine, for each
+    // geometry the footage is displayed at
+    zeitengine->control_mutex.lock();
+    zeitengine->calibrate_scaler_flag = true;
+    zeitengine->control_mutex.unlock();
+
     zeitengine->moveToThread(&engineThread);
+    engineThread.setObjectName("ZeitEngine");
     engineThread.start();
 
     connect(&engineThread, &QThread::finished, zeitengine, &QObject::deleteLater);
@@ -36,12 +68,22 @@ MainWindow::MainWindow(QWidget *parent) :
     connect(zeitengine, &ZeitEngine::ControlsEnabled, this, &MainWindow::EnableControls);
     connect(zeitengine, &ZeitEngine::MessageUpdated, this, &MainWindow::UpdateMessage);
     connect(zeitengine, &ZeitEngine::ProgressUpdated, this, &MainWindow::UpdateProgress);
+    connect(zeitengine, &ZeitEngine::PositionUpdated, this, &MainWindow::UpdatePosition);
+    connect(zeitengine, &ZeitEngine::StatsUpdated, videoWidget, &GLVideoWidget::UpdateStats);
 
     connect(this, &MainWindow::LoadSignal, zeitengine, &ZeitEngine::Load);
     connect(this, &MainWindow::CacheSignal, zeitengine, &ZeitEngine::Cache);
     connect(this, &MainWindow::RefreshSignal, zeitengine, &ZeitEngine::Refresh);
     connect(this, &MainWindow::PlaySignal, zeitengine, &ZeitEngine::Play);
-    connect(this, &MainWindow::ExportSignal, zeitengine, &ZeitEngine::Export);
+
+    // These are thread-safe and must reach the engine while it is busy playing
+    connect(this, &MainWindow::SeekSignal, zeitengine, &ZeitEngine::Seek, Qt::DirectConnection);
+    connect(this, &MainWindow::StepSignal, zeitengine, &ZeitEngine::Step, Qt::DirectConnection);
+    connect(this, &MainWindow::PauseSignal, zeitengine, &ZeitEngine::Pause, Qt::DirectConnection);
+
+    // Queued exports run on engines of their own, next to the preview
+    export_queue = new ExportQueueDialog(zeitengine, this);
+    export_queue->SetBrowseDirectory(persistent_open_dir);
 }
 
 MainWindow::~MainWindow()
@@ -119,6 +161,41 @@ void MainWindow::UpdateProgress(const QString text, const int current, const int
     }
 }
 
+void MainWindow::UpdatePosition(const int position, const int length)
+{
+    display_position = position;
+
+    // Don't fight the user while they drag the timeline
+    if(timeline->isSliderDown()) {
+        return;
+    }
+
+    const QSignalBlocker blocker(timeline);
+
+    timeline->setRange(0, std::max(0, length - 1));
+    timeline->setValue(position);
+}
+
+void MainWindow::SeekTimeline(const int value)
+{
+    emit SeekSignal(value);
+}
+
+void MainWindow::on_actionPause_triggered()
+{
+    emit PauseSignal();
+}
+
+void MainWindow::on_actionStepBackward_triggered()
+{
+    emit StepSignal(-1);
+}
+
+void MainWindow::on_actionStepForward_triggered()
+{
+    emit StepSignal(1);
+}
+
 void MainWindow::on_actionPlay_triggered()
 {
     zeitengine->control_mutex.lock();
@@ -142,6 +219,30 @@ void MainWindow::on_actionStop_triggered()
     zeitengine->control_mutex.unlock();
 }
 
+void MainWindow::on_actionMarkIn_triggered()
+{
+    // Marking the same frame again clears the mark
+    mark_in = (mark_in == display_position) ? 0 : display_position;
+
+    if(mark_out != -1 && mark_out < mark_in) {
+        mark_out = -1;
+    }
+
+    UpdateMessage(QString("Exporting frames %1 to %2").arg(mark_in + 1).arg(mark_out == -1 ? sequence.size() : mark_out + 1));
+}
+
+void MainWindow::on_actionMarkOut_triggered()
+{
+    // Marking the same frame again clears the mark
+    mark_out = (mark_out == display_position) ? -1 : display_position;
+
+    if(mark_out != -1 && mark_out < mark_in) {
+        mark_in = 0;
+    }
+
+    UpdateMessage(QString("Exporting frames %1 to %2").arg(mark_in + 1).arg(mark_out == -1 ? sequence.size() : mark_out + 1));
+}
+
 void MainWindow::on_actionCycleFramerates_triggered()
 {
     QString new_rate_label;
@@ -193,6 +294,68 @@ void MainWindow::on_actionCycleFramerates_triggered()
     ui->statusbar->showMessage("Framerate set to " + new_rate_label);
 }
 
+void MainWindow::on_actionCyclePlayback_triggered()
+{
+    QString new_playback_label;
+    ZeitPlayback new_playback;
+
+    zeitengine->control_mutex.lock();
+
+    switch(zeitengine->playback_flag) {
+
+    case ZEIT_PLAYBACK_FORWARD:
+        new_playback = ZEIT_PLAYBACK_REVERSE;
+        new_playback_label = "reverse";
+        break;
+
+    case ZEIT_PLAYBACK_REVERSE:
+        new_playback = ZEIT_PLAYBACK_PINGPONG;
+        new_playback_label = "ping-pong";
+        break;
+
+    case ZEIT_PLAYBACK_PINGPONG:
+    default:
+        new_playback = ZEIT_PLAYBACK_FORWARD;
+        new_playback_label = "forward";
+        break;
+
+    }
+
+    zeitengine->playback_flag = new_playback;
+
+    zeitengine->control_mutex.unlock();
+
+    ui->statusbar->showMessage("Playback direction set to " + new_playback_label);
+}
+
+void MainWindow::on_actionStatistics_triggered(bool checked)
+{
+    videoWidget->ShowOverlay(checked);
+}
+
+void MainWindow::on_actionCycleSpeeds_triggered()
+{
+    static const float speeds[] = { 0.25f, 0.5f, 1.0f, 2.0f, 4.0f, 8.0f };
+    static const int speed_count = sizeof(speeds) / sizeof(speeds[0]);
+
+    zeitengine->control_mutex.lock();
+
+    int next = 0;
+
+    for(int i = 0; i < speed_count; i++) {
+        if(speeds[i] > zeitengine->speed_flag) {
+            next = i;
+            break;
+        }
+    }
+
+    zeitengine->speed_flag = speeds[next];
+
+    zeitengine->control_mutex.unlock();
+
+    ui->statusbar->showMessage("Playback speed set to " + QString::number(speeds[next]) + "x");
+}
+
 
 void MainWindow::on_actionAbout_triggered()
 {
@@ -247,9 +410,16 @@ void MainWindow::EnableControls(const bool lock)
 {
     this->ui->actionOpen->setEnabled(lock);
     this->ui->actionPlay->setEnabled(lock);
+    this->ui->actionPause->setEnabled(lock);
+    this->ui->actionStepBackward->setEnabled(lock);
+    this->ui->actionStepForward->setEnabled(lock);
     this->ui->actionLoop->setEnabled(lock);
     this->ui->actionStop->setEnabled(lock);
+    this->ui->actionMarkIn->setEnabled(lock);
+    this->ui->actionMarkOut->setEnabled(lock);
     this->ui->actionCycleFramerates->setEnabled(lock);
+    this->ui->actionCyclePlayback->setEnabled(lock);
+    this->ui->actionCycleSpeeds->setEnabled(lock);
     this->ui->actionFlipX->setEnabled(lock);
     this->ui->actionFlipY->setEnabled(lock);
     this->ui->actionRotateCCW->setEnabled(lock);
@@ -259,6 +429,7 @@ void MainWindow::EnableControls(const bool lock)
     this->ui->actionSepia->setEnabled(lock);
     this->ui->actionHipstagram->setEnabled(lock);
     this->ui->actionMovie->setEnabled(lock);
+    timeline->setEnabled(lock);
 }
 
 void MainWindow::on_actionMovie_triggered()
@@ -315,17 +486,21 @@ void MainWindow::on_actionMovie_triggered()
                 }
             }
 
-            EnableControls(false);
-
-            zeitengine->control_mutex.lock();
-            zeitengine->stop_flag = true;
-            zeitengine->control_mutex.unlock();
+            // Exported by an engine of its own, playback and scrubbing go on
+            export_queue->Enqueue(sequence, QFileInfo(export_file), ZEIT_PRIORITY_HIGH, mark_in, mark_out);
+            export_queue->show();
 
-            emit ExportSignal(QFileInfo(export_file));
+            UpdateMessage("Export started in the background ...");
         }
     }
 }
 
+void MainWindow::on_actionQueue_triggered()
+{
+    export_queue->show();
+    export_queue->raise();
+}
+
 void MainWindow::on_actionSettings_triggered()
 {
     settings.show();
@@ -352,24 +527,8 @@ void MainWindow::on_actionOpen_triggered()
         persistent_open_dir.cdUp();
         PersistZeitdiceDirectory(persistent_open_dir);
 
-        QDir dir = QDir(dir_name);
-
         // Filter all supported footage from the opened folder
-
-        dir.setFilter(QDir::Files);
-
-        QStringList image_extension_filters{"*.jpg","*.jpeg","*.png", "*.zd"};
-        dir.setNameFilters(image_extension_filters);
-
-        QFileInfoList files = dir.entryInfoList();
-
-        // Remove 0 byte images
-        QMutableListIterator<QFileInfo> files_iterator(files);
-        while(files_iterator.hasNext()) {
-            if(files_iterator.next().size() == 0) {
-                files_iterator.remove();
-            }
-        }
+        QFileInfoList files = ZeitEngine::FindSequence(QDir(dir_name));
 
         // Break and gracefully stop if there is no supported footage available now
         if(files.empty()) {
@@ -379,17 +538,6 @@ void MainWindow::on_actionOpen_triggered()
             return;
         }
 
-        // Naturally sort the images by filename
-
-        QCollator collator;
-        collator.setNumericMode(true);
-        collator.setCaseSensitivity(Qt::CaseInsensitive);
-
-        std::sort(files.begin(), files.end(), [&](const QFileInfo& a, const QFileInfo& b) {
-
-            return collator.compare(a.baseName(), b.baseName()) < 0;
-        });
-
         // Stop all zeitengine activity and reset all flags
         zeitengine->control_mutex.lock();
         zeitengine->flip_x_flag = true;
@@ -397,6 +545,8 @@ void MainWindow::on_actionOpen_triggered()
         zeitengine->rotate_90d_cw_flag = false;
         zeitengine->filter_flag = ZEIT_FILTER_NONE;
         zeitengine->configured_framerate = ZEIT_RATE_24p;
+        zeitengine->playback_flag = ZEIT_PLAYBACK_FORWARD;
+        zeitengine->speed_flag = 1.0f;
         zeitengine->stop_flag = true;
         zeitengine->control_mutex.unlock();
 
@@ -404,6 +554,11 @@ void MainWindow::on_actionOpen_triggered()
         EnableControls(true);
         UncheckOtherFilters(NULL);
 
+        sequence = files;
+        display_position = 0;
+        mark_in = 0;
+        mark_out = -1;
+
         // Send the list of files to the zeitengine
         emit LoadSignal(files);
     }
@@ -7,9 +7,12 @@
 #include <QMessageBox>
 #include <QMainWindow>
 #include <QProgressBar>
+#include <QSlider>
 #include <QThread>
+#include <QToolBar>
 
 #include "aboutdialog.h"
+#include "exportqueuedialog.h"
 #include "settingsdialog.h"
 #include "glvideowidget.h"
 #include "zeitengine.h"
@@ -26,15 +29,22 @@ class MainWindow : public QMainWindow
 
     AboutDialog about;
     SettingsDialog settings;
+    ExportQueueDialog *export_queue;
 
     GLVideoWidget *videoWidget;
     QProgressBar *progressbar;
+    QSlider *timeline;
 
     ZeitEngine *zeitengine;
     QThread engineThread;
 
     QDir persistent_open_dir;
 
+    QFileInfoList sequence;     //!< The footage on display, exported on request
+    int display_position;       //!< Position of the frame on display
+    int mark_in;                //!< First position to export
+    int mark_out;               //!< Last position to export, -1 for the end
+
     /*!
      * \brief Disable other filter actions but the one passed on
      * \param The one single filter action that should not be disabled
@@ -52,7 +62,9 @@ signals:
     void CacheSignal();
     void RefreshSignal();
     void PlaySignal();
-    void ExportSignal(const QFileInfo file);
+    void SeekSignal(const int position);
+    void StepSignal(const int frames);
+    void PauseSignal();
 public slots:
     void EnableControls(const bool lock);
     void UpdateMessage(const QString text);
@@ -67,23 +79,40 @@ public slots:
      * If current and total are equal but > 0, hides the progress bar
      */
     void UpdateProgress(const QString text, const int current, const int total);
+
+    /*!
+     * \brief Move the timeline to the position on display
+     * \param position Position of the frame on display
+     * \param length Number of frames in the sequence
+     */
+    void UpdatePosition(const int position, const int length);
 private slots:
     void on_actionAbout_triggered();
     void on_actionPlay_triggered();
+    void on_actionPause_triggered();
+    void on_actionStepBackward_triggered();
+    void on_actionStepForward_triggered();
     void on_actionStop_triggered();
+    void on_actionMarkIn_triggered();
+    void on_actionMarkOut_triggered();
     void on_actionLoop_triggered();
     void on_actionCycleFramerates_triggered();
+    void on_actionCyclePlayback_triggered();
+    void on_actionCycleSpeeds_triggered();
+    void on_actionStatistics_triggered(bool checked);
     void on_actionVignette_triggered(bool checked);
     void on_actionBlackWhite_triggered(bool checked);
     void on_actionSepia_triggered(bool checked);
     void on_actionHipstagram_triggered(bool checked);
     void on_actionMovie_triggered();
+    void on_actionQueue_triggered();
     void on_actionSettings_triggered();
     void on_actionOpen_triggered();
     void on_actionFlipX_triggered();
     void on_actionFlipY_triggered();
     void on_actionRotateCCW_triggered();
     void on_actionRotateCW_triggered();
+    void SeekTimeline(const int value);
 };
 
 #endif // MAINWINDOW_H
@@ -0,0 +1,143 @@
+#include "pipelinestats.h"
+#include "tracer.h"
+
+#include <algorithm>
+
+PipelineStats::PipelineStats()
+{
+    clock.start();
+    Reset();
+}
+
+void PipelineStats::Record(const ZeitStage stage, const qint64 nsecs)
+{
+    samples[stage][next_sample[stage]] = nsecs;
+    next_sample[stage] = (next_sample[stage] + 1) % WINDOW;
+    sample_count[stage] = std::min(sample_count[stage] + 1, WINDOW);
+}
+
+void PipelineStats::CountFrame()
+{
+    frame_stamps[next_frame] = clock.nsecsElapsed();
+    next_frame = (next_frame + 1) % WINDOW;
+    frame_count = std::min(frame_count + 1, WINDOW);
+}
+
+void PipelineStats::Reset()
+{
+    for(int stage = 0; stage < ZEIT_STAGE_COUNT; stage++) {
+        sample_count[stage] = 0;
+        next_sample[stage] = 0;
+    }
+
+    frame_count = 0;
+    next_frame = 0;
+}
+
+void PipelineStats::Take(PipelineStats* other)
+{
+    for(int stage = 0; stage < ZEIT_STAGE_COUNT; stage++) {
+        const int count = other->sample_count[stage];
+        const int oldest = (other->next_sample[stage] + WINDOW - count) % WINDOW;
+
+        for(int i = 0; i < count; i++) {
+            Record((ZeitStage)stage, other->samples[stage][(oldest + i) % WINDOW]);
+        }
+
+        other->sample_count[stage] = 0;
+        other->next_sample[stage] = 0;
+    }
+}
+
+void PipelineStats::Summarize(PipelineSummary* summary) const
+{
+    qint64 sorted[WINDOW];
+
+    for(int stage = 0; stage < ZEIT_STAGE_COUNT; stage++) {
+        StageSummary* stage_summary = &summary->stages[stage];
+        const int count = sample_count[stage];
+
+        stage_summary->samples = count;
+
+        if(count == 0) {
+            stage_summary->min = 0.0f;
+            stage_summary->avg = 0.0f;
+            stage_summary->p95 = 0.0f;
+            stage_summary->p99 = 0.0f;
+            continue;
+        }
+
+        // The ring is only filled from the start until it wraps, so the
+        // first `count` samples are always the valid ones
+        std::copy(samples[stage], samples[stage] + count, sorted);
+        std::sort(sorted, sorted + count);
+
+        qint64 total = 0;
+
+        for(int i = 0; i < count; i++) {
+            total += sorted[i];
+        }
+
+        stage_summary->min = sorted[0] / 1e6f;
+        stage_summary->avg = total / (count * 1e6f);
+        stage_summary->p95 = sorted[(count * 95 - 1) / 100] / 1e6f;
+        stage_summary->p99 = sorted[(count * 99 - 1) / 100] / 1e6f;
+    }
+
+    summary->fps = 0.0f;
+
+    if(frame_count > 1) {
+        const qint64 newest = frame_stamps[(next_frame + WINDOW - 1) % WINDOW];
+        const qint64 oldest = frame_stamps[(next_frame + WINDOW - frame_count) % WINDOW];
+
+        if(newest > oldest) {
+            summary->fps = (frame_count - 1) * 1e9f / (newest - oldest);
+        }
+    }
+}
+
+const char* PipelineStats::StageName(const ZeitStage stage)
+{
+    switch(stage) {
+
+    case ZEIT_STAGE_DECODE:
+        return "Decode";
+
+    case ZEIT_STAGE_DEBAYER:
+        return "Debayer";
+
+    case ZEIT_STAGE_SCALE:
+        return "Scale";
+
+    case ZEIT_STAGE_FILTER:
+        return "Filter";
+
+    case ZEIT_STAGE_PRESENT:
+        return "Present";
+
+    case ZEIT_STAGE_ENCODE:
+        return "Encode";
+
+    case ZEIT_STAGE_REPAINT:
+        return "Repaint";
+
+    default:
+        return "";
+    }
+}
+
+StageTimer::StageTimer(PipelineStats* stats, const ZeitStage stage)
+{
+    this->stats = stats;
+    this->stage = stage;
+
+    Tracer::Begin(PipelineStats::StageName(stage));
+    timer.start();
+}
+
+StageTimer::~StageTimer()
+{
+    stats->Record(stage, timer.nsecsElapsed());
+
+    Tracer::End(PipelineStats::StageName(stage));
+}
@@ -0,0 +1,129 @@
+#ifndef PIPELINESTATS_H
+#define PIPELINESTATS_H
+
+/** \file
+ * PipelineStats header
+ * Declares the `PipelineStats` class for timing the stages of the pipeline
+ */
+
+#include <QElapsedTimer>
+#include <QMetaType>
+
+/*!
+ * \brief Identifies a timed stage of the frame pipeline
+ */
+enum ZeitStage {
+    ZEIT_STAGE_DECODE,
+    ZEIT_STAGE_DEBAYER,
+    ZEIT_STAGE_SCALE,
+    ZEIT_STAGE_FILTER,
+    ZEIT_STAGE_PRESENT,
+    ZEIT_STAGE_ENCODE,
+    ZEIT_STAGE_REPAINT,
+    ZEIT_STAGE_COUNT
+};
+
+/*!
+ * \brief Timings of a single stage over the recent frames, in ms
+ */
+struct StageSummary {
+    int samples;
+    float min;
+    float avg;
+    float p95;
+    float p99;
+};
+
+/*!
+ * \brief Snapshot of the pipeline's recent performance
+ */
+struct PipelineSummary {
+    StageSummary stages[ZEIT_STAGE_COUNT];
+    float fps;              //!< Frames completed per second
+    int display_cached;     //!< Frames in the display cache
+    int proxy_cached;       //!< Frames in the proxy cache
+    int skipped_frames;     //!< Published frames the display never got to show
+};
+
+Q_DECLARE_METATYPE(PipelineSummary)
+
+/*!
+ * \brief Rolling per-stage timings of the frame pipeline
+ *
+ * Keeps the last `WINDOW` samples of each stage in fixed ring buffers, so
+ * recording is a store and nothing is allocated while running; sorting for
+ * the percentiles only happens when a summary is requested. Not thread-safe,
+ * each thread records into its own instance.
+ */
+class PipelineStats
+{
+    const static int WINDOW = 256;              //!< Samples kept per stage
+
+    qint64 samples[ZEIT_STAGE_COUNT][WINDOW];   //!< Durations in ns
+    int sample_count[ZEIT_STAGE_COUNT];
+    int next_sample[ZEIT_STAGE_COUNT];
+
+    QElapsedTimer clock;
+    qint64 frame_stamps[WINDOW];                //!< Completion times of the recent frames in ns
+    int frame_count;
+    int next_frame;
+
+public:
+    PipelineStats();
+
+    /*!
+     * \brief Record the duration of a stage
+     * \param stage The stage
+     * \param nsecs Duration in ns
+     */
+    void Record(const ZeitStage stage, const qint64 nsecs);
+
+    /*!
+     * \brief Record the completion of a frame, for the frame rate
+     */
+    void CountFrame();
+
+    /*!
+     * \brief Forget all samples
+     */
+    void Reset();
+
+    /*!
+     * \brief Move the stage samples of another instance over, oldest first
+     *
+     * For threads that record into their own instance, called on the thread
+     * of this one while the other thread is idle.
+     */
+    void Take(PipelineStats* other);
+
+    /*!
+     * \brief Summarize the recorded samples
+     * \param summary Receives min/avg/p95/p99 of every stage and the frame rate
+     *
+     * Cache and display counters are left untouched for the caller to fill in.
+     */
+    void Summarize(PipelineSummary* summary) const;
+
+    /*!
+     * \brief Human readable name of a stage
+     */
+    static const char* StageName(const ZeitStage stage);
+};
+
+/*!
+ * \brief Times its own scope and records it as a stage in `PipelineStats`
+ *
+ * The scope is traced as a span as well, see `Tracer`.
+ */
+class StageTimer
+{
+    PipelineStats* stats;
+    ZeitStage stage;
+    QElapsedTimer timer;
+
+public:
+    StageTimer(PipelineStats* stats, const ZeitStage stage);
+    ~StageTimer();
+};
+
+#endif // PIPELINESTATS_H
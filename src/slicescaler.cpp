@@ -0,0 +1,235 @@
+#include "slicescaler.h"
+
+#include <QRunnable>
+#include <QSemaphore>
+
+#include <algorithm>
+
+/*!
+ * \brief Converts one band of a `SliceScaler` on the pool
+ */
+class SliceTask : public QRunnable
+{
+    SliceScaler* scaler;
+    int index;
+    const uint8_t * const *source;
+    const int *source_linesize;
+    uint8_t * const *target;
+    const int *target_linesize;
+    QSemaphore* done;
+
+public:
+    SliceTask(SliceScaler* scaler,
+              const int index,
+              const uint8_t * const source[],
+              const int source_linesize[],
+              uint8_t * const target[],
+              const int target_linesize[],
+              QSemaphore* done)
+    {
+        this->scaler = scaler;
+        this->index = index;
+        this->source = source;
+        this->source_linesize = source_linesize;
+        this->target = target;
+        this->target_linesize = target_linesize;
+        this->done = done;
+    }
+
+    void run()
+    {
+        scaler->ScaleSlice(index, source, source_linesize, target, target_linesize);
+        done->release();
+    }
+};
+
+SliceScaler::SliceScaler()
+{
+    source_height = 0;
+    source_format = AV_PIX_FMT_NONE;
+    target_width = 0;
+    target_format = AV_PIX_FMT_NONE;
+    pool = NULL;
+}
+
+SliceScaler::~SliceScaler()
+{
+    Free();
+}
+
+bool SliceScaler::Init(const int source_width,
+                       const int source_height,
+                       const AVPixelFormat source_format,
+                       const int target_width,
+                       const int target_height,
+                       const AVPixelFormat target_format,
+                       const int flags,
+                       QThreadPool* pool,
+                       const int max_slices)
+{
+    Free();
+
+    this->pool = pool;
+    this->source_height = source_height;
+    this->source_format = source_format;
+    this->target_width = target_width;
+    this->target_format = target_format;
+
+    const AVPixFmtDescriptor* source_desc = av_pix_fmt_desc_get(source_format);
+    const AVPixFmtDescriptor* target_desc = av_pix_fmt_desc_get(target_format);
+
+    if(source_desc == NULL || target_desc == NULL || target_height <= 0) {
+        return false;
+    }
+
+    // Bands line up with source rows only at whole ratios, and palettes or
+    // packed bits have no rows of their own to start a band at
+    const int unsliceable = AV_PIX_FMT_FLAG_PAL | AV_PIX_FMT_FLAG_BITSTREAM;
+    bool sliceable = (source_height % target_height == 0)
+                     && !(source_desc->flags & unsliceable)
+                     && !(target_desc->flags & unsliceable);
+
+    int count = (max_slices > 0) ? max_slices : pool->maxThreadCount();
+    count = std::min(count, target_height / (int)MIN_SLICE_ROWS);
+
+    if(!sliceable || count < 2) {
+        Slice slice;
+        slice.context = sws_getContext(source_width, source_height, source_format,
+                                       target_width, target_height, target_format,
+                                       flags, NULL, NULL, NULL);
+        slice.src_y = 0;
+        slice.src_h = source_height;
+        slice.dst_y = 0;
+        slice.core_y = 0;
+        slice.core_h = target_height;
+        slice.data[0] = NULL;
+
+        if(slice.context == NULL) {
+            return false;
+        }
+
+        slices.append(slice);
+        return true;
+    }
+
+    const int ratio = source_height / target_height;
+
+    for(int i = 0; i < count; i++) {
+        const int core_y = (i * target_height / count) / ALIGN_ROWS * ALIGN_ROWS;
+        const int core_end = (i == count - 1) ? target_height : ((i + 1) * target_height / count) / ALIGN_ROWS * ALIGN_ROWS;
+
+        const int dst_y = std::max(0, core_y - (int)MARGIN_ROWS);
+        const int dst_end = std::min(target_height, core_end + (int)MARGIN_ROWS);
+
+        Slice slice;
+        slice.src_y = dst_y * ratio;
+        slice.src_h = (dst_end - dst_y) * ratio;
+        slice.dst_y = dst_y;
+        slice.core_y = core_y;
+        slice.core_h = core_end - core_y;
+        slice.data[0] = NULL;
+
+        slice.context = sws_getContext(source_width, slice.src_h, source_format,
+                                       target_width, dst_end - dst_y, target_format,
+                                       flags, NULL, NULL, NULL);
+        if(slice.context == NULL) {
+            Free();
+            return false;
+        }
+
+        if(av_image_alloc(slice.data, slice.linesize, target_width, dst_end - dst_y, target_format, 32) < 0) {
+            sws_freeContext(slice.context);
+            Free();
+            return false;
+        }
+
+        slices.append(slice);
+    }
+
+    return true;
+}
+
+void SliceScaler::ScaleSlice(const int index,
+                             const uint8_t * const source[],
+                             const int source_linesize[],
+                             uint8_t * const target[],
+                             const int target_linesize[])
+{
+    const Slice& slice = slices.at(index);
+
+    if(slice.data[0] == NULL) {
+        sws_scale(slice.context, source, source_linesize, 0, source_height, target, target_linesize);
+        return;
+    }
+
+    const AVPixFmtDescriptor* source_desc = av_pix_fmt_desc_get(source_format);
+    const AVPixFmtDescriptor* target_desc = av_pix_fmt_desc_get(target_format);
+
+    // Planes 1 and 2 hold chroma, subsampled in YUV formats
+    const uint8_t* band_source[4] = { NULL, NULL, NULL, NULL };
+
+    for(int p = 0; p < 4; p++) {
+        if(source[p] != NULL) {
+            int shift = (p == 1 || p == 2) ? source_desc->log2_chroma_h : 0;
+            band_source[p] = source[p] + (slice.src_y >> shift) * source_linesize[p];
+        }
+    }
+
+    sws_scale(slice.context, band_source, source_linesize, 0, slice.src_h, slice.data, slice.linesize);
+
+    const int planes = av_pix_fmt_count_planes(target_format);
+
+    for(int p = 0; p < planes; p++) {
+        int shift = (p == 1 || p == 2) ? target_desc->log2_chroma_h : 0;
+
+        // Rounded up at the end, for the last chroma row of odd heights
+        int first = slice.core_y >> shift;
+        int end = -((-(slice.core_y + slice.core_h)) >> shift);
+
+        av_image_copy_plane(target[p] + first * target_linesize[p],
+                            target_linesize[p],
+                            slice.data[p] + (first - (slice.dst_y >> shift)) * slice.linesize[p],
+                            slice.linesize[p],
+                            av_image_get_linesize(target_format, target_width, p),
+                            end - first);
+    }
+}
+
+void SliceScaler::Scale(const uint8_t * const source[],
+                        const int source_linesize[],
+                        uint8_t * const target[],
+                        const int target_linesize[])
+{
+    if(slices.size() == 1) {
+        ScaleSlice(0, source, source_linesize, target, target_linesize);
+        return;
+    }
+
+    QSemaphore done;
+
+    for(int i = 1; i < slices.size(); i++) {
+        pool->start(new SliceTask(this, i, source, source_linesize, target, target_linesize, &done));
+    }
+
+    ScaleSlice(0, source, source_linesize, target, target_linesize);
+
+    done.acquire(slices.size() - 1);
+}
+
+void SliceScaler::Free()
+{
+    for(int i = 0; i < slices.size(); i++) {
+        sws_freeContext(slices[i].context);
+
+        if(slices[i].data[0] != NULL) {
+            av_freep(&slices[i].data[0]);
+        }
+    }
+
+    slices.clear();
+}
+
+int SliceScaler::Slices() const
+{
+    return slices.size();
+}
@@ -0,0 +1,120 @@
+#ifndef SLICESCALER_H
+#define SLICESCALER_H
+
+/** \file
+ * SliceScaler header
+ * Declares the `SliceScaler` class, converting frames in parallel bands
+ */
+
+#include <QThreadPool>
+#include <QVector>
+
+extern "C" {
+#include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
+#include <libswscale/swscale.h>
+}
+
+/*!
+ * \brief Scales and converts pictures in horizontal bands on a caller's pool
+ *
+ * libswscale only ever works through a picture from top to bottom, so a
+ * single context keeps one core busy. Here every band of output rows gets a
+ * context of its own, set up for the band plus `MARGIN_ROWS` rows of context
+ * above and below, so the filter taps of the band's rows see exactly the
+ * source rows they would see in a full picture. Bands start on multiples of
+ * `ALIGN_ROWS`, which keeps chroma rows and the dither pattern in phase. The
+ * bands are written to scratch pictures and their rows copied over, making
+ * the result bit-identical to a single context.
+ *
+ * That only holds if source rows map to output rows at a whole ratio (same
+ * height or an integer downscale); other conversions and small pictures
+ * run as a single context, writing straight into the output.
+ *
+ * The pool comes from the caller, usually its engine's, and bounds the
+ * bands: an export's pool holds its share of the cores, and its threads
+ * have the priority of the thread that started them.
+ */
+class SliceScaler
+{
+    friend class SliceTask;     //!< Runs a band on the pool
+
+    const static int ALIGN_ROWS = 16;       //!< Bands start on multiples of this many output rows
+    const static int MARGIN_ROWS = 16;      //!< Output rows of context around each band, beyond any filter's reach
+    const static int MIN_SLICE_ROWS = 64;   //!< Smaller bands cost more in margins and handover than they gain
+
+    /*!
+     * \brief A band of output rows and its context
+     */
+    struct Slice {
+        SwsContext *context;
+        int src_y;          //!< First source row the context sees
+        int src_h;
+        int dst_y;          //!< First output row the context writes
+        int core_y;         //!< First output row of the band proper
+        int core_h;         //!< Output rows of the band proper
+        uint8_t *data[4];   //!< Scratch picture for the context's rows, unused for a single slice
+        int linesize[4];
+    };
+
+    QVector<Slice> slices;
+    QThreadPool* pool;
+
+    int source_height;
+    AVPixelFormat source_format;
+    int target_width;
+    AVPixelFormat target_format;
+
+    /*!
+     * \brief Convert one band and copy its rows to the output
+     */
+    void ScaleSlice(const int index,
+                    const uint8_t * const source[],
+                    const int source_linesize[],
+                    uint8_t * const target[],
+                    const int target_linesize[]);
+
+public:
+    SliceScaler();
+    ~SliceScaler();
+
+    /*!
+     * \brief Set up the contexts for a conversion
+     * \param flags Scaling algorithm, see `SWS_BILINEAR` etc.
+     * \param pool Runs the bands besides the one of the calling thread
+     * \param max_slices Most bands to split into, 0 for one per thread of `pool`
+     * \return false if libswscale does not support the conversion
+     */
+    bool Init(const int source_width,
+              const int source_height,
+              const AVPixelFormat source_format,
+              const int target_width,
+              const int target_height,
+              const AVPixelFormat target_format,
+              const int flags,
+              QThreadPool* pool,
+              const int max_slices = 0);
+
+    /*!
+     * \brief Convert a whole picture, like `sws_scale()` with a single slice
+     *
+     * Returns once all bands are done; the calling thread converts one of
+     * them itself.
+     */
+    void Scale(const uint8_t * const source[],
+               const int source_linesize[],
+               uint8_t * const target[],
+               const int target_linesize[]);
+
+    /*!
+     * \brief Free all contexts and scratch pictures
+     */
+    void Free();
+
+    /*!
+     * \brief Number of bands conversions are split into
+     */
+    int Slices() const;
+};
+
+#endif // SLICESCALER_H
@@ -0,0 +1,190 @@
+#include "tracer.h"
+
+QAtomicInt Tracer::enabled(0);
+QString Tracer::output_path;
+QElapsedTimer Tracer::clock;
+
+QMutex Tracer::registry_mutex;
+QList<Tracer::ThreadBuffer*> Tracer::registry;
+QList<Tracer::ThreadBuffer*> Tracer::free_buffers;
+int Tracer::next_thread_id = 1;
+
+thread_local Tracer::ThreadBuffer* Tracer::local_buffer = NULL;
+QThreadStorage<Tracer::ThreadSlot*> Tracer::thread_slots;
+
+Tracer::ThreadSlot::~ThreadSlot()
+{
+    // Runs on the exiting thread, nothing records into the buffer after this
+    local_buffer = NULL;
+
+    registry_mutex.lock();
+    buffer->finished = true;
+    registry_mutex.unlock();
+}
+
+void Tracer::Init()
+{
+    QByteArray path = qgetenv("ZEITMACHINE_TRACE");
+
+    if(path.isEmpty()) {
+        return;
+    }
+
+    output_path = QString::fromLocal8Bit(path);
+    clock.start();
+    enabled.storeRelease(1);
+}
+
+bool Tracer::IsEnabled()
+{
+    return enabled.loadAcquire() != 0;
+}
+
+Tracer::ThreadBuffer* Tracer::LocalBuffer()
+{
+    if(local_buffer == NULL) {
+        registry_mutex.lock();
+
+        ThreadBuffer* buffer = free_buffers.isEmpty() ? new ThreadBuffer : free_buffers.takeLast();
+
+        buffer->count.storeRelease(0);
+        buffer->dropped.storeRelease(0);
+        buffer->thread_id = next_thread_id++;
+        buffer->thread_name = QThread::currentThread()->objectName();
+        buffer->finished = false;
+
+        registry.append(buffer);
+        registry_mutex.unlock();
+
+        ThreadSlot* slot = new ThreadSlot;
+        slot->buffer = buffer;
+        thread_slots.setLocalData(slot);
+
+        local_buffer = buffer;
+    }
+
+    return local_buffer;
+}
+
+void Tracer::Record(const char* name, const char phase, const int frame)
+{
+    ThreadBuffer* buffer = LocalBuffer();
+
+    // Only this thread ever writes the buffer, the count is published after
+    // the event so a concurrent dump never reads a half written one
+    const int index = buffer->count.load();
+
+    if(index >= THREAD_CAPACITY) {
+        buffer->dropped.fetchAndAddRelaxed(1);
+        return;
+    }
+
+    Event& event = buffer->events[index];
+    event.name = name;
+    event.timestamp = clock.nsecsElapsed();
+    event.frame = frame;
+    event.phase = phase;
+
+    buffer->count.storeRelease(index + 1);
+}
+
+void Tracer::Begin(const char* name, const int frame)
+{
+    if(IsEnabled()) {
+        Record(name, 'B', frame);
+    }
+}
+
+void Tracer::End(const char* name, const int frame)
+{
+    if(IsEnabled()) {
+        Record(name, 'E', frame);
+    }
+}
+
+bool Tracer::Dump()
+{
+    if(!IsEnabled()) {
+        return false;
+    }
+
+    // Held for the whole write, engines of queued exports may dump at the same time
+    registry_mutex.lock();
+
+    QFile file(output_path);
+
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        registry_mutex.unlock();
+        return false;
+    }
+
+    QTextStream stream(&file);
+    bool first = true;
+
+    stream << "{\"traceEvents\":[\n";
+
+    for(int i = 0; i < registry.size(); i++) {
+        const ThreadBuffer* buffer = registry.at(i);
+        const int count = buffer->count.loadAcquire();
+        const int dropped = buffer->dropped.loadAcquire();
+
+        QString thread_name = buffer->thread_name.isEmpty() ?
+                              QString("Thread %1").arg(buffer->thread_id) :
+                              buffer->thread_name;
+
+        if(dropped > 0) {
+            thread_name += QString(" (%1 events dropped)").arg(dropped);
+        }
+
+        stream << (first ? "" : ",\n")
+               << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->thread_id
+               << ",\"args\":{\"name\":\"" << thread_name << "\"}}";
+        first = false;
+
+        for(int j = 0; j < count; j++) {
+            const Event& event = buffer->events[j];
+
+            stream << ",\n{\"name\":\"" << event.name
+                   << "\",\"ph\":\"" << event.phase
+                   << "\",\"ts\":" << QString::number(event.timestamp / 1000.0, 'f', 3)
+                   << ",\"pid\":1,\"tid\":" << buffer->thread_id;
+
+            if(event.frame >= 0) {
+                stream << ",\"args\":{\"frame\":" << event.frame << "}";
+            }
+
+            stream << "}";
+        }
+    }
+
+    stream << "\n]}\n";
+    stream.flush();
+
+    bool written = stream.status() == QTextStream::Ok;
+
+    // Finished threads are in the trace now, their buffers can serve new ones
+    if(written) {
+        for(int i = registry.size() - 1; i >= 0; i--) {
+            if(registry.at(i)->finished) {
+                free_buffers.append(registry.takeAt(i));
+            }
+        }
+    }
+
+    registry_mutex.unlock();
+
+    return written;
+}
+
+TraceScope::TraceScope(const char* name, const int frame)
+{
+    this->name = name;
+    this->frame = frame;
+
+    Tracer::Begin(name, frame);
+}
+
+TraceScope::~TraceScope()
+{
+    Tracer::End(name, frame);
+}
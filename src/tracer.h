@@ -0,0 +1,133 @@
+#ifndef TRACER_H
+#define TRACER_H
+
+/** \file
+ * Tracer header
+ * Declares the `Tracer` class, recording a timeline of the pipeline stages
+ */
+
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QList>
+#include <QMutex>
+#include <QString>
+#include <QTextStream>
+#include <QThread>
+#include <QThreadStorage>
+
+/*!
+ * \brief Records begin/end events of all threads as a Chrome trace
+ *
+ * Tracing is opt-in: it is enabled by setting the `ZEITMACHINE_TRACE`
+ * environment variable to the path of the file to write, which can be
+ * opened in Perfetto or chrome://tracing. When disabled, recording an event
+ * costs a single atomic load.
+ *
+ * Every thread appends to its own fixed size buffer, so recording takes
+ * no lock and never allocates; the shared registry is only locked once per
+ * thread and while dumping. Events beyond a thread's capacity are dropped
+ * (and counted) rather than blocking the thread.
+ *
+ * Pool threads expire and are recreated for as long as the application
+ * runs. The buffer of a finished thread is written by the next dump, then
+ * leaves the registry, so later dumps lack its events, and is reused by the
+ * next thread that traces. Memory stays bounded by the threads running at
+ * the same time.
+ */
+class Tracer
+{
+    const static int THREAD_CAPACITY = 65536;   //!< Events stored per thread
+
+    struct Event {
+        const char* name;   //!< Static string, not copied
+        qint64 timestamp;   //!< ns since tracing started
+        int frame;          //!< Sequence position, -1 if not frame related
+        char phase;         //!< 'B' for begin, 'E' for end
+    };
+
+    struct ThreadBuffer {
+        Event events[THREAD_CAPACITY];
+        QAtomicInt count;           //!< Events written, released after each write
+        QAtomicInt dropped;         //!< Events lost to a full buffer
+        int thread_id;
+        QString thread_name;
+        bool finished;              //!< The thread exited, guarded by `registry_mutex`
+    };
+
+    /*!
+     * \brief Hands a thread's buffer back when the thread exits
+     */
+    struct ThreadSlot {
+        ThreadBuffer* buffer;
+        ~ThreadSlot();
+    };
+
+    static QAtomicInt enabled;
+    static QString output_path;
+    static QElapsedTimer clock;
+
+    static QMutex registry_mutex;
+    static QList<ThreadBuffer*> registry;       //!< Buffers of running threads and of finished ones not dumped yet
+    static QList<ThreadBuffer*> free_buffers;   //!< Buffers of finished threads, dumped and ready for reuse
+    static int next_thread_id;
+
+    static thread_local ThreadBuffer* local_buffer;
+    static QThreadStorage<ThreadSlot*> thread_slots;    //!< Only to learn when threads exit
+
+    /*!
+     * \brief Get the calling thread's buffer, registering it on first use
+     */
+    static ThreadBuffer* LocalBuffer();
+
+    static void Record(const char* name, const char phase, const int frame);
+
+public:
+    /*!
+     * \brief Enable tracing if requested through `ZEITMACHINE_TRACE`
+     *
+     * Call once at startup, before any other thread traces.
+     */
+    static void Init();
+
+    /*!
+     * \brief Whether events are being recorded
+     */
+    static bool IsEnabled();
+
+    /*!
+     * \brief Record the beginning of a span
+     * \param name Static name of the span
+     * \param frame Sequence position the span works on, -1 if none
+     */
+    static void Begin(const char* name, const int frame = -1);
+
+    /*!
+     * \brief Record the end of the innermost span begun by this thread
+     */
+    static void End(const char* name, const int frame = -1);
+
+    /*!
+     * \brief Write all events recorded so far to the configured trace file
+     * \return false if tracing is disabled or the file could not be written
+     *
+     * Safe to call while other threads keep recording; events recorded
+     * during the dump may or may not be part of it.
+     */
+    static bool Dump();
+};
+
+/*!
+ * \brief Traces its own scope as a span
+ */
+class TraceScope
+{
+    const char* name;
+    int frame;
+
+public:
+    TraceScope(const char* name, const int frame = -1);
+    ~TraceScope();
+};
+
+#endif // TRACER_H
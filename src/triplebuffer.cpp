@@ -0,0 +1,90 @@
+#include "triplebuffer.h"
+
+TripleBuffer::TripleBuffer()
+{
+    for(int i = 0; i < 3; i++) {
+        buffers[i].flip_x = false;
+        buffers[i].flip_y = false;
+        buffers[i].rotate_90d_cw = false;
+    }
+
+    back_index = 0;
+    shared_index.store(1);
+    front_index = 2;
+
+    configured_width = 0;
+    configured_height = 0;
+    configured_format = QImage::Format_Invalid;
+
+    published_frames.store(0);
+    presented_frames.store(0);
+    skipped_frames.store(0);
+}
+
+void TripleBuffer::Configure(const int width, const int height, const QImage::Format format)
+{
+    configured_width = width;
+    configured_height = height;
+    configured_format = format;
+}
+
+DisplayFrame* TripleBuffer::BackBuffer()
+{
+    QImage* image = &buffers[back_index].image;
+
+    if(image->width() != configured_width ||
+       image->height() != configured_height ||
+       image->format() != configured_format) {
+        *image = QImage(configured_width, configured_height, configured_format);
+    }
+
+    return &buffers[back_index];
+}
+
+void TripleBuffer::Publish()
+{
+    int previous = shared_index.fetchAndStoreOrdered(back_index | DIRTY_BIT);
+
+    if(previous & DIRTY_BIT) {
+        skipped_frames.fetchAndAddRelaxed(1);
+    }
+
+    back_index = previous & INDEX_MASK;
+    published_frames.fetchAndAddRelaxed(1);
+}
+
+const DisplayFrame* TripleBuffer::FrontBuffer(bool* fresh)
+{
+    bool swapped = false;
+
+    if(shared_index.loadAcquire() & DIRTY_BIT) {
+        front_index = shared_index.fetchAndStoreOrdered(front_index) & INDEX_MASK;
+        presented_frames.fetchAndAddRelaxed(1);
+        swapped = true;
+    }
+
+    if(fresh != NULL) {
+        *fresh = swapped;
+    }
+
+    if(buffers[front_index].image.isNull()) {
+        return NULL;
+    }
+
+    return &buffers[front_index];
+}
+
+int TripleBuffer::PublishedFrames() const
+{
+    return published_frames.load();
+}
+
+int TripleBuffer::PresentedFrames() const
+{
+    return presented_frames.load();
+}
+
+int TripleBuffer::SkippedFrames() const
+{
+    return skipped_frames.load();
+}
@@ -0,0 +1,101 @@
+#ifndef TRIPLEBUFFER_H
+#define TRIPLEBUFFER_H
+
+/** \file
+ * TripleBuffer header
+ * Declares the `TripleBuffer` class for handing frames from the engine to the display
+ */
+
+#include <QAtomicInt>
+#include <QImage>
+
+#include "framesink.h"
+
+/*!
+ * \brief Lock-free single producer, single consumer frame handoff
+ *
+ * Three frames rotate between a writer (the `ZeitEngine`) and a reader (the
+ * `GLVideoWidget`). The writer always owns the back buffer, the reader always
+ * owns the front buffer, and the third buffer sits in the middle holding the
+ * newest completed frame. Ownership changes hands through a single atomic
+ * index swap, so neither side ever waits for the other: a slow repaint only
+ * means that frames are skipped, never that the engine stalls.
+ *
+ * All writer methods must only be called from one thread, and all reader
+ * methods only from one other thread.
+ */
+class TripleBuffer : public FrameSink
+{
+    static const int INDEX_MASK = 0x3;  //!< Bits of `shared_index` holding the buffer index
+    static const int DIRTY_BIT = 0x4;   //!< Set in `shared_index` while the middle buffer is unpresented
+
+    DisplayFrame buffers[3];
+
+    QAtomicInt shared_index;    //!< Middle buffer index, ORed with `DIRTY_BIT` if newly published
+    int back_index;             //!< Writer owned
+    int front_index;            //!< Reader owned
+
+    // Writer owned configuration, applied lazily to each back buffer
+    int configured_width;
+    int configured_height;
+    QImage::Format configured_format;
+
+    QAtomicInt published_frames;
+    QAtomicInt presented_frames;
+    QAtomicInt skipped_frames;
+
+public:
+    TripleBuffer();
+
+    /*!
+     * \brief Configure size and format of the frames to come (writer side)
+     * \param width Frame width
+     * \param height Frame height
+     * \param format Frame pixel format
+     *
+     * Buffers are not reallocated right away, but each time one of them
+     * becomes the back buffer, so the reader is never touched.
+     */
+    void Configure(const int width, const int height, const QImage::Format format) override;
+
+    /*!
+     * \brief Get the frame to render the next frame into (writer side)
+     * \return The back buffer, its image guaranteed to match the configured geometry
+     */
+    DisplayFrame* BackBuffer() override;
+
+    /*!
+     * \brief Publish the back buffer as the newest completed frame (writer side)
+     *
+     * If the previously published frame was never picked up by the reader it
+     * is counted as skipped and recycled as the new back buffer.
+     */
+    void Publish() override;
+
+    /*!
+     * \brief Get the newest completed frame for painting (reader side)
+     * \param fresh Optionally receives whether the frame was newly swapped in
+     * \return The front buffer, or NULL if no frame has been published yet
+     *
+     * Swaps in a newly published frame if there is one, otherwise returns the
+     * last presented frame again.
+     */
+    const DisplayFrame* FrontBuffer(bool* fresh = NULL);
+
+    /*!
+     * \brief Number of frames handed over by the writer
+     */
+    int PublishedFrames() const;
+
+    /*!
+     * \brief Number of frames picked up by the reader
+     */
+    int PresentedFrames() const;
+
+    /*!
+     * \brief Number of published frames replaced before the reader picked them up
+     */
+    int SkippedFrames() const override;
+};
+
+#endif // TRIPLEBUFFER_H
@@ -0,0 +1,278 @@
+#include "zdformat.h"
+
+#include <QDir>
+#include <QFile>
+#include <QList>
+
+#include <algorithm>
+#include <cstring>
+
+extern "C" {
+#include <libavutil/log.h>
+}
+
+static const char HEADER_MAGIC[] = "ZDHD";
+static const int HEADER_PREFIX = 8;     //!< Magic and size
+
+static const char SIDECAR_NAME[] = "zdinfo.txt";
+
+ZdFormat::ZdFormat()
+{
+    width = DEFAULT_WIDTH;
+    height = DEFAULT_HEIGHT;
+    pattern = DEFAULT_PATTERN;
+    bits = DEFAULT_BITS;
+    black_level = 0;
+    white_level = -1;
+    header_size = 0;
+    transfer = Debayer::TRANSFER_LINEAR;
+
+    for(int i = 0; i < 9; i++) {
+        matrix[i] = (i % 4 == 0) ? 1.0f : 0.0f;
+    }
+
+    std::fill(gains, gains + 3, 1.0f);
+}
+
+bool ZdFormat::HasHeader(const char* data, const int size)
+{
+    return size >= HEADER_PREFIX && memcmp(data, HEADER_MAGIC, 4) == 0;
+}
+
+/*!
+ * \brief The total size a header starting with `prefix` declares
+ */
+static quint32 DeclaredHeaderSize(const char* prefix)
+{
+    const uchar* size_bytes = (const uchar*)prefix + 4;
+    return size_bytes[0] | (size_bytes[1] << 8) | (size_bytes[2] << 16) | ((quint32)size_bytes[3] << 24);
+}
+
+bool ZdFormat::ReadSamples(const QFileInfo& file, char* samples) const
+{
+    const QByteArray name = file.absoluteFilePath().toUtf8();
+    QFile frame(file.absoluteFilePath());
+
+    if(!frame.open(QIODevice::ReadOnly)) {
+        av_log(NULL, AV_LOG_ERROR, "Failed to open '%s'\n", name.constData());
+        return false;
+    }
+
+    if(frame.size() != header_size + FrameSize()) {
+        av_log(NULL, AV_LOG_ERROR, "'%s' has %lld bytes, not %lld like the sequence's frames\n",
+               name.constData(), (long long)frame.size(), (long long)(header_size + FrameSize()));
+        return false;
+    }
+
+    // Every frame has a header of its own, only its size has to match the first's
+    if(header_size > 0) {
+        const QByteArray prefix = frame.read(HEADER_PREFIX);
+
+        if(!HasHeader(prefix.constData(), prefix.size()) ||
+           DeclaredHeaderSize(prefix.constData()) != (quint32)header_size ||
+           !frame.seek(header_size)) {
+            av_log(NULL, AV_LOG_ERROR, "'%s': Frame header differs from the sequence's\n", name.constData());
+            return false;
+        }
+    }
+
+    if(frame.read(samples, FrameSize()) != FrameSize()) {
+        av_log(NULL, AV_LOG_ERROR, "Failed to read the samples of '%s'\n", name.constData());
+        return false;
+    }
+
+    return true;
+}
+
+qint64 ZdFormat::FrameSize() const
+{
+    return (qint64)width * height * sizeof(uint16_t);
+}
+
+Debayer::Colour ZdFormat::Colour() const
+{
+    return Debayer::Colour(bits, black_level, white_level, gains, matrix, transfer);
+}
+
+bool ZdFormat::ParseList(const QByteArray& value, float* numbers, const int count)
+{
+    const QList<QByteArray> items = value.split(',');
+
+    if(items.size() != count) {
+        return false;
+    }
+
+    bool valid = true;
+
+    for(int i = 0; i < count && valid; i++) {
+        numbers[i] = items.at(i).trimmed().toFloat(&valid);
+    }
+
+    return valid;
+}
+
+bool ZdFormat::Parse(const QByteArray& text, const QString& origin)
+{
+    // Headers may be padded with zeros
+    QList<QByteArray> lines = text.left(text.contains('\0') ? text.indexOf('\0') : text.size()).split('\n');
+
+    for(int i = 0; i < lines.size(); i++) {
+        const QByteArray line = lines.at(i).trimmed();
+
+        if(line.isEmpty() || line.startsWith('#')) {
+            continue;
+        }
+
+        const int separator = line.indexOf('=');
+
+        if(separator < 0) {
+            av_log(NULL, AV_LOG_ERROR, "%s: Expected key=value in line %d\n", origin.toUtf8().constData(), i + 1);
+            return false;
+        }
+
+        const QByteArray key = line.left(separator).trimmed().toLower();
+        const QByteArray value = line.mid(separator + 1).trimmed();
+
+        bool valid = true;
+
+        if(key == "width") {
+            width = value.toInt(&valid);
+        } else if(key == "height") {
+            height = value.toInt(&valid);
+        } else if(key == "bits") {
+            bits = value.toInt(&valid);
+        } else if(key == "black_level") {
+            black_level = value.toInt(&valid);
+        } else if(key == "white_level") {
+            white_level = value.toInt(&valid);
+        } else if(key == "pattern") {
+            const QByteArray name = value.toUpper();
+
+            if(name == "RGGB") {
+                pattern = ZEIT_BAYER_RGGB;
+            } else if(name == "GRBG") {
+                pattern = ZEIT_BAYER_GRBG;
+            } else if(name == "GBRG") {
+                pattern = ZEIT_BAYER_GBRG;
+            } else if(name == "BGGR") {
+                pattern = ZEIT_BAYER_BGGR;
+            } else {
+                valid = false;
+            }
+        } else if(key == "wb_gains") {
+            valid = ParseList(value, gains, 3) && gains[0] > 0 && gains[1] > 0 && gains[2] > 0;
+        } else if(key == "color_matrix") {
+            valid = ParseList(value, matrix, 9);
+        } else if(key == "transfer") {
+            const QByteArray name = value.toLower();
+
+            if(name == "linear") {
+                transfer = Debayer::TRANSFER_LINEAR;
+            } else if(name == "srgb") {
+                transfer = Debayer::TRANSFER_SRGB;
+            } else {
+                valid = false;
+            }
+        } else if(key == "timestamp") {
+            timestamp = QDateTime::fromString(QString::fromUtf8(value), Qt::ISODate);
+            valid = timestamp.isValid();
+        }
+
+        if(!valid) {
+            av_log(NULL, AV_LOG_ERROR, "%s: Invalid %s '%s'\n", origin.toUtf8().constData(), key.constData(), value.constData());
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool ZdFormat::Read(const QFileInfoList& sequence)
+{
+    *this = ZdFormat();
+
+    if(sequence.isEmpty()) {
+        return false;
+    }
+
+    const QFileInfo first_info = sequence.first();
+    const QByteArray first_name = first_info.absoluteFilePath().toUtf8();
+
+    QFile sidecar(first_info.absoluteDir().filePath(SIDECAR_NAME));
+
+    if(sidecar.exists()) {
+        if(!sidecar.open(QIODevice::ReadOnly)) {
+            av_log(NULL, AV_LOG_ERROR, "Failed to open %s\n", SIDECAR_NAME);
+            return false;
+        }
+
+        if(!Parse(sidecar.readAll(), SIDECAR_NAME)) {
+            return false;
+        }
+    }
+
+    QFile first(first_info.absoluteFilePath());
+
+    if(!first.open(QIODevice::ReadOnly)) {
+        av_log(NULL, AV_LOG_ERROR, "Failed to open '%s'\n", first_name.constData());
+        return false;
+    }
+
+    const QByteArray prefix = first.read(HEADER_PREFIX);
+
+    if(HasHeader(prefix.constData(), prefix.size())) {
+        const quint32 size = DeclaredHeaderSize(prefix.constData());
+
+        // An odd size would leave the samples unaligned
+        if(size < (quint32)HEADER_PREFIX || size > (quint32)MAX_HEADER_SIZE || size % 2 != 0) {
+            av_log(NULL, AV_LOG_ERROR, "'%s': Invalid header size %u\n", first_name.constData(), size);
+            return false;
+        }
+
+        const QByteArray text = first.read(size - HEADER_PREFIX);
+
+        if(text.size() != (int)size - HEADER_PREFIX || !Parse(text, first_info.fileName())) {
+            av_log(NULL, AV_LOG_ERROR, "'%s': Unreadable header\n", first_name.constData());
+            return false;
+        }
+
+        header_size = size;
+    }
+
+    // Blocks of 2x2 samples hold one of each colour
+    if(width <= 0 || height <= 0 || width % 2 != 0 || height % 2 != 0) {
+        av_log(NULL, AV_LOG_ERROR, "ZD frames must have a positive, even size, not %dx%d\n", width, height);
+        return false;
+    }
+
+    // The debayer kernels are specialised for these depths only
+    if(bits < Debayer::MIN_BITS || bits > Debayer::MAX_BITS || bits % 2 != 0) {
+        av_log(NULL, AV_LOG_ERROR, "ZD samples have 10, 12, 14 or 16 bits, not %d\n", bits);
+        return false;
+    }
+
+    const int max_value = (1 << bits) - 1;
+
+    if(white_level < 0) {
+        white_level = max_value;
+    }
+
+    if(black_level < 0 || black_level >= white_level || white_level > max_value) {
+        av_log(NULL, AV_LOG_ERROR, "Invalid ZD levels, black %d and white %d for %d bit samples\n", black_level, white_level, bits);
+        return false;
+    }
+
+    // A frame of another size is another sensor or mode, never read it as this one
+    if(first.size() != header_size + FrameSize()) {
+        av_log(NULL, AV_LOG_ERROR, "'%s' has %lld bytes, %dx%d samples and a %d byte header take %lld\n",
+               first_name.constData(),
+               (long long)first.size(),
+               width,
+               height,
+               header_size,
+               (long long)(header_size + FrameSize()));
+        return false;
+    }
+
+    return true;
+}
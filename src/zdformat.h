@@ -0,0 +1,106 @@
+#ifndef ZDFORMAT_H
+#define ZDFORMAT_H
+
+/** \file
+ * ZdFormat header
+ * Declares the `ZdFormat` struct, describing the raw frames of a ZD sequence
+ */
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QFileInfoList>
+#include <QString>
+
+#include "debayer.h"
+
+/*!
+ * \brief Geometry, sample layout and capture data of ZD raw frames
+ *
+ * The original camera writes bare 1944x1944 GRBG frames of 12 bit samples,
+ * which is what a sequence is taken for unless it describes itself. It can
+ * do so in two places, both holding `key=value` lines:
+ *
+ * - `zdinfo.txt` next to the frames, describing the whole sequence
+ * - a header in front of every frame: `ZDHD`, its total size in bytes as a
+ *   32 bit little endian number, then the lines; values there win
+ *
+ * Keys are `width`, `height`, `pattern` (`RGGB`, `GRBG`, `GBRG` or `BGGR`),
+ * `bits` (10, 12, 14 or 16, the depths the debayer kernels exist for),
+ * `black_level`, `white_level`, `timestamp` (ISO 8601) and for colour
+ * correction `wb_gains` (red, green, blue), `color_matrix` (camera RGB to
+ * linear sRGB, 9 values row by row) and `transfer` (`linear` or `srgb`),
+ * lists separated by commas; lines starting with `#` and unknown keys are
+ * ignored.
+ */
+struct ZdFormat {
+    int width;
+    int height;
+    ZeitBayerPattern pattern;
+    int bits;                   //!< Significant bits of the 16 bit little endian samples, 10, 12, 14 or 16
+    int black_level;            //!< Sample value of no light
+    int white_level;            //!< Sample value the sensor saturates at
+    float gains[3];             //!< White balance of red, green and blue
+    float matrix[9];            //!< Camera RGB to linear sRGB, row major
+    Debayer::Transfer transfer; //!< How corrected values are encoded
+    QDateTime timestamp;        //!< Capture time of the first frame, invalid if unknown
+    int header_size;            //!< Bytes in front of the samples of every frame, 0 for bare frames
+
+    const static int DEFAULT_WIDTH = 1944;
+    const static int DEFAULT_HEIGHT = 1944;
+    const static ZeitBayerPattern DEFAULT_PATTERN = ZEIT_BAYER_GRBG;
+    const static int DEFAULT_BITS = 12;
+
+    const static int MAX_HEADER_SIZE = 64 * 1024;   //!< Larger headers are taken for corrupt data
+
+    /*!
+     * \brief The format of the original camera
+     */
+    ZdFormat();
+
+    /*!
+     * \brief Read the format of a sequence from its sidecar and first frame
+     * \return false if the description is invalid or the first frame's size
+     *         does not match it; the reason is logged
+     */
+    bool Read(const QFileInfoList& sequence);
+
+    /*!
+     * \brief Whether a frame starts with a header
+     */
+    static bool HasHeader(const char* data, const int size);
+
+    /*!
+     * \brief Read the samples of a frame, without its header
+     * \param samples Receives `FrameSize()` bytes
+     * \return false if the frame's size or header differs from the
+     *         sequence's; the reason is logged
+     *
+     * Headers are checked on every frame, not only the first.
+     */
+    bool ReadSamples(const QFileInfo& file, char* samples) const;
+
+    /*!
+     * \brief Bytes of a frame's samples
+     */
+    qint64 FrameSize() const;
+
+    /*!
+     * \brief The colour correction, prepared for the debayer kernels
+     */
+    Debayer::Colour Colour() const;
+
+private:
+    /*!
+     * \brief Apply `key=value` lines
+     * \param origin Named in log messages
+     */
+    bool Parse(const QByteArray& text, const QString& origin);
+
+    /*!
+     * \brief Read a list of numbers separated by commas
+     * \return false unless there are exactly `count` of them
+     */
+    static bool ParseList(const QByteArray& value, float* numbers, const int count);
+};
+
+#endif // ZDFORMAT_H
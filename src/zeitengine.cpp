@@ -1,29 +1,116 @@
 #include "zeitengine.h"
 
-ZeitEngine::ZeitEngine(GLVideoWidget* video_widget, QObject *parent) :
-    QObject(parent)
+#include <QRunnable>
+#include <QSemaphore>
+
+#if defined(Q_OS_WIN)
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+/*!
+ * \brief Write a file (or on POSIX systems a directory's entries) through to the disk
+ */
+static bool SyncPath(const QString& path)
 {
+#if defined(Q_OS_WIN)
+    // Directory entries are written through by NTFS itself
+    if(QFileInfo(path).isDir()) {
+        return true;
+    }
+
+    QFile file(path);
+    return file.open(QIODevice::ReadWrite) && _commit(file.handle()) == 0;
+#else
+    const int descriptor = ::open(QFile::encodeName(path).constData(), O_RDONLY);
+
+    if(descriptor < 0) {
+        return false;
+    }
+
+    const bool synced = (::fsync(descriptor) == 0);
+    ::close(descriptor);
+
+    return synced;
+#endif
+}
+
+/*!
+ * \brief Encodes a frame for one rendition on the rendition pool
+ */
+class RenditionTask : public QRunnable
+{
+    ZeitEngine* engine;
+    ZeitEngine::ExportEncoder* encoder;
+    AVFrame* frame;
+    int64_t pts;
+    QSemaphore* done;
+
+public:
+    RenditionTask(ZeitEngine* engine,
+                  ZeitEngine::ExportEncoder* encoder,
+                  AVFrame* frame,
+                  const int64_t pts,
+                  QSemaphore* done)
+    {
+        this->engine = engine;
+        this->encoder = encoder;
+        this->frame = frame;
+        this->pts = pts;
+        this->done = done;
+    }
+
+    void run()
+    {
+        engine->EncodeRendition(encoder, frame, pts);
+        done->release();
+    }
+};
+
+ZeitEngine::ZeitEngine(FrameSink* sink,
+                       const unsigned int display_max_width,
+                       const unsigned int display_max_height,
+                       QObject *parent) :
+    QObject(parent),
+    display_cache(DISPLAY_CACHE_MEMORY),
+    proxy_cache(PROXY_CACHE_MEMORY)
+{
+    static QMutex avglobals_mutex;
     static bool avglobals_initialized = false;
 
     operation_mode = ZEIT_MODE_ZD;
 
+    // Engines of queued exports are created concurrently
+    avglobals_mutex.lock();
     if(!avglobals_initialized) {
         av_register_all();
         avcodec_register_all();
         avfilter_register_all();
         avglobals_initialized = true;
     }
+    avglobals_mutex.unlock();
 
-    QScreen* screen = QApplication::primaryScreen();
-
-    display_refresh_rate = screen->refreshRate();
-    display_safe_max_width = std::min((int)(screen->availableSize().width() * 0.66), screen->availableSize().width() - 200);
-    display_safe_max_height = std::min((int)(screen->availableSize().height() * 0.66), screen->availableSize().height() - 200);
-    display = video_widget;
+    display_safe_max_width = display_max_width;
+    display_safe_max_height = display_max_height;
+    display = sink;
     display_initialized = false;
     rotation_initialized = false;
 
     configured_framerate = ZEIT_RATE_24p;
+    profile_flag = ZEIT_PROFILE_STANDARD;
+    encoder_threads = 0;
+    rendition_encoder_threads = 0;
+    keep_partial_flag = false;
+    export_in_flag = 0;
+    export_out_flag = -1;
+    export_stride_flag = 1;
+    export_height_flag = ZEIT_RESOLUTION_SOURCE;
+    export_depth_flag = ZEIT_DEPTH_8;
+    preview_scaler_flag = SWS_FAST_BILINEAR;
+    export_scaler_flag = SWS_LANCZOS;
+    calibrate_scaler_flag = false;
 
     decoder_format = av_find_input_format("image2");
     decoder_format_context = NULL;
@@ -33,11 +120,30 @@ ZeitEngine::ZeitEngine(GLVideoWidget* video_widget, QObject *parent) :
     decoder_frame = NULL;
     decoder_packet = NULL;
 
-    scaler_context = NULL;
+    debayered_frame = NULL;
+    deep_debayered_frame = NULL;
+
+    fast_debayer_kernel = NULL;
+    debayer_kernel = NULL;
+    deep_debayer_kernel = NULL;
+    deep_debayer_pixel_format = AV_PIX_FMT_NONE;
+
+    export_pixel_format = EXPORT_PIXELFORMAT;
+    export_codec_id = EXPORT_CODEC_ID;
+    export_flip_x = true;
+    export_flip_y = true;
+    export_rotate_90d_cw = false;
+
+    sequence_position = -1;
+    playback_direction = 1;
+    render_estimate = 0.0f;
+    cached_filter = ZEIT_FILTER_NONE;
+    proxy_context = NULL;
+    present_context = NULL;
+
     scaler_frame = NULL;
     scaler_initialized = false;
 
-    rescaler_context = NULL;
     rescaler_frame = NULL;
     rescaler_initialized = false;
 
@@ -46,6 +152,13 @@ ZeitEngine::ZeitEngine(GLVideoWidget* video_widget, QObject *parent) :
 
     control_mutex.lock();
     stop_flag = false;
+    pause_flag = false;
+    seek_flag = -1;
+    step_flag = 0;
+    playing = false;
+    seek_queued = false;
+    playback_flag = ZEIT_PLAYBACK_FORWARD;
+    speed_flag = 1.0f;
     loop_flag = true;
     filter_flag = ZEIT_FILTER_NONE;
     flip_x_flag = true;
@@ -54,35 +167,48 @@ ZeitEngine::ZeitEngine(GLVideoWidget* video_widget, QObject *parent) :
     control_mutex.unlock();
 
     preview_flag = false;
-
-    exporter_initialized = false;
 }
 
 ZeitEngine::~ZeitEngine()
 {
     FreeDecoder();
+    FreeDebayer();
     FreeScaler();
     FreeFilter();
     FreeFilterData();
     FreeRescaler();
+
+    display_cache.Clear();
+    proxy_cache.Clear();
+
+    sws_freeContext(proxy_context);
+    sws_freeContext(present_context);
 }
 
 bool ZeitEngine::InitDecoder()
 {
-    sequence_iterator = source_sequence.constBegin();
+    int position = 0;
     bool initialized = false;
     int ret;
 
+    if(operation_mode == ZEIT_MODE_ZD && (!zd_format.Read(source_sequence) || !SelectDebayer())) {
+        return false;
+    }
+
+    // Raw frames carry no geometry, the rawvideo reader is told what to expect
+    QByteArray zd_video_size = QString("%1x%2").arg(zd_format.width).arg(zd_format.height).toUtf8();
+    const char* zd_pixel_format = av_get_pix_fmt_name(Debayer::SourceFormat(zd_format.pattern));
+
     do {
         try {
             AVDictionary *options = NULL;
 
             if(operation_mode == ZEIT_MODE_ZD) {
-                av_dict_set(&options, "video_size", "1944x1944", 0);
-                av_dict_set(&options, "pixel_format", "bayer_grbg16le", 0);
+                av_dict_set(&options, "video_size", zd_video_size.constData(), 0);
+                av_dict_set(&options, "pixel_format", zd_pixel_format, 0);
             }
 
-            QByteArray image_bytearray = (*sequence_iterator).absoluteFilePath().toUtf8();
+            QByteArray image_bytearray = source_sequence.at(position).absoluteFilePath().toUtf8();
             const char* image_cstr = image_bytearray.data();
 
             // Open input file
@@ -134,9 +260,9 @@ bool ZeitEngine::InitDecoder()
 
             // If initializing fails (e.g. faulty frame) we abandon the frame
             // and just skip to the next iteration with the next frame
-            sequence_iterator++;
+            position++;
         }
-    } while(!initialized && sequence_iterator != source_sequence.constEnd());
+    } while(!initialized && position < source_sequence.size());
 
     return initialized;
 }
@@ -149,18 +275,61 @@ void ZeitEngine::FreeDecoder()
     av_frame_free(&decoder_frame);
 }
 
-void ZeitEngine::Load(const QFileInfoList& sequence)
+QFileInfoList ZeitEngine::FindSequence(const QDir& directory)
+{
+    QDir dir(directory);
+
+    dir.setFilter(QDir::Files);
+
+    QStringList image_extension_filters{"*.jpg","*.jpeg","*.png", "*.zd"};
+    dir.setNameFilters(image_extension_filters);
+
+    QFileInfoList files = dir.entryInfoList();
+
+    // Remove 0 byte images
+    QMutableListIterator<QFileInfo> files_iterator(files);
+    while(files_iterator.hasNext()) {
+        if(files_iterator.next().size() == 0) {
+            files_iterator.remove();
+        }
+    }
+
+    // Naturally sort the images by filename
+
+    QCollator collator;
+    collator.setNumericMode(true);
+    collator.setCaseSensitivity(Qt::CaseInsensitive);
+
+    std::sort(files.begin(), files.end(), [&](const QFileInfo& a, const QFileInfo& b) {
+
+        return collator.compare(a.baseName(), b.baseName()) < 0;
+    });
+
+    return files;
+}
+
+bool ZeitEngine::Open(const QFileInfoList& sequence)
 {
     // ATTENTION - might make sense to abstract this whole display init with InitDisplay() FreeDisplay() and such too
     display_initialized = false;
 
     FreeDecoder();
+    FreeDebayer();
     FreeScaler();
     FreeFilter();
     FreeFilterData();
     FreeRescaler();
 
+    display_cache.Clear();
+    proxy_cache.Clear();
+
     source_sequence = sequence;
+    sequence_position = -1;
+
+    control_mutex.lock();
+    seek_flag = -1;
+    step_flag = 0;
+    control_mutex.unlock();
 
     if((*sequence.constBegin()).suffix() == "zd") {
         operation_mode = ZEIT_MODE_ZD;
@@ -168,9 +337,14 @@ void ZeitEngine::Load(const QFileInfoList& sequence)
         operation_mode = ZEIT_MODE_GENERAL;
     }
 
+    return InitDecoder();
+}
+
+void ZeitEngine::Load(const QFileInfoList& sequence)
+{
     // TODO: Might handle returned success/failure of initialization at some point
     //       This would need some channel for user feedback: "Hey I failed, sorry!"
-    InitDecoder();
+    Open(sequence);
 
     Play();
 }
@@ -188,297 +362,1569 @@ void ZeitEngine::Refresh()
 
 void ZeitEngine::Cache()
 {
-    for(sequence_iterator = source_sequence.constBegin(); sequence_iterator != source_sequence.constEnd(); ++sequence_iterator)
+    control_mutex.lock();
+    bool rotate_90d_cw = rotate_90d_cw_flag;
+    ZeitFilter filter = filter_flag;
+    control_mutex.unlock();
+
+    // Spread the proxies evenly over the sequence if they don't all fit
+    int stride = 1;
+
+    if(display_initialized) {
+        qint64 proxy_size = av_image_get_buffer_size(DISPLAY_AV_PIXEL_FORMAT,
+                                                     std::max(1u, display_width / PROXY_DIVISOR),
+                                                     std::max(1u, display_height / PROXY_DIVISOR),
+                                                     1);
+        qint64 capacity = std::max((qint64)1, proxy_cache.Budget() / proxy_size);
+
+        stride = std::max((qint64)1, (source_sequence.size() + capacity - 1) / capacity);
+    }
+
+    for(int position = 0; position < source_sequence.size(); position += stride)
     {
-        emit ProgressUpdated("Caching sequence", sequence_iterator - source_sequence.constBegin(), source_sequence.size());
+        emit ProgressUpdated("Caching sequence", position, source_sequence.size());
+
+        if(proxy_cache.Contains(position) || !DecodeFrame(position)) {
+            continue;
+        }
+
+        if(!display_initialized || (rotate_90d_cw != rotation_initialized)) {
+            InitDisplay(rotate_90d_cw);
+        }
 
-        DecodeFrame();
+        CacheProxy(position, RenderFrame(filter));
 
-        ScaleFrame(decoder_frame,
-                   display_width,
-                   display_height,
-                   DISPLAY_AV_PIXEL_FORMAT);
+        FreeFilterData();
     }
 
     emit ProgressUpdated("Cache ready", source_sequence.size(), source_sequence.size());
     emit MessageUpdated("Cache ready");
 
+    FreeFilter();
     FreeScaler();
 }
 
-void ZeitEngine::Play()
+void ZeitEngine::InitDisplay(const bool rotate_90d_cw)
 {
+    if(filter_initialized) {
+        FreeFilterData();
+        filter_initialized = false;
+    }
+
+    if(scaler_initialized) {
+        FreeScaler();
+        scaler_initialized = false;
+    }
+
+    // Cached frames were rendered for the previous display geometry
+    display_cache.Clear();
+    proxy_cache.Clear();
+
+    // Swap sides for the fitting algorithm
+    if(rotate_90d_cw) {
+        display_width = decoder_frame->height;
+        display_height = decoder_frame->width;
+    } else {
+        display_width = decoder_frame->width;
+        display_height = decoder_frame->height;
+    }
+
+    // Fit display resolution into available screen space
+    while(display_width > display_safe_max_width || display_height > display_safe_max_height) {
+
+        if(display_width > display_safe_max_width) {
+            display_height = (float)display_height * ((float)display_safe_max_width / (float)display_width);
+            display_width = display_safe_max_width;
+        }
+
+        if(display_height > display_safe_max_height) {
+            display_width = (float)display_width * ((float)display_safe_max_height / (float)display_height);
+            display_height = display_safe_max_height;
+        }
+    }
+
+    emit VideoConfigurationUpdated(display_width, display_height, DISPLAY_QT_PIXEL_FORMAT);
+
+    // Pre-display everything is still internally unrotated, thus un-swap sides again!
+    if(rotate_90d_cw) {
+        int keep_width = display_width;
+        display_width = display_height;
+        display_height = keep_width;
+    }
+
+    // Frames are handed over unrotated, the display orients them.
+    // Back buffers are reallocated lazily on the engine side, no need
+    // to wait for the display to catch up with the new configuration
+    display->Configure(display_width, display_height, DISPLAY_QT_PIXEL_FORMAT);
+
+    rotation_initialized = rotate_90d_cw;
+    display_initialized = true;
+
     control_mutex.lock();
-    stop_flag = false;
+    bool calibrate = calibrate_scaler_flag;
     control_mutex.unlock();
 
-    sequence_iterator = source_sequence.constBegin();
-
-    if(!preview_flag) {
-        emit MessageUpdated("Playback started");
+    if(calibrate) {
+        CalibrateScaler();
     }
+}
 
-    while(true) {
-        float frame_timeframe;
+void ZeitEngine::CalibrateScaler()
+{
+    // Best looking first
+    const int candidates[] = { SWS_BICUBIC, SWS_BILINEAR, SWS_FAST_BILINEAR, SWS_POINT };
+    const int candidate_count = sizeof(candidates) / sizeof(candidates[0]);
 
-        timer.start();
+    control_mutex.lock();
+    const qint64 budget = (qint64)(FrameInterval(configured_framerate) * 1000000.0f) / SCALER_BUDGET_SHARE;
+    control_mutex.unlock();
 
+    // ZD frames are scaled once debayered, at the same size
+    const AVPixelFormat source_format = (operation_mode == ZEIT_MODE_ZD) ? (AVPixelFormat)DEBAYER_PIXEL_FORMAT
+                                                                         : (AVPixelFormat)decoder_frame->format;
+    const QString key = QString("%1x%2 %3 %4x%5 %6").arg(decoder_frame->width)
+                                                    .arg(decoder_frame->height)
+                                                    .arg(source_format)
+                                                    .arg(display_width)
+                                                    .arg(display_height)
+                                                    .arg(budget);
+
+    if(scaler_calibrations.contains(key)) {
         control_mutex.lock();
-        bool break_requested = stop_flag || (!loop_flag && sequence_iterator == source_sequence.constEnd());
+        preview_scaler_flag = scaler_calibrations.value(key);
+        control_mutex.unlock();
 
-        switch(configured_framerate) {
+        return;
+    }
 
-            case ZEIT_RATE_23_976:
-                frame_timeframe = 1000.0f / (30000.0f / 1001.0f);
-                break;
+    AVFrame* frame = decoder_frame;
 
-            case ZEIT_RATE_29_97:
-                frame_timeframe = 1000.0f / (2997.0f / 125.0f);
-                break;
+    if(operation_mode == ZEIT_MODE_ZD) {
+        DebayerFrame(decoder_frame, true);
+        frame = debayered_frame;
+    }
 
-            default:
-                frame_timeframe = 1000.0f / configured_framerate;
+    uint8_t* data[4];
+    int linesize[4];
+
+    if(av_image_alloc(data, linesize, display_width, display_height, DISPLAY_AV_PIXEL_FORMAT, 32) < 0) {
+        av_log(NULL, AV_LOG_ERROR, "Could not allocate scaler calibration picture\n");
+        return;
+    }
+
+    int chosen = -1;
+    int fastest = -1;
+    qint64 fastest_time = 0;
+
+    for(int i = 0; i < candidate_count && chosen == -1; i++) {
+        SwsContext* context = sws_getContext(frame->width,
+                                             frame->height,
+                                             (AVPixelFormat)frame->format,
+                                             display_width,
+                                             display_height,
+                                             DISPLAY_AV_PIXEL_FORMAT,
+                                             candidates[i],
+                                             NULL,
+                                             NULL,
+                                             NULL);
+        if(context == NULL) {
+            continue;
         }
 
-        bool flip_x = flip_x_flag;
-        bool flip_y = flip_y_flag;
-        bool rotate_90d_cw = rotate_90d_cw_flag;
+        // The quickest run, the others were disturbed by something else
+        qint64 best = -1;
 
-        ZeitFilter filter = filter_flag;
+        for(int run = 0; run < CALIBRATION_RUNS; run++) {
+            QElapsedTimer run_timer;
+            run_timer.start();
 
-        control_mutex.unlock();
+            sws_scale(context,
+                      (const uint8_t * const*)frame->data,
+                      frame->linesize,
+                      0,
+                      frame->height,
+                      data,
+                      linesize);
 
-        if(break_requested) {
-            emit MessageUpdated("Playback stopped");
-            break;
+            qint64 elapsed = run_timer.nsecsElapsed();
+
+            if(best < 0 || elapsed < best) {
+                best = elapsed;
+            }
         }
 
-        if(sequence_iterator == source_sequence.constEnd()) {
-            sequence_iterator = source_sequence.constBegin();
+        sws_freeContext(context);
+
+        av_log(NULL, AV_LOG_VERBOSE, "Scaler calibration: flags 0x%x take %.2f ms for %dx%d -> %dx%d\n",
+               candidates[i], best / 1000000.0, frame->width, frame->height, display_width, display_height);
+
+        if(best <= budget) {
+            chosen = candidates[i];
         }
 
-        if(!DecodeFrame()) {
-            // If decoding fails (e.g. faulty frame) we abandon the frame
-            // and just skip to the next iteration with the next frame
-            ++sequence_iterator;
-            continue;
+        if(fastest == -1 || best < fastest_time) {
+            fastest = candidates[i];
+            fastest_time = best;
         }
+    }
 
-        if(!display_initialized || (rotate_90d_cw != rotation_initialized)) {
+    av_freep(&data[0]);
 
-            if(filter_initialized) {
-                FreeFilterData();
-                filter_initialized = false;
-            }
+    if(chosen == -1) {
+        chosen = fastest;
+    }
 
-            if(scaler_initialized) {
-                FreeScaler();
-                scaler_initialized = false;
-            }
+    if(chosen == -1) {
+        return;
+    }
 
-            // Swap sides for the fitting algorithm
-            if(rotate_90d_cw) {
-                display_width = decoder_frame->height;
-                display_height = decoder_frame->width;
-            } else {
-                display_width = decoder_frame->width;
-                display_height = decoder_frame->height;
-            }
+    scaler_calibrations.insert(key, chosen);
 
-            // Fit display resolution into available screen space
-            while(display_width > display_safe_max_width || display_height > display_safe_max_height) {
+    control_mutex.lock();
+    preview_scaler_flag = chosen;
+    control_mutex.unlock();
 
-                if(display_width > display_safe_max_width) {
-                    display_height = (float)display_height * ((float)display_safe_max_width / (float)display_width);
-                    display_width = display_safe_max_width;
-                }
+    av_log(NULL, AV_LOG_INFO, "Previewing with scaler flags 0x%x\n", chosen);
+}
 
-                if(display_height > display_safe_max_height) {
-                    display_width = (float)display_width * ((float)display_safe_max_height / (float)display_height);
-                    display_height = display_safe_max_height;
-                }
-            }
+float ZeitEngine::FrameInterval(const ZeitRate rate)
+{
+    switch(rate) {
+        case ZEIT_RATE_23_976:
+            return 1000.0f / (30000.0f / 1001.0f);
 
-            emit VideoConfigurationUpdated(display_width, display_height, DISPLAY_QT_PIXEL_FORMAT);
+        case ZEIT_RATE_29_97:
+            return 1000.0f / (2997.0f / 125.0f);
 
-            // Pre-display everything is still internally unrotated, thus un-swap sides again!
-            if(rotate_90d_cw) {
-                int keep_width = display_width;
-                display_width = display_height;
-                display_height = keep_width;
-            }
+        default:
+            return 1000.0f / rate;
+    }
+}
 
-            rotation_initialized = rotate_90d_cw;
+int ZeitEngine::ScalerFlags(const ZeitScalePurpose purpose,
+                            const int source_width,
+                            const int source_height,
+                            const int target_width,
+                            const int target_height)
+{
+    control_mutex.lock();
+    int flags = (purpose == ZEIT_SCALE_PREVIEW) ? preview_scaler_flag : export_scaler_flag;
+    control_mutex.unlock();
 
-            while(!display_initialized) {
+    if(purpose == ZEIT_SCALE_EXPORT
+       && (target_width * AREA_SCALE_RATIO <= source_width || target_height * AREA_SCALE_RATIO <= source_height)) {
+        flags = SWS_AREA;
+    }
 
-                Sleep(2);
+    return flags;
+}
 
-                display->image_mutex.lock();
-                display_initialized = (display->image != NULL);
-                display->image_mutex.unlock();
-            }
-        }
+AVFrame* ZeitEngine::RenderFrame(const ZeitFilter filter)
+{
+    AVFrame* frame = decoder_frame;
 
-        // extract size
+    if(operation_mode == ZEIT_MODE_ZD) {
+        DebayerFrame(decoder_frame, true);
+        frame = debayered_frame;
+    }
 
-        if(operation_mode == ZEIT_MODE_ZD) {
-            DebayerFrame(decoder_frame, true);
-            ScaleFrame(debayered_frame,
-                       display_width,
-                       display_height,
-                       DISPLAY_AV_PIXEL_FORMAT);
-        } else {
-            ScaleFrame(decoder_frame,
-                       display_width,
-                       display_height,
-                       DISPLAY_AV_PIXEL_FORMAT);
-        }
+    ScaleFrame(frame,
+               display_width,
+               display_height,
+               DISPLAY_AV_PIXEL_FORMAT,
+               ScalerFlags(ZEIT_SCALE_PREVIEW, frame->width, frame->height, display_width, display_height));
 
+    if(filter != ZEIT_FILTER_NONE) {
+        FilterFrame(scaler_frame, filter);
+        return filter_frame;
+    }
 
+    return scaler_frame;
+}
 
-        if(filter != ZEIT_FILTER_NONE) {
-            FilterFrame(scaler_frame, filter);
-        }
+void ZeitEngine::CacheProxy(const int position, AVFrame *frame)
+{
+    if(proxy_cache.Contains(position)) {
+        return;
+    }
+
+    AVFrame* proxy = av_frame_alloc();
+
+    if(proxy == NULL) {
+        return;
+    }
+
+    proxy->width = std::max(1, frame->width / (int)PROXY_DIVISOR);
+    proxy->height = std::max(1, frame->height / (int)PROXY_DIVISOR);
+    proxy->format = frame->format;
+
+    proxy_context = sws_getCachedContext(proxy_context,
+                                         frame->width,
+                                         frame->height,
+                                         (AVPixelFormat)frame->format,
+                                         proxy->width,
+                                         proxy->height,
+                                         (AVPixelFormat)proxy->format,
+                                         SWS_FAST_BILINEAR,
+                                         NULL,
+                                         NULL,
+                                         NULL);
+
+    if(proxy_context == NULL || av_frame_get_buffer(proxy, 32) < 0) {
+        av_frame_free(&proxy);
+        return;
+    }
+
+    sws_scale(proxy_context,
+              (const uint8_t * const*)frame->data,
+              frame->linesize,
+              0,
+              frame->height,
+              proxy->data,
+              proxy->linesize);
+
+    proxy_cache.Insert(position, proxy);
+}
+
+void ZeitEngine::PresentFrame(AVFrame *frame,
+                              const bool flip_x,
+                              const bool flip_y,
+                              const bool rotate_90d_cw)
+{
+    StageTimer stage_timer(&stats, ZEIT_STAGE_PRESENT);
 
-        display->image_mutex.lock();
-        AVFrame* frame = (filter == ZEIT_FILTER_NONE ? scaler_frame :
-                                                       filter_frame);
+    DisplayFrame* display_frame = display->BackBuffer();
+    QImage& image = display_frame->image;
 
+    if(frame->width == image.width() && frame->height == image.height()) {
+        // Orientation is applied by the display when drawing, and both sides
+        // share the same 4 byte pixel format, so whole lines are copied as is
         for(int y = 0; y < frame->height; y++) {
-            for(int x = 0; x < frame->width; x++) {
-                int target_x = x;
-                int target_y = y;
+            memcpy(image.scanLine(y),
+                   frame->data[0] + y * frame->linesize[0],
+                   frame->width * sizeof(uint32_t));
+        }
+    } else {
+        // Proxy frames are blown up to display size
+        present_context = sws_getCachedContext(present_context,
+                                               frame->width,
+                                               frame->height,
+                                               (AVPixelFormat)frame->format,
+                                               image.width(),
+                                               image.height(),
+                                               DISPLAY_AV_PIXEL_FORMAT,
+                                               SWS_FAST_BILINEAR,
+                                               NULL,
+                                               NULL,
+                                               NULL);
+
+        if(present_context == NULL) {
+            return;
+        }
 
-                if(flip_x) { target_x =  frame->width - 1 - x; }
-                if(flip_y != rotate_90d_cw) { target_y = frame->height - 1 - y; }
+        uint8_t* image_data[4] = { image.bits(), NULL, NULL, NULL };
+        int image_linesize[4] = { image.bytesPerLine(), 0, 0, 0 };
 
-                if(rotate_90d_cw) {
-                    memcpy(display->image->scanLine(target_x) + target_y * 3,
-                           frame->data[0] + y * frame->linesize[0] + x * 3,
-                           sizeof(uint8_t) * 3);
-                } else {
-                    memcpy(display->image->scanLine(target_y) + target_x * 3,
-                           frame->data[0] + y * frame->linesize[0] + x * 3,
-                           sizeof(uint8_t) * 3);
-                }
+        sws_scale(present_context,
+                  (const uint8_t * const*)frame->data,
+                  frame->linesize,
+                  0,
+                  frame->height,
+                  image_data,
+                  image_linesize);
+    }
+
+    display_frame->flip_x = flip_x;
+    display_frame->flip_y = flip_y;
+    display_frame->rotate_90d_cw = rotate_90d_cw;
+
+    display->Publish();
+
+    emit VideoUpdated();
+}
+
+bool ZeitEngine::ShowFrame(const int position,
+                           const ZeitFilter filter,
+                           const bool flip_x,
+                           const bool flip_y,
+                           const bool rotate_90d_cw)
+{
+    TraceScope trace_scope("Show frame", position);
+
+    // Cached frames were rendered with the previous filter
+    if(filter != cached_filter) {
+        display_cache.Clear();
+        proxy_cache.Clear();
+        cached_filter = filter;
+    }
+
+    // Reconfigure before looking at the cache, the last decoded frame tells
+    // the source geometry
+    if(display_initialized && rotate_90d_cw != rotation_initialized) {
+        InitDisplay(rotate_90d_cw);
+    }
+
+    AVFrame* frame = display_cache.Find(position);
+
+    if(frame != NULL) {
+        PresentFrame(frame, flip_x, flip_y, rotate_90d_cw);
+        return true;
+    }
+
+    if(!DecodeFrame(position)) {
+        return false;
+    }
+
+    if(!display_initialized) {
+        InitDisplay(rotate_90d_cw);
+    }
+
+    QElapsedTimer render_timer;
+    render_timer.start();
+
+    frame = RenderFrame(filter);
+
+    render_estimate = 0.8f * render_estimate + 0.2f * render_timer.elapsed();
+
+    PresentFrame(frame, flip_x, flip_y, rotate_90d_cw);
+
+    display_cache.Insert(position, av_frame_clone(frame));
+    CacheProxy(position, frame);
+
+    FreeFilterData();
+
+    return true;
+}
+
+bool ZeitEngine::AdvancePlayhead(double *playhead,
+                                 int *direction,
+                                 const double distance,
+                                 const ZeitPlayback mode,
+                                 const bool loop) const
+{
+    const double last = source_sequence.size() - 1;
+
+    *playhead += *direction * distance;
+
+    if(mode == ZEIT_PLAYBACK_PINGPONG) {
+        if(last <= 0) {
+            *playhead = 0;
+            return true;
+        }
+
+        // Bounce off both ends, possibly repeatedly for fast short sequences
+        while(*playhead > last || *playhead < 0) {
+            if(*playhead > last) {
+                *playhead = 2 * last - *playhead;
+                *direction = -1;
+            } else if(loop) {
+                *playhead = -*playhead;
+                *direction = 1;
+            } else {
+                // Without looping a single round trip is played
+                *playhead = 0;
+                return false;
             }
         }
-        display->image_mutex.unlock();
 
-        emit VideoUpdated();
+        return true;
+    }
 
-        FreeFilterData();
+    if(*playhead >= last + 1) {
+        if(!loop) {
+            *playhead = last;
+            return false;
+        }
 
-        ++sequence_iterator;
+        *playhead = std::fmod(*playhead, last + 1);
+    } else if(*playhead < 0) {
+        if(!loop) {
+            *playhead = 0;
+            return false;
+        }
 
-        if(timer.elapsed() > frame_timeframe) {
-            // qDebug() << QString::number(timer.elapsed() - frame_timeframe) + "ms lag";
-        } else {
-            Sleep(frame_timeframe - timer.elapsed());
+        *playhead = last + 1 + std::fmod(*playhead, last + 1);
+    }
+
+    return true;
+}
+
+void ZeitEngine::Prefetch(double playhead,
+                          int direction,
+                          const double speed,
+                          const ZeitPlayback mode,
+                          const bool loop,
+                          const ZeitFilter filter,
+                          const float deadline)
+{
+    const int last = source_sequence.size() - 1;
+
+    // Below 1x consecutive frames are shown, above 1x every speed-th frame
+    const double distance = std::max(speed, 1.0);
+
+    for(int ahead = 0; ahead < PREFETCH_FRAMES; ahead++) {
+        if(!AdvancePlayhead(&playhead, &direction, distance, mode, loop)) {
+            break;
         }
 
-        if(preview_flag) {
-            preview_flag = false;
+        int position = std::min(std::max((int)playhead, 0), last);
+
+        if(display_cache.Contains(position)) {
+            continue;
+        }
+
+        // Only use the time left until the next frame is due
+        if(timer.elapsed() + render_estimate > deadline) {
             break;
         }
+
+        TraceScope trace_scope("Prefetch frame", position);
+
+        QElapsedTimer render_timer;
+        render_timer.start();
+
+        if(DecodeFrame(position)) {
+            AVFrame* frame = RenderFrame(filter);
+
+            display_cache.Insert(position, av_frame_clone(frame));
+            CacheProxy(position, frame);
+
+            FreeFilterData();
+        }
+
+        render_estimate = 0.8f * render_estimate + 0.2f * render_timer.elapsed();
+    }
+}
+
+void ZeitEngine::Play()
+{
+    control_mutex.lock();
+    stop_flag = false;
+    pause_flag = false;
+    playing = true;
+    ZeitPlayback initial_mode = playback_flag;
+    control_mutex.unlock();
+
+    if(initial_mode == ZEIT_PLAYBACK_REVERSE) {
+        playback_direction = -1;
+    } else if(initial_mode == ZEIT_PLAYBACK_FORWARD) {
+        playback_direction = 1;
+    }
+
+    // Resume next to the frame on display, previews re-render it
+    double playhead = sequence_position;
+    bool advance = !preview_flag && sequence_position >= 0;
+
+    if(sequence_position < 0) {
+        playhead = (playback_direction < 0) ? source_sequence.size() - 1 : 0;
+    }
+
+    stats.Reset();
+
+    double ticks = 1.0;
+    bool first_iteration = true;
+    bool finished = false;
+
+    if(!preview_flag) {
+        emit MessageUpdated("Playback started");
+    }
+
+    while(true) {
+        control_mutex.lock();
+
+        float frame_timeframe = FrameInterval(configured_framerate);
+
+        double speed = std::min(std::max((double)speed_flag, 0.25), 8.0);
+
+        // Beyond 1x, keep up with the wall clock if rendering falls behind
+        if(!first_iteration && speed > 1.0) {
+            ticks = std::max(1.0, timer.elapsed() / (double)frame_timeframe);
+        }
+
+        timer.start();
+        first_iteration = false;
+
+        if(seek_flag >= 0) {
+            playhead = seek_flag;
+            seek_flag = -1;
+            advance = false;
+            finished = false;
+        }
+
+        if(step_flag != 0) {
+            playhead += step_flag;
+            step_flag = 0;
+            advance = false;
+            finished = false;
+        }
+
+        ZeitPlayback mode = playback_flag;
+        bool loop = loop_flag;
+
+        bool stop_requested = stop_flag;
+        bool pause_requested = pause_flag;
+
+        bool flip_x = flip_x_flag;
+        bool flip_y = flip_y_flag;
+        bool rotate_90d_cw = rotate_90d_cw_flag;
+
+        ZeitFilter filter = filter_flag;
+
+        control_mutex.unlock();
+
+        if(mode == ZEIT_PLAYBACK_FORWARD) {
+            playback_direction = 1;
+        } else if(mode == ZEIT_PLAYBACK_REVERSE) {
+            playback_direction = -1;
+        }
+
+        if(advance) {
+            finished = !AdvancePlayhead(&playhead, &playback_direction, speed * ticks, mode, loop);
+        }
+
+        advance = true;
+
+        if(stop_requested || pause_requested || finished) {
+            if(stop_requested) {
+                // Stopping rewinds, showing the first frame again
+                if(ShowFrame(0, filter, flip_x, flip_y, rotate_90d_cw)) {
+                    sequence_position = 0;
+                    emit PositionUpdated(sequence_position, source_sequence.size());
+                }
+
+                emit MessageUpdated("Playback stopped");
+            } else if(pause_requested) {
+                emit MessageUpdated("Playback paused");
+            } else {
+                emit MessageUpdated("Playback finished");
+            }
+
+            ReportStats(true);
+            break;
+        }
+
+        playhead = std::min(std::max(playhead, 0.0), source_sequence.size() - 1.0);
+        int position = (int)playhead;
+
+        // Below 1x the same frame stays on display for several ticks
+        if(position != sequence_position || preview_flag) {
+
+            // Beyond 1x frames are skipped anyway, so rather show a cached
+            // frame within the skipped stretch than decode the exact one
+            if(speed * ticks > 1.0 && !display_cache.Contains(position)) {
+                int cached_position;
+
+                if(display_cache.Nearest(position, (int)(speed * ticks / 2), &cached_position)) {
+                    position = cached_position;
+                }
+            }
+
+            if(!ShowFrame(position, filter, flip_x, flip_y, rotate_90d_cw)) {
+                // If decoding fails (e.g. faulty frame) we abandon the frame
+                // and just skip to the next iteration with the next frame
+                playhead = position;
+                finished = !AdvancePlayhead(&playhead, &playback_direction, std::max(speed, 1.0), mode, loop);
+
+                if(preview_flag && finished) {
+                    preview_flag = false;
+                    break;
+                }
+
+                advance = false;
+                continue;
+            }
+
+            sequence_position = position;
+            emit PositionUpdated(sequence_position, source_sequence.size());
+        }
+
+        stats.CountFrame();
+        ReportStats(false);
+
+        if(preview_flag) {
+            preview_flag = false;
+            break;
+        }
+
+        // Use the rest of this frame's time to render upcoming frames
+        Prefetch(playhead, playback_direction, speed, mode, loop, filter, frame_timeframe);
+
+        if(timer.elapsed() <= frame_timeframe) {
+            TraceScope trace_scope("Sleep");
+            Sleep(frame_timeframe - timer.elapsed());
+        }
+    }
+
+    control_mutex.lock();
+    playing = false;
+
+    // A seek or step that came after the last iteration read the flags
+    // was left to playback, serve it now
+    bool serve = (seek_flag >= 0 || step_flag != 0) && !seek_queued;
+    seek_queued = seek_queued || serve;
+
+    control_mutex.unlock();
+
+    if(serve) {
+        QMetaObject::invokeMethod(this, "ServeSeek", Qt::QueuedConnection);
+    }
+
+    FreeFilter();
+    FreeScaler();
+
+    Tracer::Dump();
+}
+
+void ZeitEngine::Pause()
+{
+    control_mutex.lock();
+    pause_flag = true;
+    control_mutex.unlock();
+}
+
+void ZeitEngine::Seek(const int position)
+{
+    control_mutex.lock();
+
+    seek_flag = std::max(0, position);
+    step_flag = 0;
+
+    bool serve = !playing && !seek_queued;
+    seek_queued = seek_queued || serve;
+
+    control_mutex.unlock();
+
+    if(serve) {
+        QMetaObject::invokeMethod(this, "ServeSeek", Qt::QueuedConnection);
+    }
+}
+
+void ZeitEngine::Step(const int frames)
+{
+    control_mutex.lock();
+
+    step_flag += frames;
+
+    bool serve = !playing && !seek_queued;
+    seek_queued = seek_queued || serve;
+
+    control_mutex.unlock();
+
+    if(serve) {
+        QMetaObject::invokeMethod(this, "ServeSeek", Qt::QueuedConnection);
+    }
+}
+
+void ZeitEngine::ServeSeek()
+{
+    if(source_sequence.isEmpty()) {
+        control_mutex.lock();
+        seek_queued = false;
+        seek_flag = -1;
+        step_flag = 0;
+        control_mutex.unlock();
+        return;
+    }
+
+    while(true) {
+        control_mutex.lock();
+
+        seek_queued = false;
+
+        bool requested = seek_flag >= 0 || step_flag != 0;
+        int position = (seek_flag >= 0 ? seek_flag : std::max(0, sequence_position)) + step_flag;
+
+        seek_flag = -1;
+        step_flag = 0;
+
+        bool flip_x = flip_x_flag;
+        bool flip_y = flip_y_flag;
+        bool rotate_90d_cw = rotate_90d_cw_flag;
+
+        ZeitFilter filter = filter_flag;
+
+        control_mutex.unlock();
+
+        if(!requested) {
+            break;
+        }
+
+        position = std::min(std::max(position, 0), source_sequence.size() - 1);
+
+        // Show a nearby frame right away if the exact one has to be decoded
+        if(display_initialized &&
+           filter == cached_filter &&
+           rotate_90d_cw == rotation_initialized &&
+           !display_cache.Contains(position)) {
+
+            int max_distance = std::max((int)SEEK_PROXY_MAX_DISTANCE, source_sequence.size() / 256);
+            int display_position = -1;
+            int proxy_position = -1;
+
+            AVFrame* display_nearest = display_cache.Nearest(position, max_distance, &display_position);
+            AVFrame* proxy_nearest = proxy_cache.Nearest(position, max_distance, &proxy_position);
+
+            AVFrame* nearest = display_nearest;
+
+            if(proxy_nearest != NULL &&
+               (display_nearest == NULL || qAbs(proxy_position - position) < qAbs(display_position - position))) {
+                nearest = proxy_nearest;
+            }
+
+            if(nearest != NULL) {
+                PresentFrame(nearest, flip_x, flip_y, rotate_90d_cw);
+                emit PositionUpdated(position, source_sequence.size());
+            }
+
+            // Skip refining if the user has moved on already
+            control_mutex.lock();
+            bool superseded = seek_flag >= 0 || step_flag != 0;
+            control_mutex.unlock();
+
+            if(superseded) {
+                sequence_position = position;
+                continue;
+            }
+        }
+
+        if(ShowFrame(position, filter, flip_x, flip_y, rotate_90d_cw)) {
+            sequence_position = position;
+            emit PositionUpdated(sequence_position, source_sequence.size());
+        }
+    }
+
+    FreeFilter();
+    FreeScaler();
+}
+
+ZeitEngine::ExportEncoder::ExportEncoder(const ExportRendition& rendition)
+{
+    this->rendition = rendition;
+
+    context = NULL;
+    frame = NULL;
+    packet = NULL;
+    format_context = NULL;
+    stream = NULL;
+    initialized = false;
+
+    scaler = NULL;
+    scaled_frame = NULL;
+
+    failure_message = NULL;
+    failure_code = 0;
+
+    // Segments and journal live next to the output until it is stitched
+    segment_dir = QDir(rendition.file.absoluteFilePath() + ".segments");
+    resumed_segments = 0;
+    segment_packets = 0;
+}
+
+int ZeitEngine::ExportLength(const int length, const int in, const int out, const int stride)
+{
+    const int first = std::max(0, in);
+    const int last = (out < 0) ? length - 1 : std::min(out, length - 1);
+
+    if(last < first) {
+        return 0;
+    }
+
+    return (last - first) / std::max(1, stride) + 1;
+}
+
+void ZeitEngine::CheckStop()
+{
+    control_mutex.lock();
+    bool stop_requested = stop_flag;
+    control_mutex.unlock();
+
+    if(stop_requested) {
+        throw("Cancelled on request");
+    }
+}
+
+QByteArray ZeitEngine::JournalKey(const ExportRendition& rendition)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+
+    // Frames replaced or touched since the segments were encoded make them stale
+    for(int i = 0; i < source_sequence.size(); i++) {
+        QFileInfo source(source_sequence.at(i).absoluteFilePath());
+
+        hash.addData(source.absoluteFilePath().toUtf8());
+        hash.addData(QString(" %1 %2\n").arg(source.size()).arg(source.lastModified().toMSecsSinceEpoch()).toUtf8());
+    }
+
+    // So does a sensor description that changed the debayering
+    if(operation_mode == ZEIT_MODE_ZD) {
+        QString format = QString("%1 %2 %3 %4 %5 %6 %7 %8")
+                         .arg(zd_format.width)
+                         .arg(zd_format.height)
+                         .arg(zd_format.pattern)
+                         .arg(zd_format.bits)
+                         .arg(zd_format.black_level)
+                         .arg(zd_format.white_level)
+                         .arg(zd_format.transfer)
+                         .arg(zd_format.header_size);
+
+        for(int i = 0; i < 3; i++) {
+            format += QString(" %1").arg(zd_format.gains[i], 0, 'g', 9);
+        }
+
+        for(int i = 0; i < 9; i++) {
+            format += QString(" %1").arg(zd_format.matrix[i], 0, 'g', 9);
+        }
+
+        hash.addData(format.toUtf8());
+    }
+
+    control_mutex.lock();
+    QString settings = QString("%1 %2 %3 %4 %5 %6 %7 %8 %9 %10 %11 %12 %13 %14 %15 %16")
+                       .arg(configured_framerate)
+                       .arg(filter_flag)
+                       .arg(export_height_flag)
+                       .arg(export_depth_flag)
+                       .arg(rendition.profile)
+                       .arg(rendition.max_height)
+                       .arg(export_flip_x)
+                       .arg(export_flip_y)
+                       .arg(export_rotate_90d_cw)
+                       .arg(export_in_flag)
+                       .arg(export_out_flag)
+                       .arg(export_stride_flag)
+                       .arg(SEGMENT_FRAMES)
+                       .arg(export_scaler_flag)
+                       .arg(export_pixel_format)
+                       .arg(avcodec_get_name(export_codec_id));
+    control_mutex.unlock();
+
+    hash.addData(settings.toUtf8());
+
+    return hash.result().toHex();
+}
+
+int ZeitEngine::ResumeJournal(ExportEncoder* encoder)
+{
+    const QDir& segment_dir = encoder->segment_dir;
+    const QString journal_path = segment_dir.filePath("journal");
+    const QByteArray header = "zeitmachine export journal " + JournalKey(encoder->rendition);
+
+    QList<QByteArray> entries;
+
+    QFile journal(journal_path);
+
+    if(journal.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        if(journal.readLine().trimmed() == header) {
+            while(!journal.atEnd()) {
+                // A line cut short by a crash ends the usable part
+                QByteArray line = journal.readLine();
+                if(!line.endsWith('\n')) {
+                    break;
+                }
+
+                QList<QByteArray> fields = line.trimmed().split(' ');
+                if(fields.size() != 4 || fields.at(0) != "segment" || fields.at(1).toInt() != entries.size()) {
+                    break;
+                }
+
+                // "-" marks a segment without a single decodable frame,
+                // others have to be complete, not merely exist
+                if(fields.at(2) != "-" && CountPackets(segment_dir.filePath(fields.at(2))) != fields.at(3).toInt()) {
+                    av_log(NULL, AV_LOG_INFO, "Segment %d is incomplete and exported again\n", entries.size());
+                    break;
+                }
+
+                entries.append(line);
+            }
+        }
+
+        journal.close();
+    }
+
+    if(entries.isEmpty()) {
+        // Nothing to resume, leftovers of other exports are of no use
+        QDir(segment_dir).removeRecursively();
+        QDir().mkpath(segment_dir.absolutePath());
+    }
+
+    // Rewrite the journal with the usable entries only, so new ones follow them
+    if(!journal.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        throw("Could not write the export journal");
+    }
+
+    journal.write(header + "\n");
+
+    for(int i = 0; i < entries.size(); i++) {
+        journal.write(entries.at(i));
+
+        QByteArray file_name = entries.at(i).trimmed().split(' ').at(2);
+        if(file_name != "-") {
+            encoder->segments.append(segment_dir.filePath(file_name));
+        }
+    }
+
+    journal.close();
+
+    if(!SyncPath(journal_path) || !SyncPath(segment_dir.absolutePath())) {
+        throw("Could not write the export journal");
+    }
+
+    return entries.size();
+}
+
+void ZeitEngine::AppendJournal(ExportEncoder* encoder, const int segment, const QString file_name, const int packets)
+{
+    const QString journal_path = encoder->segment_dir.filePath("journal");
+
+    // The segment first, an entry must never get to the disk before it
+    if(!file_name.isEmpty() &&
+       (!SyncPath(encoder->segment_dir.filePath(file_name)) || !SyncPath(encoder->segment_dir.absolutePath()))) {
+        throw("Could not write the segment to disk");
+    }
+
+    QFile journal(journal_path);
+
+    if(!journal.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) {
+        throw("Could not write the export journal");
+    }
+
+    journal.write(QString("segment %1 %2 %3\n").arg(segment).arg(file_name.isEmpty() ? "-" : file_name).arg(packets).toUtf8());
+    journal.close();
+
+    if(journal.error() != QFileDevice::NoError || !SyncPath(journal_path)) {
+        throw("Could not write the export journal");
+    }
+}
+
+int ZeitEngine::CountPackets(const QString& file)
+{
+    AVFormatContext* segment_context = NULL;
+    AVPacket* packet = av_packet_alloc();
+    int packets = -1;
+
+    if(packet != NULL && avformat_open_input(&segment_context, file.toUtf8().data(), NULL, NULL) >= 0) {
+        packets = 0;
+
+        while(av_read_frame(segment_context, packet) >= 0) {
+            packets++;
+            av_packet_unref(packet);
+        }
+
+        avformat_close_input(&segment_context);
+    }
+
+    av_packet_free(&packet);
+
+    return packets;
+}
+
+void ZeitEngine::CloseSegment(ExportEncoder* encoder, const bool drain)
+{
+    if(drain) {
+        ExportFrame(encoder, NULL, encoder->segment_file, 0);
+        stats.Take(&encoder->stats);
+    }
+
+    CloseExport(encoder);
+}
+
+void ZeitEngine::StitchSegments(const QStringList& segments, const QFileInfo output_file)
+{
+    AVFormatContext* stitch_context = NULL;
+    AVFormatContext* segment_context = NULL;
+    AVStream* stitch_stream = NULL;
+    AVPacket* packet = av_packet_alloc();
+    int64_t last_dts = AV_NOPTS_VALUE;
+    int64_t end_pts = AV_NOPTS_VALUE;
+    int ret;
+
+    try {
+        if(packet == NULL) {
+            throw("Could not allocate stitch packet");
+        }
+
+        avformat_alloc_output_context2(&stitch_context,
+                                       NULL,
+                                       NULL,
+                                       output_file.absoluteFilePath().toUtf8().data());
+        if(!stitch_context) {
+            throw("Could not allocate output context");
+        }
+
+        for(int i = 0; i < segments.size(); i++) {
+            if((ret = avformat_open_input(&segment_context, segments.at(i).toUtf8().data(), NULL, NULL)) < 0) {
+                throw(ret);
+            }
+
+            if((ret = avformat_find_stream_info(segment_context, NULL)) < 0) {
+                throw(ret);
+            }
+
+            AVStream* segment_stream = segment_context->streams[0];
+
+            // Segments share their settings, the first one describes them all
+            if(stitch_stream == NULL) {
+                stitch_stream = avformat_new_stream(stitch_context, NULL);
+                if(!stitch_stream) {
+                    throw("Could not allocate output stream");
+                }
+
+                if((ret = avcodec_parameters_copy(stitch_stream->codecpar, segment_stream->codecpar)) < 0) {
+                    throw(ret);
+                }
+
+                stitch_stream->codecpar->codec_tag = 0;
+                stitch_stream->time_base = segment_stream->time_base;
+
+                // Carries the capture time over
+                av_dict_copy(&stitch_context->metadata, segment_context->metadata, 0);
+
+                if(!(stitch_context->oformat->flags & AVFMT_NOFILE)) {
+                    if((ret = avio_open(&stitch_context->pb, output_file.absoluteFilePath().toUtf8().data(), AVIO_FLAG_WRITE)) < 0) {
+                        throw(ret);
+                    }
+                }
+
+                if((ret = avformat_write_header(stitch_context, NULL)) < 0) {
+                    throw(ret);
+                }
+            }
+
+            // Timestamps are global already, every segment encoded the
+            // positions of its own frames; only reordering delays that differ
+            // between segments shift a segment as a whole, never its frames
+            // against each other
+            bool first_packet = true;
+            int64_t offset = 0;
+
+            while(av_read_frame(segment_context, packet) >= 0) {
+                av_packet_rescale_ts(packet, segment_stream->time_base, stitch_stream->time_base);
+                packet->stream_index = stitch_stream->index;
+                packet->pos = -1;
+
+                // Segments start with a keyframe, presented before all others
+                if(first_packet) {
+                    if(last_dts != AV_NOPTS_VALUE && packet->dts <= last_dts) {
+                        offset = last_dts + 1 - packet->dts;
+                    }
+
+                    if(end_pts != AV_NOPTS_VALUE && packet->pts + offset < end_pts) {
+                        offset = end_pts - packet->pts;
+                    }
+
+                    first_packet = false;
+                }
+
+                packet->pts += offset;
+                packet->dts += offset;
+
+                if(last_dts != AV_NOPTS_VALUE && packet->dts <= last_dts) {
+                    av_packet_unref(packet);
+                    throw("The segments' timestamps cannot be joined");
+                }
+
+                last_dts = packet->dts;
+                end_pts = std::max(end_pts, packet->pts + std::max(packet->duration, (int64_t)1));
+
+                ret = av_interleaved_write_frame(stitch_context, packet);
+                av_packet_unref(packet);
+
+                if(ret < 0) {
+                    throw(ret);
+                }
+            }
+
+            avformat_close_input(&segment_context);
+        }
+
+        if((ret = av_write_trailer(stitch_context)) < 0) {
+            throw(ret);
+        }
+    }
+    catch(...) {
+        avformat_close_input(&segment_context);
+
+        if(stitch_context != NULL) {
+            if(!(stitch_context->oformat->flags & AVFMT_NOFILE)) {
+                avio_closep(&stitch_context->pb);
+            }
+            avformat_free_context(stitch_context);
+        }
+
+        av_packet_free(&packet);
+
+        throw;
+    }
+
+    if(!(stitch_context->oformat->flags & AVFMT_NOFILE)) {
+        avio_closep(&stitch_context->pb);
+    }
+
+    avformat_free_context(stitch_context);
+    av_packet_free(&packet);
+}
+
+bool ZeitEngine::Export(const QFileInfo file)
+{
+    control_mutex.lock();
+    ExportRendition rendition = { file, 0, profile_flag };
+    control_mutex.unlock();
+
+    QList<ExportRendition> renditions;
+    renditions.append(rendition);
+
+    return ExportRenditions(renditions);
+}
+
+bool ZeitEngine::ExportRenditions(const QList<ExportRendition>& renditions)
+{
+    int frame = 0;
+    bool exported = false;
+    bool cancelled = false;
+
+    QList<ExportEncoder*> encoders;
+
+    for(int i = 0; i < renditions.size(); i++) {
+        encoders.append(new ExportEncoder(renditions.at(i)));
+    }
+
+    // Only the frames in range and on the stride are ever decoded, they are
+    // numbered (and timestamped) consecutively in the video
+    control_mutex.lock();
+    const int first = std::max(0, export_in_flag);
+    const int stride = std::max(1, export_stride_flag);
+    const int frames = ExportLength(source_sequence.size(), export_in_flag, export_out_flag, export_stride_flag);
+    const unsigned int export_height = export_height_flag;
+    const bool deep = (export_depth_flag == ZEIT_DEPTH_10);
+
+    export_flip_x = flip_x_flag;
+    export_flip_y = flip_y_flag;
+    export_rotate_90d_cw = rotate_90d_cw_flag;
+
+    // Read once, the scaler is set up for the format the filter works in
+    const ZeitFilter filter = filter_flag;
+    control_mutex.unlock();
+
+    export_pixel_format = deep ? DEEP_EXPORT_PIXELFORMAT : EXPORT_PIXELFORMAT;
+    export_codec_id = deep ? DeepCodecId() : EXPORT_CODEC_ID;
+
+    // 10 bit filtering works on 16 bit RGB, filters that only know 8 bit
+    // formats get a conversion from libavfilter
+    const AVPixelFormat scale_pixel_format = (deep && filter != ZEIT_FILTER_NONE) ? DEEP_FILTER_PIXEL_FORMAT : export_pixel_format;
+
+    stats.Reset();
+
+    // The scaler may still be set up for the display
+    FreeScaler();
+
+    try {
+        if(frames == 0) {
+            throw("The export range is empty");
+        }
+
+        if(encoders.isEmpty()) {
+            throw("Nothing to export to");
+        }
+
+        // Renditions share nothing but the source frames, two of them in the
+        // same file would overwrite each other's segments
+        for(int i = 0; i < encoders.size(); i++) {
+            for(int j = 0; j < i; j++) {
+                if(encoders.at(i)->rendition.file.absoluteFilePath() == encoders.at(j)->rendition.file.absoluteFilePath()) {
+                    throw("Renditions need distinct output files");
+                }
+            }
+
+            // Caught here rather than after encoding all segments
+            AVOutputFormat* output_format = av_guess_format(NULL, encoders.at(i)->rendition.file.fileName().toUtf8().constData(), NULL);
+
+            if(output_format != NULL && avformat_query_codec(output_format, export_codec_id, FF_COMPLIANCE_NORMAL) == 0) {
+                av_log(NULL, AV_LOG_ERROR, "%s cannot hold %s%s video%s\n",
+                       output_format->name,
+                       deep ? "10 bit " : "",
+                       avcodec_get_name(export_codec_id),
+                       deep ? ", use .mkv or .mov" : "");
+                throw("The output file type cannot hold the exported video");
+            }
+        }
+
+        // Decoding starts at the rendition that has the least segments done,
+        // the others skip segments they took over from an earlier run
+        frame = frames;
+
+        for(int i = 0; i < encoders.size(); i++) {
+            ExportEncoder* encoder = encoders.at(i);
+
+            if(!QDir().mkpath(encoder->segment_dir.absolutePath())) {
+                throw("Could not create the segment folder");
+            }
+
+            encoder->resumed_segments = ResumeJournal(encoder);
+            frame = std::min(frame, encoder->resumed_segments * (int)SEGMENT_FRAMES);
+        }
+
+        if(frame > 0) {
+            emit MessageUpdated(QString("Resuming export at frame %1 ...").arg(frame));
+        }
+
+        while(frame < frames) {
+            const int segment = frame / SEGMENT_FRAMES;
+            const int segment_end = std::min((segment + 1) * (int)SEGMENT_FRAMES, frames);
+
+            // Between segments nothing runs on the pools, and every segment
+            // gets new encoders, so a changed budget takes effect here
+            BudgetThreads(encoders.size());
+
+            // NUT keeps the encoder's time base and timestamps as they are
+            for(int i = 0; i < encoders.size(); i++) {
+                encoders.at(i)->segment_file = QFileInfo(encoders.at(i)->segment_dir.filePath(QString("segment-%1.nut").arg(segment, 5, 10, QChar('0'))));
+            }
+
+            for(; frame < segment_end; frame++) {
+                const int position = first + frame * stride;
+
+                TraceScope trace_scope("Export frame", position);
+
+                emit ProgressUpdated("Encoding frames", frame, frames);
+
+                // Checked between the stages as well, so a stop request never
+                // waits for more than the stage at hand
+                CheckStop();
+
+                if(!DecodeFrame(position)) {
+                    // If decoding fails (e.g. faulty frame) we abandon the frame
+                    // and just skip to the next iteration with the next frame
+                    continue;
+                }
+
+                CheckStop();
+
+                AVFrame* source_frame = decoder_frame;
+
+                if(operation_mode == ZEIT_MODE_ZD) {
+                    if(deep) {
+                        DeepDebayerFrame(decoder_frame);
+                        source_frame = deep_debayered_frame;
+                    } else {
+                        DebayerFrame(decoder_frame, false);
+                        source_frame = debayered_frame;
+                    }
+                    CheckStop();
+                }
+
+                // Downscaling comes first, so the filter and every encoder
+                // work on the smaller frame
+                int target_width = source_frame->width;
+                int target_height = source_frame->height;
+
+                FitHeight(source_frame->width,
+                          source_frame->height,
+                          export_height,
+                          export_rotate_90d_cw,
+                          &target_width,
+                          &target_height);
+
+                ScaleFrame(source_frame,
+                           target_width,
+                           target_height,
+                           scale_pixel_format,
+                           ScalerFlags(ZEIT_SCALE_EXPORT, source_frame->width, source_frame->height, target_width, target_height));
+
+                AVFrame* export_frame = scaler_frame;
+
+                if(filter != ZEIT_FILTER_NONE) {
+                    CheckStop();
+                    FilterFrame(scaler_frame, filter);
+                    RescaleFrame(filter_frame,
+                                 filter_frame->width,
+                                 filter_frame->height,
+                                 export_pixel_format,
+                                 ScalerFlags(ZEIT_SCALE_EXPORT, filter_frame->width, filter_frame->height, filter_frame->width, filter_frame->height));
+                    FreeFilterData();
+
+                    export_frame = rescaler_frame;
+                }
+
+                // The encoders keep their own copy of the frame, so one
+                // decoded frame serves all renditions
+                CheckStop();
+                EncodeRenditions(encoders, export_frame, segment, frame);
+
+                stats.CountFrame();
+                ReportStats(false);
+            }
+
+            // Each segment gets an encoder of its own, so it starts with a
+            // keyframe and never references frames of another segment
+            for(int i = 0; i < encoders.size(); i++) {
+                ExportEncoder* encoder = encoders.at(i);
+
+                if(segment < encoder->resumed_segments) {
+                    continue;
+                }
+
+                if(encoder->initialized) {
+                    CheckStop();
+                    CloseSegment(encoder, true);
+                    encoder->segments.append(encoder->segment_file.absoluteFilePath());
+                    AppendJournal(encoder, segment, encoder->segment_file.fileName(), encoder->segment_packets);
+                } else {
+                    AppendJournal(encoder, segment, QString(), 0);
+                }
+            }
+        }
+
+        for(int i = 0; i < encoders.size(); i++) {
+            if(encoders.at(i)->segments.isEmpty()) {
+                throw("Not a single frame could be decoded");
+            }
+        }
+
+        emit ProgressUpdated("Encoding complete", frames, frames);
+        emit MessageUpdated("Encoding complete, finishing up export ...");
+
+        for(int i = 0; i < encoders.size(); i++) {
+            StitchSegments(encoders.at(i)->segments, encoders.at(i)->rendition.file);
+        }
+
+        exported = true;
+    }
+    catch(const char* message) {
+        control_mutex.lock();
+        cancelled = stop_flag;
+        control_mutex.unlock();
+
+        if(cancelled) {
+            av_log(NULL, AV_LOG_INFO, "Export cancelled at frame %d\n", frame);
+        } else {
+            av_log(NULL, AV_LOG_ERROR, "Export failed: %s\n", message);
+        }
+    }
+    catch(int code) {
+        char message[255];
+        av_make_error_string(message, 255, code);
+        av_log(NULL, AV_LOG_ERROR, "Export failed: %d - %s\n", code, message);
     }
 
-    FreeFilter();
-    FreeScaler();
-}
+    ReportStats(true);
 
-void ZeitEngine::Export(const QFileInfo file)
-{
-    sequence_iterator = source_sequence.constBegin();
-    bool working;
+    control_mutex.lock();
+    bool keep_partial = cancelled && keep_partial_flag;
+    control_mutex.unlock();
 
-    do {
-        if(sequence_iterator != source_sequence.constEnd()) {
-            emit ProgressUpdated("Encoding frames", sequence_iterator - source_sequence.constBegin(), source_sequence.size());
+    bool kept = keep_partial;
 
-            control_mutex.lock();
-            ZeitFilter filter = filter_flag;
-            control_mutex.unlock();
+    for(int i = 0; i < encoders.size(); i++) {
+        ExportEncoder* encoder = encoders.at(i);
+        bool keep = keep_partial;
 
-            if(!DecodeFrame()) {
-                // If decoding fails (e.g. faulty frame) we abandon the frame
-                // and just skip to the next iteration with the next frame
-                sequence_iterator++;
-                continue;
-            }
+        // Either the partial segment is finished like the others (for keeping
+        // what was done so far) or its buffered frames are just dropped
+        if(encoder->initialized) {
+            try {
+                CloseSegment(encoder, keep);
 
-            if(operation_mode == ZEIT_MODE_ZD) {
-                DebayerFrame(decoder_frame, false);
-                ScaleFrame(debayered_frame,
-                           debayered_frame->width,
-                           debayered_frame->height,
-                           EXPORT_PIXELFORMAT);
-            } else {
-                ScaleFrame(decoder_frame,
-                           decoder_frame->width,
-                           decoder_frame->height,
-                           EXPORT_PIXELFORMAT);
+                if(keep) {
+                    encoder->segments.append(encoder->segment_file.absoluteFilePath());
+                }
             }
+            catch(const char* message) {
+                av_log(NULL, AV_LOG_ERROR, "Closing the segment failed: %s\n", message);
+                CloseExport(encoder);
+            }
+            catch(int code) {
+                av_log(NULL, AV_LOG_ERROR, "Closing the segment failed: %d\n", code);
+                CloseExport(encoder);
+            }
+        }
 
-            if(filter != ZEIT_FILTER_NONE) {
-                FilterFrame(scaler_frame, filter);
-                RescaleFrame(filter_frame,
-                             filter_frame->width,
-                             filter_frame->height,
-                             EXPORT_PIXELFORMAT);
-
-                working = ExportFrame(rescaler_frame, file);
+        if(keep && !encoder->segments.isEmpty()) {
+            emit ProgressUpdated("Writing buffered frames", 0, 0);
 
-                FreeFilterData();
-            } else {
-                working = ExportFrame(scaler_frame, file);
+            try {
+                StitchSegments(encoder->segments, encoder->rendition.file);
             }
+            catch(const char* message) {
+                av_log(NULL, AV_LOG_ERROR, "Finalizing the partial export failed: %s\n", message);
+                keep = false;
+            }
+            catch(int code) {
+                av_log(NULL, AV_LOG_ERROR, "Finalizing the partial export failed: %d\n", code);
+                keep = false;
+            }
+        }
 
-            sequence_iterator++;
-        } else {
-            emit ProgressUpdated("Writing buffered frames", 0, 0);
+        kept = kept && keep;
 
-            working = ExportFrame(NULL, file);
+        // Segments are kept after failures only, for resuming
+        if(exported || cancelled || encoder->segments.isEmpty()) {
+            encoder->segment_dir.removeRecursively();
+        } else {
+            av_log(NULL, AV_LOG_INFO, "Exporting %s again resumes after %d segments\n",
+                   encoder->rendition.file.fileName().toUtf8().constData(),
+                   encoder->segments.size());
         }
 
-    } while(working);
+        FreeRenditionScaler(encoder);
+        delete encoder;
+    }
 
-    emit ProgressUpdated("Encoding complete", source_sequence.size(), source_sequence.size());
-    emit MessageUpdated("Encoding complete, finishing up export ...");
+    ControlsEnabled(true);
 
-    CloseExport();
     FreeFilter();
     FreeScaler();
     FreeRescaler();
 
-    emit MessageUpdated("Export complete");
+    Tracer::Dump();
+
+    if(cancelled) {
+        emit MessageUpdated(kept ? "Export cancelled, partial video kept" : "Export cancelled");
+    } else {
+        emit MessageUpdated(exported ? "Export complete" : "Export failed");
+    }
+
+    return exported;
 }
 
-bool ZeitEngine::DecodeFrame()
+bool ZeitEngine::DecodeFrame(const int position)
 {
+    StageTimer stage_timer(&stats, ZEIT_STAGE_DECODE);
+
     int ret;
 
     try
     {
-        // Necessary procedure to get a stable reference to a char* path representation - well, check again.
-        QByteArray image_bytearray = (*sequence_iterator).absoluteFilePath().toUtf8();
-        const char* image_cstr = image_bytearray.data();
-
-        // Open input file
-        if ((ret = avformat_open_input(&decoder_format_context, image_cstr, decoder_format, NULL)) < 0) {
-            av_log(NULL, AV_LOG_ERROR, "Failed to open input file '%s'\n", image_cstr);
-            throw(ret);
-        }
-
         // Allocate decoder packet
         decoder_packet = new AVPacket;
         av_init_packet(decoder_packet);
 
-        // Read packet
-        if( (ret = av_read_frame(decoder_format_context, decoder_packet)) < 0 ) {
-            av_log(NULL, AV_LOG_ERROR, "Failed to read frame from file\n");
-            throw(ret);
+        if(operation_mode == ZEIT_MODE_ZD && zd_format.header_size > 0) {
+            // The raw video reader would take the header for samples, so the
+            // decoder only gets to see what follows it
+            if( (ret = av_new_packet(decoder_packet, zd_format.FrameSize())) < 0 ) {
+                av_log(NULL, AV_LOG_ERROR, "Failed to allocate decoder packet\n");
+                throw(ret);
+            }
+
+            if(!zd_format.ReadSamples(source_sequence.at(position), (char*)decoder_packet->data)) {
+                throw(AVERROR_INVALIDDATA);
+            }
+        } else {
+            // Necessary procedure to get a stable reference to a char* path representation - well, check again.
+            QByteArray image_bytearray = source_sequence.at(position).absoluteFilePath().toUtf8();
+            const char* image_cstr = image_bytearray.data();
+
+            // Open input file
+            if ((ret = avformat_open_input(&decoder_format_context, image_cstr, decoder_format, NULL)) < 0) {
+                av_log(NULL, AV_LOG_ERROR, "Failed to open input file '%s'\n", image_cstr);
+                throw(ret);
+            }
+
+            // Read packet
+            if( (ret = av_read_frame(decoder_format_context, decoder_packet)) < 0 ) {
+                av_log(NULL, AV_LOG_ERROR, "Failed to read frame from file\n");
+                throw(ret);
+            }
         }
 
         // Send packet to decoder
@@ -538,219 +1984,139 @@ bool ZeitEngine::DecodeFrame()
 
 void ZeitEngine::DebayerFrame(AVFrame *frame, bool fast_debayering)
 {
-    int ret;
-
-    // Allocate debayer frame
-    if( !(debayered_frame = av_frame_alloc()) ) {
-        av_log(NULL, AV_LOG_ERROR, "Failed to allocate debayer frame\n");
-        ret = AVERROR(ENOMEM);
-        throw(ret);
-    }
+    StageTimer stage_timer(&stats, ZEIT_STAGE_DEBAYER);
 
-    av_frame_copy_props(debayered_frame, frame);
-    debayered_frame->width = frame->width;
-    debayered_frame->height = frame->height;
-    debayered_frame->format = AV_PIX_FMT_RGB24;
+    int ret;
 
-    if( av_image_alloc(debayered_frame->data,
-                       debayered_frame->linesize,
-                       debayered_frame->width,
-                       debayered_frame->height,
-                       (AVPixelFormat)debayered_frame->format,
-                       32) < 0 ) {
-        fprintf(stderr, "Could not allocate debayer picture\n");
-        exit(1);
+    // (Re-)allocate debayer frame only when the geometry changes
+    if(debayered_frame != NULL &&
+       (debayered_frame->width != frame->width || debayered_frame->height != frame->height)) {
+        FreeDebayer();
     }
 
-    for(int y = 0; y < frame->height; y++) {
-        for(int x = 0; x < frame->width; x++) {
-
-            int factor = 16; // 12bit (0-4096) to 8bit (0-256) range normalization factor
-
-            uint8_t *source_pixel_ptr = frame->data[0] + (y * frame->linesize[0]) + (x * sizeof(uint16_t));
-            uint8_t *target_pixel_ptr = debayered_frame->data[0] + (y * debayered_frame->linesize[0]) + (x * 3);
-
-            uint8_t *target_pixel_red_ptr = target_pixel_ptr;
-            uint8_t *target_pixel_green_ptr = target_pixel_ptr + sizeof(uint8_t);
-            uint8_t *target_pixel_blue_ptr = target_pixel_ptr + 2 * sizeof(uint8_t);
-
-            if(fast_debayering) {
-                // Fast debayering using nearest neighbour estimation
-
-                if(x % 2 == 0 && y % 2 == 0) {
-
-                    // *  *  *
-                    // * <G>[R]
-                    // * [B] G
-
-                    *target_pixel_red_ptr = *(uint16_t*)(source_pixel_ptr + sizeof(uint16_t)) / factor;
-                    *target_pixel_green_ptr = *(uint16_t*)source_pixel_ptr / factor;
-                    *target_pixel_blue_ptr = *(uint16_t*)(source_pixel_ptr + frame->linesize[0]) / factor;
-
-                } else if(x % 2 == 1 && y % 2 == 1) {
-
-                    //  G [R] *
-                    // [B]<G> *
-                    //  *  *  *
-
-                    *target_pixel_red_ptr = *(uint16_t*)(source_pixel_ptr - frame->linesize[0]) / factor;
-                    *target_pixel_green_ptr = *(uint16_t*)source_pixel_ptr / factor;
-                    *target_pixel_blue_ptr = *(uint16_t*)(source_pixel_ptr - sizeof(uint16_t)) / factor;
+    if(debayered_frame == NULL) {
+        if( !(debayered_frame = av_frame_alloc()) ) {
+            av_log(NULL, AV_LOG_ERROR, "Failed to allocate debayer frame\n");
+            ret = AVERROR(ENOMEM);
+            throw(ret);
+        }
 
+        debayered_frame->width = frame->width;
+        debayered_frame->height = frame->height;
+        debayered_frame->format = DEBAYER_PIXEL_FORMAT;
 
-                } else if(x % 2 == 1 && y % 2 == 0) {
+        if( av_image_alloc(debayered_frame->data,
+                           debayered_frame->linesize,
+                           debayered_frame->width,
+                           debayered_frame->height,
+                           (AVPixelFormat)debayered_frame->format,
+                           32) < 0 ) {
+            av_log(NULL, AV_LOG_ERROR, "Could not allocate debayer picture\n");
+            av_frame_free(&debayered_frame);
+            ret = AVERROR(ENOMEM);
+            throw(ret);
+        }
+    }
 
-                    //  *  *  *
-                    //  * [G]<R>
-                    //  * [B] G
+    av_frame_copy_props(debayered_frame, frame);
 
-                    *target_pixel_red_ptr = *(uint16_t*)source_pixel_ptr / factor;
-                    *target_pixel_green_ptr = *(uint16_t*)(source_pixel_ptr - sizeof(uint16_t)) / factor;
-                    *target_pixel_blue_ptr = *(uint16_t*)(source_pixel_ptr + frame->linesize[0] - sizeof(uint16_t)) / factor;
+    if(fast_debayering) {
+        fast_debayer_kernel(frame, debayered_frame, &debayer_colour, &band_pool);
+    } else {
+        debayer_kernel(frame, debayered_frame, &debayer_colour, &band_pool);
+    }
+}
 
-                } else if(x % 2 == 0 && y % 2 == 1) {
+void ZeitEngine::DeepDebayerFrame(AVFrame *frame)
+{
+    StageTimer stage_timer(&stats, ZEIT_STAGE_DEBAYER);
 
-                    //  *  *  *
-                    //  *  G [R]
-                    //  * <B>[G]
+    int ret;
 
-                    *target_pixel_red_ptr = *(uint16_t*)(source_pixel_ptr - frame->linesize[0] + sizeof(uint16_t)) / factor;
-                    *target_pixel_green_ptr = *(uint16_t*)(source_pixel_ptr + sizeof(uint16_t)) / factor;
-                    *target_pixel_blue_ptr = *(uint16_t*)source_pixel_ptr / factor;
+    // (Re-)allocate debayer frame only when the geometry changes
+    if(deep_debayered_frame != NULL &&
+       (deep_debayered_frame->width != frame->width || deep_debayered_frame->height != frame->height ||
+        deep_debayered_frame->format != deep_debayer_pixel_format)) {
+        av_freep(&deep_debayered_frame->data[0]);
+        av_frame_free(&deep_debayered_frame);
+    }
 
-                }
-            } else {
-                // Slow but better debayering using bilinear filtering
+    if(deep_debayered_frame == NULL) {
+        if( !(deep_debayered_frame = av_frame_alloc()) ) {
+            av_log(NULL, AV_LOG_ERROR, "Failed to allocate debayer frame\n");
+            ret = AVERROR(ENOMEM);
+            throw(ret);
+        }
 
-                if(x % 2 == 0 && y % 2 == 0) {
+        deep_debayered_frame->width = frame->width;
+        deep_debayered_frame->height = frame->height;
+        deep_debayered_frame->format = deep_debayer_pixel_format;
 
-                    if(x > 0) {
-                        *target_pixel_red_ptr = ((*(uint16_t*)(source_pixel_ptr - sizeof(uint16_t)) +
-                                                  *(uint16_t*)(source_pixel_ptr + sizeof(uint16_t))) / 2) / factor;
-                    } else {
-                        *target_pixel_red_ptr = *(uint16_t*)(source_pixel_ptr + sizeof(uint16_t)) / factor;
-                    }
+        // 32 byte alignment keeps every row start aligned for the vector loads
+        if( av_image_alloc(deep_debayered_frame->data,
+                           deep_debayered_frame->linesize,
+                           deep_debayered_frame->width,
+                           deep_debayered_frame->height,
+                           (AVPixelFormat)deep_debayered_frame->format,
+                           32) < 0 ) {
+            av_log(NULL, AV_LOG_ERROR, "Could not allocate debayer picture\n");
+            av_frame_free(&deep_debayered_frame);
+            ret = AVERROR(ENOMEM);
+            throw(ret);
+        }
+    }
 
-                    *target_pixel_green_ptr = *(uint16_t*)source_pixel_ptr / factor;
+    av_frame_copy_props(deep_debayered_frame, frame);
 
-                    if(y > 0) {
-                        *target_pixel_blue_ptr = ((*(uint16_t*)(source_pixel_ptr - frame->linesize[0]) +
-                                                   *(uint16_t*)(source_pixel_ptr + frame->linesize[0])) / 2) / factor;
-                    } else {
-                        *target_pixel_blue_ptr = *(uint16_t*)(source_pixel_ptr + frame->linesize[0]) / factor;
-                    }
+    deep_debayer_kernel(frame, deep_debayered_frame, &debayer_colour, &band_pool);
+}
 
-                } else if(x % 2 == 1 && y % 2 == 1) {
+bool ZeitEngine::SelectDebayer()
+{
+    debayer_colour = zd_format.Colour();
 
-                    if(y < frame->height - 1) {
-                        *target_pixel_red_ptr = ((*(uint16_t*)(source_pixel_ptr - frame->linesize[0]) +
-                                                  *(uint16_t*)(source_pixel_ptr + frame->linesize[0])) / 2) / factor;
-                    } else {
-                        *target_pixel_red_ptr = *(uint16_t*)(source_pixel_ptr - frame->linesize[0]) / factor;
-                    }
+    // Sensors without a correction skip the stage
+    const bool colour = !debayer_colour.neutral;
 
-                    *target_pixel_green_ptr = *(uint16_t*)source_pixel_ptr / factor;
+    fast_debayer_kernel = Debayer::Select(zd_format.pattern, zd_format.bits, Debayer::METHOD_NEAREST, Debayer::OUTPUT_RGB32, colour);
+    debayer_kernel = Debayer::Select(zd_format.pattern, zd_format.bits, Debayer::METHOD_MALVAR, Debayer::OUTPUT_RGB32, colour);
+    deep_debayer_kernel = Debayer::Select(zd_format.pattern, zd_format.bits, Debayer::METHOD_MALVAR, Debayer::OUTPUT_PLANAR, colour);
+    deep_debayer_pixel_format = Debayer::PlanarFormat(zd_format.bits);
 
-                    if(x < frame->width - 1) {
-                        *target_pixel_blue_ptr = ((*(uint16_t*)(source_pixel_ptr - sizeof(uint16_t)) +
-                                                   *(uint16_t*)(source_pixel_ptr + sizeof(uint16_t))) / 2) / factor;
-                    } else {
-                        *target_pixel_blue_ptr = *(uint16_t*)(source_pixel_ptr - sizeof(uint16_t)) / factor;
-                    }
+    if(fast_debayer_kernel == NULL || debayer_kernel == NULL || deep_debayer_kernel == NULL) {
+        av_log(NULL, AV_LOG_ERROR, "No debayer kernel for %d bit samples\n", zd_format.bits);
+        return false;
+    }
 
-                } else if(x % 2 == 1 && y % 2 == 0) {
-
-                    *target_pixel_red_ptr = *(uint16_t*)source_pixel_ptr / factor;
-
-                    if(y > 0) {
-                        if(x < frame->width - 1) {
-                            *target_pixel_green_ptr = ((*(uint16_t*)(source_pixel_ptr - sizeof(uint16_t)) +
-                                                        *(uint16_t*)(source_pixel_ptr + sizeof(uint16_t)) +
-                                                        *(uint16_t*)(source_pixel_ptr - frame->linesize[0]) +
-                                                        *(uint16_t*)(source_pixel_ptr + frame->linesize[0])) / 4) / factor;
-                        } else {
-                            *target_pixel_green_ptr = ((*(uint16_t*)(source_pixel_ptr - sizeof(uint16_t)) +
-                                                        *(uint16_t*)(source_pixel_ptr - frame->linesize[0]) +
-                                                        *(uint16_t*)(source_pixel_ptr + frame->linesize[0])) / 3) / factor;
-                        }
-                    } else {
-                        if(x < frame->width - 1) {
-                            *target_pixel_green_ptr = ((*(uint16_t*)(source_pixel_ptr - sizeof(uint16_t)) +
-                                                        *(uint16_t*)(source_pixel_ptr + sizeof(uint16_t)) +
-                                                        *(uint16_t*)(source_pixel_ptr + frame->linesize[0])) / 3) / factor;
-                        } else {
-                            *target_pixel_green_ptr = ((*(uint16_t*)(source_pixel_ptr - sizeof(uint16_t)) +
-                                                        *(uint16_t*)(source_pixel_ptr + frame->linesize[0])) / 2) / factor;
-                        }
-                    }
+    return true;
+}
 
-                    if(y > 0) {
-                        if(x < frame->width - 1) {
-                            *target_pixel_blue_ptr = ((*(uint16_t*)(source_pixel_ptr - frame->linesize[0] - sizeof(uint16_t)) +
-                                                       *(uint16_t*)(source_pixel_ptr - frame->linesize[0] + sizeof(uint16_t)) +
-                                                       *(uint16_t*)(source_pixel_ptr + frame->linesize[0] - sizeof(uint16_t)) +
-                                                       *(uint16_t*)(source_pixel_ptr + frame->linesize[0] + sizeof(uint16_t))) / 4) / factor;
-                        } else {
-                            *target_pixel_blue_ptr = ((*(uint16_t*)(source_pixel_ptr - frame->linesize[0] - sizeof(uint16_t)) +
-                                                       *(uint16_t*)(source_pixel_ptr + frame->linesize[0] - sizeof(uint16_t))) / 2) / factor;
-                        }
-                    } else {
-                        if(x < frame->width - 1) {
-                            *target_pixel_blue_ptr = ((*(uint16_t*)(source_pixel_ptr + frame->linesize[0] - sizeof(uint16_t)) +
-                                                       *(uint16_t*)(source_pixel_ptr + frame->linesize[0] + sizeof(uint16_t))) / 2) / factor;
-                        } else {
-                            *target_pixel_blue_ptr = *(uint16_t*)(source_pixel_ptr + frame->linesize[0] - sizeof(uint16_t)) / factor;
-                        }
-                    }
+AVCodecID ZeitEngine::DeepCodecId()
+{
+    // x264 is built for either 8 or 10 bit, libavcodec lists what it takes
+    AVCodec* codec = avcodec_find_encoder(EXPORT_CODEC_ID);
 
-                } else if(x % 2 == 0 && y % 2 == 1) {
-
-                    if(x > 0) {
-                        if(y < frame->height - 1) {
-                            *target_pixel_red_ptr = ((*(uint16_t*)(source_pixel_ptr - frame->linesize[0] - sizeof(uint16_t)) +
-                                                      *(uint16_t*)(source_pixel_ptr - frame->linesize[0] + sizeof(uint16_t)) +
-                                                      *(uint16_t*)(source_pixel_ptr + frame->linesize[0] - sizeof(uint16_t)) +
-                                                      *(uint16_t*)(source_pixel_ptr + frame->linesize[0] + sizeof(uint16_t))) / 4) / factor;
-                        } else {
-                            *target_pixel_red_ptr = ((*(uint16_t*)(source_pixel_ptr - frame->linesize[0] - sizeof(uint16_t)) +
-                                                      *(uint16_t*)(source_pixel_ptr - frame->linesize[0] + sizeof(uint16_t))) / 2) / factor;
-                        }
-                    } else {
-                        if(y < frame->height - 1) {
-                            *target_pixel_red_ptr = ((*(uint16_t*)(source_pixel_ptr - frame->linesize[0] + sizeof(uint16_t)) +
-                                                      *(uint16_t*)(source_pixel_ptr + frame->linesize[0] + sizeof(uint16_t))) / 2) / factor;
-                        } else {
-                            *target_pixel_red_ptr = *(uint16_t*)(source_pixel_ptr - frame->linesize[0] + sizeof(uint16_t)) / factor;
-                        }
-                    }
+    if(codec != NULL && codec->pix_fmts != NULL) {
+        for(const AVPixelFormat* format = codec->pix_fmts; *format != AV_PIX_FMT_NONE; format++) {
+            if(*format == DEEP_EXPORT_PIXELFORMAT) {
+                return EXPORT_CODEC_ID;
+            }
+        }
+    }
 
-                    if(x > 0) {
-                        if(y < frame->height - 1) {
-                            *target_pixel_green_ptr = ((*(uint16_t*)(source_pixel_ptr - sizeof(uint16_t)) +
-                                                        *(uint16_t*)(source_pixel_ptr + sizeof(uint16_t)) +
-                                                        *(uint16_t*)(source_pixel_ptr - frame->linesize[0]) +
-                                                        *(uint16_t*)(source_pixel_ptr + frame->linesize[0])) / 4) / factor;
-                        } else {
-                            *target_pixel_green_ptr = ((*(uint16_t*)(source_pixel_ptr - sizeof(uint16_t)) +
-                                                        *(uint16_t*)(source_pixel_ptr + sizeof(uint16_t)) +
-                                                        *(uint16_t*)(source_pixel_ptr - frame->linesize[0])) / 3) / factor;
-                        }
-                    } else {
-                        if(y < frame->height - 1) {
-                            *target_pixel_green_ptr = ((*(uint16_t*)(source_pixel_ptr + sizeof(uint16_t)) +
-                                                        *(uint16_t*)(source_pixel_ptr - frame->linesize[0]) +
-                                                        *(uint16_t*)(source_pixel_ptr + frame->linesize[0])) / 3) / factor;
-                        } else {
-                            *target_pixel_green_ptr = ((*(uint16_t*)(source_pixel_ptr + sizeof(uint16_t)) +
-                                                        *(uint16_t*)(source_pixel_ptr - frame->linesize[0])) / 2) / factor;
-                        }
-                    }
+    return DEEP_FALLBACK_CODEC_ID;
+}
 
-                    *target_pixel_blue_ptr = *(uint16_t*)source_pixel_ptr / factor;
+void ZeitEngine::FreeDebayer()
+{
+    if(debayered_frame != NULL) {
+        av_freep(&debayered_frame->data[0]);
+        av_frame_free(&debayered_frame);
+    }
 
-                }
-            }
-        }
+    if(deep_debayered_frame != NULL) {
+        av_freep(&deep_debayered_frame->data[0]);
+        av_frame_free(&deep_debayered_frame);
     }
 }
 
@@ -868,7 +2234,7 @@ void ZeitEngine::InitFilter(AVFrame* frame, ZeitFilter filter)
         char message[255];
         av_make_error_string(message, 255, code);
         av_log(NULL, AV_LOG_ERROR, "%d - %s\n", code, message);
-        throw(message);
+        throw(code);
     }
 
     configured_filter = filter;
@@ -877,6 +2243,8 @@ void ZeitEngine::InitFilter(AVFrame* frame, ZeitFilter filter)
 
 void ZeitEngine::FilterFrame(AVFrame* frame, ZeitFilter filter)
 {
+    StageTimer stage_timer(&stats, ZEIT_STAGE_FILTER);
+
     if(!filter_initialized) {
         InitFilter(frame, filter);
     } else if(filter != configured_filter) {
@@ -906,7 +2274,7 @@ void ZeitEngine::FilterFrame(AVFrame* frame, ZeitFilter filter)
         char message[255];
         av_make_error_string(message, 255, code);
         av_log(NULL, AV_LOG_ERROR, "%d - %s\n", code, message);
-        throw(message);
+        throw(code);
     }
 }
 
@@ -930,22 +2298,21 @@ void ZeitEngine::FreeFilter()
 void ZeitEngine::InitScaler(AVFrame *frame,
                             const unsigned int target_width,
                             const unsigned int target_height,
-                            const AVPixelFormat target_pixel_format)
+                            const AVPixelFormat target_pixel_format,
+                            const int flags)
 {
     int ret;
 
     try
     {
-        if( !(scaler_context = sws_getContext(frame->width,
-                                              frame->height,
-                                              (AVPixelFormat)frame->format,
-                                              target_width,
-                                              target_height,
-                                              target_pixel_format,
-                                              SWS_BILINEAR,
-                                              NULL,
-                                              NULL,
-                                              NULL)) )
+        if( !scaler.Init(frame->width,
+                        frame->height,
+                        (AVPixelFormat)frame->format,
+                        target_width,
+                        target_height,
+                        target_pixel_format,
+                        flags,
+                        &band_pool) )
         {
             av_log(NULL, AV_LOG_ERROR,
             "Impossible to create scale context for the conversion "
@@ -997,35 +2364,36 @@ void ZeitEngine::InitScaler(AVFrame *frame,
         char message[255];
         av_make_error_string(message, 255, code);
         av_log(NULL, AV_LOG_ERROR, "%d - %s\n", code, message);
-        throw(message);
+        throw(code);
     }
 }
 
 void ZeitEngine::ScaleFrame(AVFrame *frame,
                             const unsigned int target_width,
                             const unsigned int target_height,
-                            const AVPixelFormat target_pixel_format)
+                            const AVPixelFormat target_pixel_format,
+                            const int flags)
 {
+    StageTimer stage_timer(&stats, ZEIT_STAGE_SCALE);
+
     if(!scaler_initialized) {
         InitScaler(frame,
                    target_width,
                    target_height,
-                   target_pixel_format);
+                   target_pixel_format,
+                   flags);
     }
 
-    sws_scale(scaler_context,
-              (const uint8_t * const*)frame->data,
-              frame->linesize,
-              0,
-              frame->height,
-              scaler_frame->data,
-              scaler_frame->linesize);
+    scaler.Scale((const uint8_t * const*)frame->data,
+                 frame->linesize,
+                 scaler_frame->data,
+                 scaler_frame->linesize);
 }
 
 void ZeitEngine::FreeScaler()
 {
     if(scaler_initialized) {
-        sws_freeContext(scaler_context);
+        scaler.Free();
         av_freep(&scaler_frame->data[0]);
         av_frame_free(&scaler_frame);
 
@@ -1036,22 +2404,21 @@ void ZeitEngine::FreeScaler()
 void ZeitEngine::InitRescaler(AVFrame *frame,
                               const unsigned int target_width,
                               const unsigned int target_height,
-                              const AVPixelFormat target_pixel_format)
+                              const AVPixelFormat target_pixel_format,
+                              const int flags)
 {
     int ret;
 
     try
     {
-        if( !(rescaler_context = sws_getContext(frame->width,
-                                                frame->height,
-                                                (AVPixelFormat)frame->format,
-                                                target_width,
-                                                target_height,
-                                                target_pixel_format,
-                                                SWS_BILINEAR,
-                                                NULL,
-                                                NULL,
-                                                NULL)) )
+        if( !rescaler.Init(frame->width,
+                          frame->height,
+                          (AVPixelFormat)frame->format,
+                          target_width,
+                          target_height,
+                          target_pixel_format,
+                          flags,
+                          &band_pool) )
         {
             av_log(NULL, AV_LOG_ERROR,
             "Impossible to create scale context for the conversion "
@@ -1103,35 +2470,36 @@ void ZeitEngine::InitRescaler(AVFrame *frame,
         char message[255];
         av_make_error_string(message, 255, code);
         av_log(NULL, AV_LOG_ERROR, "%d - %s\n", code, message);
-        throw(message);
+        throw(code);
     }
 }
 
 void ZeitEngine::RescaleFrame(AVFrame *frame,
                               const unsigned int target_width,
                               const unsigned int target_height,
-                              const AVPixelFormat target_pixel_format)
+                              const AVPixelFormat target_pixel_format,
+                              const int flags)
 {
+    StageTimer stage_timer(&stats, ZEIT_STAGE_SCALE);
+
     if(!rescaler_initialized) {
         InitRescaler(frame,
                      target_width,
                      target_height,
-                     target_pixel_format);
+                     target_pixel_format,
+                     flags);
     }
 
-    sws_scale(rescaler_context,
-              (const uint8_t * const*)frame->data,
-              frame->linesize,
-              0,
-              frame->height,
-              rescaler_frame->data,
-              rescaler_frame->linesize);
+    rescaler.Scale((const uint8_t * const*)frame->data,
+                   frame->linesize,
+                   rescaler_frame->data,
+                   rescaler_frame->linesize);
 }
 
 void ZeitEngine::FreeRescaler()
 {
     if(rescaler_initialized) {
-        sws_freeContext(rescaler_context);
+        rescaler.Free();
         av_freep(&rescaler_frame->data[0]);
         av_frame_free(&rescaler_frame);
 
@@ -1139,105 +2507,140 @@ void ZeitEngine::FreeRescaler()
     }
 }
 
-void ZeitEngine::InitExporter(AVFrame* frame, const QFileInfo output_file)
+void ZeitEngine::InitExporter(ExportEncoder* encoder, AVFrame* frame, const QFileInfo output_file)
 {
-    AVCodec *encoder;
+    AVCodec *codec;
     int ret;
 
     try {
-        avformat_alloc_output_context2(&output_format_context,
+        avformat_alloc_output_context2(&encoder->format_context,
                                        NULL,
                                        NULL,
                                        output_file.absoluteFilePath().toUtf8().data());
-        if(!output_format_context) {
+        if(!encoder->format_context) {
             throw("Could not allocate output context");
         }
 
-        output_stream = avformat_new_stream(output_format_context, NULL);
-        if(!output_stream) {
+        encoder->stream = avformat_new_stream(encoder->format_context, NULL);
+        if(!encoder->stream) {
             throw("Could not allocate output stream");
         }
 
-        encoder = avcodec_find_encoder(EXPORT_CODEC_ID);
-        if(!encoder) {
+        codec = avcodec_find_encoder(export_codec_id);
+        if(!codec) {
             throw("Could not find encoder codec");
         }
 
-        encoder_context = avcodec_alloc_context3(encoder);
-        if(!encoder_context) {
+        encoder->context = avcodec_alloc_context3(codec);
+        if(!encoder->context) {
             throw("Could not allocate encoder codec context");
         }
 
-        encoder_context->bit_rate = 25000000;
-
         control_mutex.lock();
-        if(rotate_90d_cw_flag) {
-            encoder_context->width = frame->height;
-            encoder_context->height = frame->width;
+
+        const char* preset;
+
+        switch(encoder->rendition.profile) {
+            case ZEIT_PROFILE_DRAFT:
+                encoder->context->bit_rate = 4000000;
+                preset = "veryfast";
+                break;
+
+            case ZEIT_PROFILE_WEB:
+                encoder->context->bit_rate = 8000000;
+                preset = "slow";
+                break;
+
+            case ZEIT_PROFILE_ARCHIVE:
+                encoder->context->bit_rate = 80000000;
+                preset = "slow";
+                break;
+
+            default:
+                encoder->context->bit_rate = 25000000;
+                preset = "medium";
+                break;
+        }
+
+        // Only x264 knows presets, other encoders just ignore it
+        av_opt_set(encoder->context->priv_data, "preset", preset, 0);
+
+        encoder->context->thread_count = rendition_encoder_threads;
+
+        if(export_rotate_90d_cw) {
+            encoder->context->width = frame->height;
+            encoder->context->height = frame->width;
         } else {
-            encoder_context->width = frame->width;
-            encoder_context->height = frame->height;
+            encoder->context->width = frame->width;
+            encoder->context->height = frame->height;
         }
         control_mutex.unlock();
 
         switch(configured_framerate) {
             case ZEIT_RATE_23_976:
-                encoder_context->time_base.num = 1001;
-                encoder_context->time_base.den = 30000;
+                encoder->context->time_base.num = 1001;
+                encoder->context->time_base.den = 30000;
                 break;
 
             case ZEIT_RATE_29_97:
-                encoder_context->time_base.num = 125;
-                encoder_context->time_base.den = 2997;
+                encoder->context->time_base.num = 125;
+                encoder->context->time_base.den = 2997;
                 break;
 
             default:
-                encoder_context->time_base.num = 1;
-                encoder_context->time_base.den = configured_framerate;
+                encoder->context->time_base.num = 1;
+                encoder->context->time_base.den = configured_framerate;
                 break;
         }
 
-        encoder_context->gop_size = configured_framerate;
-        encoder_context->pix_fmt = EXPORT_PIXELFORMAT;
+        encoder->context->gop_size = configured_framerate;
+        encoder->context->pix_fmt = export_pixel_format;
+
+        // FFV1 version 3 codes slices in parallel and checksums them
+        if(export_codec_id == AV_CODEC_ID_FFV1) {
+            encoder->context->level = 3;
+            encoder->context->slices = 16;
+            encoder->context->gop_size = 1;
+        }
 
-        if(output_format_context->oformat->flags & AVFMT_GLOBALHEADER) {
-            encoder_context->flags |= CODEC_FLAG_GLOBAL_HEADER;
+        if(encoder->format_context->oformat->flags & AVFMT_GLOBALHEADER) {
+            encoder->context->flags |= CODEC_FLAG_GLOBAL_HEADER;
         }
 
-        ret = avcodec_open2(encoder_context, encoder, NULL);
+        ret = avcodec_open2(encoder->context, codec, NULL);
         if(ret < 0) {
             throw(ret);
         }
 
-        ret = avcodec_parameters_from_context(output_stream->codecpar, encoder_context);
+        ret = avcodec_parameters_from_context(encoder->stream->codecpar, encoder->context);
         if(ret < 0) {
             throw(ret);
         }
 
         // According to examples/tests this apparently needs to be done manually
-        output_stream->time_base = encoder_context->time_base;
+        encoder->stream->time_base = encoder->context->time_base;
 
-        encoder_frame = av_frame_alloc();
-        if(!encoder_frame) {
+        encoder->frame = av_frame_alloc();
+        if(!encoder->frame) {
             throw("Could not allocate encoder frame");
         }
 
-        encoder_frame->format = encoder_context->pix_fmt;
-        encoder_frame->width = encoder_context->width;
-        encoder_frame->height = encoder_context->height;
+        encoder->frame->format = encoder->context->pix_fmt;
+        encoder->frame->width = encoder->context->width;
+        encoder->frame->height = encoder->context->height;
 
-        ret = av_image_alloc(encoder_frame->data,
-                             encoder_frame->linesize,
-                             encoder_frame->width,
-                             encoder_frame->height,
-                             (AVPixelFormat)encoder_frame->format,
+        ret = av_image_alloc(encoder->frame->data,
+                             encoder->frame->linesize,
+                             encoder->frame->width,
+                             encoder->frame->height,
+                             (AVPixelFormat)encoder->frame->format,
                              1);
         if(ret < 0) {
             throw(ret);
         }
 
-        if(!(output_format_context->oformat->flags & AVFMT_NOFILE)) {
-            ret = avio_open(&output_format_context->pb,
+        if(!(encoder->format_context->oformat->flags & AVFMT_NOFILE)) {
+            ret = avio_open(&encoder->format_context->pb,
                             output_file.absoluteFilePath().toUtf8().data(),
                             AVIO_FLAG_WRITE);
 
@@ -1246,41 +2649,56 @@ void ZeitEngine::InitExporter(AVFrame* frame, const QFileInfo output_file)
             }
         }
 
-        ret = avformat_write_header(output_format_context, NULL);
+        // The capture time, if the sequence knows it
+        if(operation_mode == ZEIT_MODE_ZD && zd_format.timestamp.isValid()) {
+            av_dict_set(&encoder->format_context->metadata,
+                        "creation_time",
+                        zd_format.timestamp.toUTC().toString(Qt::ISODate).toUtf8().constData(),
+                        0);
+        }
+
+        ret = avformat_write_header(encoder->format_context, NULL);
         if(ret < 0) {
             throw(ret);
         }
 
-        encoder_packet = av_packet_alloc();
-        if(encoder_packet == NULL) {
+        encoder->packet = av_packet_alloc();
+        if(encoder->packet == NULL) {
             throw("Could not allocate encoder packet");
         }
+
+        encoder->segment_packets = 0;
     }
     catch(int code) {
         char message[255];
         av_make_error_string(message, 255, code);
         av_log(NULL, AV_LOG_ERROR, "%d - %s\n", code, message);
-        throw(message);
+        throw(code);
     }
 }
 
-bool ZeitEngine::ExportFrame(AVFrame* frame, const QFileInfo output_file)
+bool ZeitEngine::ExportFrame(ExportEncoder* encoder, AVFrame* frame, const QFileInfo output_file, const int64_t pts)
 {
+    StageTimer stage_timer(&encoder->stats, ZEIT_STAGE_ENCODE);
+
     int ret;
 
-    if(!exporter_initialized) {
-        InitExporter(frame, output_file);
-        exporter_initialized = true;
+    if(!encoder->initialized) {
+        InitExporter(encoder, frame, output_file);
+        encoder->initialized = true;
     }
 
     // Copy to output frame only until we're writing the delayed frames
     if(frame != NULL) {
 
-      control_mutex.lock();
-      bool flip_x = flip_x_flag;
-      bool flip_y = flip_y_flag;
-      bool rotate_90d_cw = rotate_90d_cw_flag;
-      control_mutex.unlock();
+      TraceScope trace_scope("Orient", (int)pts);
+
+      const bool flip_x = export_flip_x;
+      const bool flip_y = export_flip_y;
+      const bool rotate_90d_cw = export_rotate_90d_cw;
+
+      // Samples of 10 bit exports take two bytes
+      const int bytes = av_pix_fmt_desc_get((AVPixelFormat)frame->format)->comp[0].step;
 
       // Y
       for(int y = 0; y < frame->height; y++) {
@@ -1292,13 +2710,13 @@ bool ZeitEngine::ExportFrame(AVFrame* frame, const QFileInfo output_file)
               if(flip_y != rotate_90d_cw) { target_y = frame->height - 1 - y; }
 
               if(rotate_90d_cw) {
-                  memcpy(encoder_frame->data[0] + target_x * encoder_frame->linesize[0] + target_y,
-                         frame->data[0] + y * frame->linesize[0] + x,
-                         sizeof(uint8_t));
+                  memcpy(encoder->frame->data[0] + target_x * encoder->frame->linesize[0] + target_y * bytes,
+                         frame->data[0] + y * frame->linesize[0] + x * bytes,
+                         bytes);
               } else {
-                  memcpy(encoder_frame->data[0] + target_y * encoder_frame->linesize[0] + target_x,
-                         frame->data[0] + y * frame->linesize[0] + x,
-                         sizeof(uint8_t));
+                  memcpy(encoder->frame->data[0] + target_y * encoder->frame->linesize[0] + target_x * bytes,
+                         frame->data[0] + y * frame->linesize[0] + x * bytes,
+                         bytes);
               }
           }
       }
@@ -1315,29 +2733,34 @@ bool ZeitEngine::ExportFrame(AVFrame* frame, const QFileInfo output_file)
               // (Iterate over Cb and Cr Plane)
               for(int p = 1; p < 3; p++) {
                   if(rotate_90d_cw) {
-                      memcpy(encoder_frame->data[p] + target_x * encoder_frame->linesize[p] + target_y,
-                             frame->data[p] + y * frame->linesize[p] + x,
-                             sizeof(uint8_t));
+                      memcpy(encoder->frame->data[p] + target_x * encoder->frame->linesize[p] + target_y * bytes,
+                             frame->data[p] + y * frame->linesize[p] + x * bytes,
+                             bytes);
                   } else {
-                      memcpy(encoder_frame->data[p] + target_y * encoder_frame->linesize[p] + target_x,
-                             frame->data[p] + y * frame->linesize[p] + x,
-                             sizeof(uint8_t));
+                      memcpy(encoder->frame->data[p] + target_y * encoder->frame->linesize[p] + target_x * bytes,
+                             frame->data[p] + y * frame->linesize[p] + x * bytes,
+                             bytes);
                   }
               }
           }
       }
 
-      encoder_frame->pts = sequence_iterator - source_sequence.constBegin();
+      encoder->frame->pts = pts;
     }
 
-    ret = avcodec_send_frame(encoder_context, frame ? encoder_frame : NULL);
+    Tracer::Begin("Send frame");
+    ret = avcodec_send_frame(encoder->context, frame ? encoder->frame : NULL);
+    Tracer::End("Send frame");
+
     if(ret < 0) {
         throw("Failed to send frame to encoder codec");
     }
 
     // Receive packet(s) from encoder codec in a loop and write them out
     while(ret >= 0) {
-        ret = avcodec_receive_packet(encoder_context, encoder_packet);
+        Tracer::Begin("Receive packet");
+        ret = avcodec_receive_packet(encoder->context, encoder->packet);
+        Tracer::End("Receive packet");
 
         if(ret == AVERROR(EAGAIN)) {
             return true; // No output at this stage, send more input
@@ -1346,44 +2769,254 @@ bool ZeitEngine::ExportFrame(AVFrame* frame, const QFileInfo output_file)
         } else if(ret < 0) {
             throw(ret);
         } else {
-            av_packet_rescale_ts(encoder_packet,
-                                 encoder_context->time_base,
-                                 output_stream->time_base);
+            av_packet_rescale_ts(encoder->packet,
+                                 encoder->context->time_base,
+                                 encoder->stream->time_base);
 
-            encoder_packet->stream_index = output_stream->index;
+            encoder->packet->stream_index = encoder->stream->index;
 
-            ret = av_interleaved_write_frame(output_format_context, encoder_packet);
+            Tracer::Begin("Write packet");
+            ret = av_interleaved_write_frame(encoder->format_context, encoder->packet);
+            Tracer::End("Write packet");
             if(ret < 0) {
                throw(ret);
             }
 
-            av_packet_unref(encoder_packet);
+            encoder->segment_packets++;
+            av_packet_unref(encoder->packet);
+
+            // Flushing drains the whole lookahead, which takes long with slow
+            // presets; only a cancel that keeps the video waits for the rest
+            if(frame == NULL) {
+                control_mutex.lock();
+                bool abandon = stop_flag && !keep_partial_flag;
+                control_mutex.unlock();
+
+                if(abandon) {
+                    throw("Cancelled on request");
+                }
+            }
         }
     }
 
     return true;
 }
 
-void ZeitEngine::CloseExport()
+void ZeitEngine::CloseExport(ExportEncoder* encoder)
+{
+    av_write_trailer(encoder->format_context);
+
+    avcodec_close(encoder->context);
+    avcodec_free_context(&encoder->context);
+
+    if(!(encoder->format_context->oformat->flags & AVFMT_NOFILE)) {
+        avio_closep(&encoder->format_context->pb);
+    }
+
+    avformat_free_context(encoder->format_context);
+
+    av_freep(&encoder->frame->data[0]);
+    av_frame_free(&encoder->frame);
+    av_packet_free(&encoder->packet);
+
+    encoder->initialized = false;
+}
+
+bool ZeitEngine::FitHeight(const int width,
+                           const int height,
+                           const unsigned int max_height,
+                           const bool rotate_90d_cw,
+                           int* target_width,
+                           int* target_height)
 {
-    av_write_trailer(output_format_context);
+    // The video's height is the frame's width once rotated
+    const int source_height = rotate_90d_cw ? width : height;
 
-    avcodec_close(encoder_context);
-    avcodec_free_context(&encoder_context);
+    *target_width = width;
+    *target_height = height;
 
-    if(!(output_format_context->oformat->flags & AVFMT_NOFILE)) {
-        avio_closep(&output_format_context->pb);
+    if(max_height == 0 || (int)max_height >= source_height) {
+        return false;
     }
 
-    avformat_free_context(output_format_context);
+    const double factor = (double)max_height / source_height;
 
-    av_freep(&encoder_frame->data[0]);
-    av_frame_free(&encoder_frame);
-    av_packet_free(&encoder_packet);
+    // Even sizes, chroma is subsampled in both directions
+    *target_width = std::max(2, (int)(width * factor / 2.0 + 0.5) * 2);
+    *target_height = std::max(2, (int)(height * factor / 2.0 + 0.5) * 2);
 
-    exporter_initialized = false;
+    return true;
+}
 
-    ControlsEnabled(true);
+AVFrame* ZeitEngine::RenditionFrame(ExportEncoder* encoder, AVFrame* frame)
+{
+    StageTimer stage_timer(&encoder->stats, ZEIT_STAGE_SCALE);
+
+    const bool rotate_90d_cw = export_rotate_90d_cw;
+
+    int target_width;
+    int target_height;
+
+    if(!FitHeight(frame->width,
+                  frame->height,
+                  encoder->rendition.max_height,
+                  rotate_90d_cw,
+                  &target_width,
+                  &target_height)) {
+        return frame;
+    }
+
+    if(encoder->scaler == NULL) {
+        encoder->scaler = new SliceScaler();
+
+        if(!encoder->scaler->Init(frame->width,
+                                  frame->height,
+                                  (AVPixelFormat)frame->format,
+                                  target_width,
+                                  target_height,
+                                  export_pixel_format,
+                                  ScalerFlags(ZEIT_SCALE_EXPORT, frame->width, frame->height, target_width, target_height),
+                                  &band_pool)) {
+            throw("Could not create rendition scale context");
+        }
+
+        encoder->scaled_frame = av_frame_alloc();
+        if(!encoder->scaled_frame) {
+            throw("Could not allocate rendition frame");
+        }
+
+        encoder->scaled_frame->width = target_width;
+        encoder->scaled_frame->height = target_height;
+        encoder->scaled_frame->format = export_pixel_format;
+
+        int ret = av_image_alloc(encoder->scaled_frame->data,
+                                 encoder->scaled_frame->linesize,
+                                 target_width,
+                                 target_height,
+                                 export_pixel_format,
+                                 32);
+        if(ret < 0) {
+            throw(ret);
+        }
+    }
+
+    encoder->scaler->Scale((const uint8_t * const*)frame->data,
+                           frame->linesize,
+                           encoder->scaled_frame->data,
+                           encoder->scaled_frame->linesize);
+
+    return encoder->scaled_frame;
+}
+
+void ZeitEngine::EncodeRendition(ExportEncoder* encoder, AVFrame* frame, const int64_t pts)
+{
+    try {
+        // Every rendition on its own, a stop request never waits for all of them
+        CheckStop();
+        ExportFrame(encoder, RenditionFrame(encoder, frame), encoder->segment_file, pts);
+    }
+    catch(const char* message) {
+        encoder->failure_message = message;
+    }
+    catch(int code) {
+        encoder->failure_code = code;
+    }
+}
+
+void ZeitEngine::BudgetThreads(const int renditions)
+{
+    control_mutex.lock();
+    const int budget = (encoder_threads > 0) ? encoder_threads : QThread::idealThreadCount();
+    control_mutex.unlock();
+
+    // A third to the bands of debayering and scaling, up to a quarter to
+    // renditions beyond the first, the rest split between the encoders;
+    // x264 encodes while the next frame is debayered, so they all add up
+    const int bands = std::max(1, budget / 3);
+    const int rendition_workers = std::min(renditions - 1, budget / 4);
+
+    band_pool.setMaxThreadCount(bands);
+    rendition_pool.setMaxThreadCount(rendition_workers);
+    rendition_encoder_threads = std::max(1, (budget - bands - rendition_workers) / std::max(1, renditions));
+}
+
+void ZeitEngine::EncodeRenditions(const QList<ExportEncoder*>& encoders, AVFrame* frame, const int segment, const int64_t pts)
+{
+    QSemaphore done;
+    ExportEncoder* first_encoder = NULL;
+    int started = 0;
+
+    // A budget too small for workers encodes the renditions in turn
+    const bool side_by_side = (rendition_pool.maxThreadCount() > 0);
+
+    for(int i = 0; i < encoders.size(); i++) {
+        ExportEncoder* encoder = encoders.at(i);
+
+        if(segment < encoder->resumed_segments) {
+            continue;
+        }
+
+        if(first_encoder == NULL) {
+            first_encoder = encoder;
+        } else if(side_by_side) {
+            rendition_pool.start(new RenditionTask(this, encoder, frame, pts, &done));
+            started++;
+        } else {
+            EncodeRendition(encoder, frame, pts);
+        }
+    }
+
+    if(first_encoder != NULL) {
+        EncodeRendition(first_encoder, frame, pts);
+    }
+
+    done.acquire(started);
+
+    // Back on this thread, the workers are idle until the next frame
+    for(int i = 0; i < encoders.size(); i++) {
+        ExportEncoder* encoder = encoders.at(i);
+
+        stats.Take(&encoder->stats);
+
+        if(encoder->failure_message != NULL) {
+            throw(encoder->failure_message);
+        }
+
+        if(encoder->failure_code != 0) {
+            throw(encoder->failure_code);
+        }
+    }
+}
+
+void ZeitEngine::FreeRenditionScaler(ExportEncoder* encoder)
+{
+    if(encoder->scaler != NULL) {
+        delete encoder->scaler;
+        encoder->scaler = NULL;
+    }
+
+    if(encoder->scaled_frame != NULL) {
+        av_freep(&encoder->scaled_frame->data[0]);
+        av_frame_free(&encoder->scaled_frame);
+    }
+}
+
+void ZeitEngine::ReportStats(const bool force)
+{
+    if(!force && stats_timer.isValid() && stats_timer.elapsed() < STATS_INTERVAL) {
+        return;
+    }
+
+    PipelineSummary summary;
+
+    stats.Summarize(&summary);
+    summary.display_cached = display_cache.Count();
+    summary.proxy_cached = proxy_cache.Count();
+    summary.skipped_frames = display->SkippedFrames();
+
+    emit StatsUpdated(summary);
+
+    stats_timer.start();
 }
 
 void ZeitEngine::Sleep(const unsigned int msec) {
@@ -6,19 +6,24 @@
  * Declares the `ZeitEngine` class and `ZeitFilter` and `ZeitRate` enums
  */
 
-#include <QApplication>
 #include <QObject>
+#include <QCollator>
+#include <QCryptographicHash>
 #include <QDebug>
+#include <QDir>
 #include <QElapsedTimer>
+#include <QFile>
 #include <QFileInfoList>
+#include <QHash>
 #include <QImage>
 #include <QMutex>
-#include <QScreen>
 #include <QString>
 #include <QThread>
+#include <QThreadPool>
 #include <QWaitCondition>
 
 #include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <fstream>
 
@@ -34,7 +39,13 @@ extern "C" {
 #include <libswscale/swscale.h>
 }
 
-#include "glvideowidget.h"
+#include "debayer.h"
+#include "framecache.h"
+#include "framesink.h"
+#include "pipelinestats.h"
+#include "slicescaler.h"
+#include "tracer.h"
+#include "zdformat.h"
 
 /*!
  * \brief Identifies a (to be) used filter, or no filter.
@@ -69,6 +80,60 @@ enum ZeitMode {
     ZEIT_MODE_GENERAL
 };
 
+/*!
+ * \brief Identifies encoder settings to export with
+ */
+enum ZeitProfile {
+    ZEIT_PROFILE_STANDARD,  //!< 25 Mbit/s, x264 medium preset
+    ZEIT_PROFILE_DRAFT,     //!< 4 Mbit/s, x264 veryfast preset, for quick reviews
+    ZEIT_PROFILE_WEB,       //!< 8 Mbit/s, x264 slow preset, for uploading
+    ZEIT_PROFILE_ARCHIVE    //!< 80 Mbit/s, x264 slow preset
+};
+
+/*!
+ * \brief What scaled frames are used for, decides the scaling algorithm
+ */
+enum ZeitScalePurpose {
+    ZEIT_SCALE_PREVIEW,     //!< Displayed during playback, speed first
+    ZEIT_SCALE_EXPORT       //!< Encoded, quality first
+};
+
+/*!
+ * \brief Output heights offered as presets, any other height works as well
+ */
+enum ZeitResolution {
+    ZEIT_RESOLUTION_SOURCE = 0,     //!< Keep the size of the footage
+    ZEIT_RESOLUTION_720p = 720,
+    ZEIT_RESOLUTION_1080p = 1080,
+    ZEIT_RESOLUTION_2160p = 2160    //!< 4K
+};
+
+/*!
+ * \brief Sample depths exports are encoded at
+ */
+enum ZeitDepth {
+    ZEIT_DEPTH_8 = 8,       //!< 8 bit H.264, plays everywhere
+    ZEIT_DEPTH_10 = 10      //!< 10 bit, keeping the range of 12 bit ZD footage for grading
+};
+
+/*!
+ * \brief One of the videos a single export pass produces
+ */
+struct ExportRendition {
+    QFileInfo file;
+    unsigned int max_height;    //!< Height of the video, downscaled from the source if smaller; 0 for the source size
+    ZeitProfile profile;
+};
+
+/*!
+ * \brief Identifies the direction in which the sequence is played back
+ */
+enum ZeitPlayback {
+    ZEIT_PLAYBACK_FORWARD,
+    ZEIT_PLAYBACK_REVERSE,
+    ZEIT_PLAYBACK_PINGPONG
+};
+
 /*!
  * \brief The `ZeitEngine`: Central threadable encoding facility class
  *
@@ -82,6 +147,9 @@ class ZeitEngine : public QObject
 {
     Q_OBJECT
 
+    friend class ZeitBench;     //!< Benchmarks drive the stages directly
+    friend class RenditionTask; //!< Encodes a rendition on the rendition pool
+
     /*!
      * \brief Sets the mode
      */
@@ -89,29 +157,50 @@ class ZeitEngine : public QObject
 
     QElapsedTimer timer;
 
-    const static AVPixelFormat DISPLAY_AV_PIXEL_FORMAT = AV_PIX_FMT_RGB24;
-    const static QImage::Format DISPLAY_QT_PIXEL_FORMAT = QImage::Format_RGB888;
+    // Native endian 0xffRRGGBB on both sides: Qt paints and uploads it without
+    // any internal conversion, and every pixel is a 4 byte aligned word
+    const static AVPixelFormat DISPLAY_AV_PIXEL_FORMAT = AV_PIX_FMT_RGB32;
+    const static QImage::Format DISPLAY_QT_PIXEL_FORMAT = QImage::Format_RGB32;
+
+    const static AVPixelFormat DEBAYER_PIXEL_FORMAT = AV_PIX_FMT_RGB32;
 
     const static AVPixelFormat EXPORT_PIXELFORMAT = AV_PIX_FMT_YUV420P;
     const static AVCodecID EXPORT_CODEC_ID = AV_CODEC_ID_H264;
 
+    // 10 bit exports debayer into planar RGB at the sensor's depth, which
+    // keeps all of ZD's precision, filter in 16 bit RGB and encode 10 bit YUV
+    const static AVPixelFormat DEEP_FILTER_PIXEL_FORMAT = AV_PIX_FMT_RGB48;
+    const static AVPixelFormat DEEP_EXPORT_PIXELFORMAT = AV_PIX_FMT_YUV420P10;
+    const static AVCodecID DEEP_FALLBACK_CODEC_ID = AV_CODEC_ID_FFV1;  //!< Lossless, if x264 was built for 8 bit only
+
     const static unsigned int ASSUMED_AVAILABLE_MEMORY = 512 * 1024 * 1024;
 
+    const static unsigned int DISPLAY_CACHE_MEMORY = ASSUMED_AVAILABLE_MEMORY / 2;
+    const static unsigned int PROXY_CACHE_MEMORY = ASSUMED_AVAILABLE_MEMORY / 4;
+    const static unsigned int PROXY_DIVISOR = 4;        //!< Proxy frames are a quarter of the display size
+    const static int SEEK_PROXY_MAX_DISTANCE = 24;      //!< Farthest frame shown as a stand-in while seeking
+    const static int PREFETCH_FRAMES = 8;               //!< How far ahead of playback frames are rendered
+    const static int STATS_INTERVAL = 500;              //!< Minimum ms between two `StatsUpdated()` signals
+    const static int SEGMENT_FRAMES = 240;              //!< Frames per export segment, at most this much work is lost in a crash
+    const static int AREA_SCALE_RATIO = 2;              //!< Export downscales by this factor or more average areas instead of interpolating
+    const static int SCALER_BUDGET_SHARE = 4;           //!< The preview scaler may take this fraction (1/n) of a frame interval
+    const static int CALIBRATION_RUNS = 5;              //!< Runs per algorithm when calibrating the preview scaler
+
     // Source data
 
     QFileInfoList source_sequence;
 
     // Display data
 
-    GLVideoWidget* display;
+    FrameSink* display;
 
-    unsigned int display_refresh_rate;
     unsigned int display_safe_max_width;
     unsigned int display_safe_max_height;
     unsigned int display_width;
     unsigned int display_height;
     bool display_initialized;    //!< Flag to check for display being initialized
     bool rotation_initialized;    //!< Flag to check for rotation being initialized
+    QHash<QString, int> scaler_calibrations;    //!< Preview scaler flags chosen so far, see `CalibrateScaler()`
 
     // Cache members
     //uint8_t **cache_data;
@@ -129,9 +218,54 @@ class ZeitEngine : public QObject
     // uint8_t *decoder_data[4];
     // int decoder_data_linesize[8];
 
+    // Band members
+
+    /*!
+     * \brief Threads for the bands of this engine's debayering and scaling
+     *
+     * Every engine has its own, so the bands of background exports never
+     * queue in front of the preview's. The threads are started by the
+     * engine's thread and inherit its priority; exports size the pool with
+     * `BudgetThreads()`.
+     */
+    QThreadPool band_pool;
+
+    /*!
+     * \brief Threads encoding renditions beyond the first, side by side
+     *
+     * Separate from `band_pool`, as renditions wait for the bands of their
+     * scaling. Sized by `BudgetThreads()`, without threads the renditions
+     * are encoded in turn.
+     */
+    QThreadPool rendition_pool;
+
+    int rendition_encoder_threads;  //!< Threads of every rendition's encoder, 0 lets the encoder decide
+
     // Debayer members
 
+    ZdFormat zd_format;     //!< Layout of the sequence's ZD frames, read once by `InitDecoder()`
+
+    Debayer::Colour debayer_colour;     //!< Correction of `zd_format`'s sensor, applied while debayering
+
+    // Kernels specialised for `zd_format`, picked by `SelectDebayer()`
+    Debayer::Kernel fast_debayer_kernel;
+    Debayer::Kernel debayer_kernel;
+    Debayer::Kernel deep_debayer_kernel;
+    AVPixelFormat deep_debayer_pixel_format;
+
     AVFrame *debayered_frame;
+    AVFrame *deep_debayered_frame;  //!< In `deep_debayer_pixel_format`, for 10 bit exports
+
+    // Export members
+
+    AVPixelFormat export_pixel_format;  //!< Encoder input of the running export, depends on its depth
+    AVCodecID export_codec_id;
+
+    // Orientation of the running export, read from the flags once as it
+    // starts, so turning the preview never turns a video halfway through
+    bool export_flip_x;
+    bool export_flip_y;
+    bool export_rotate_90d_cw;
 
     // Filter members
 
@@ -147,31 +281,75 @@ class ZeitEngine : public QObject
 
     // Exporter members
 
-    AVCodecContext *encoder_context;
-    AVFrame *encoder_frame;
-    AVPacket *encoder_packet;
-    std::ofstream* encoder_output_file;
+    /*!
+     * \brief Encoder, scaler and segments of one rendition while exporting
+     */
+    struct ExportEncoder {
+        ExportRendition rendition;
+
+        AVCodecContext *context;
+        AVFrame *frame;
+        AVPacket *packet;
 
-    AVFormatContext* output_format_context;
-    AVStream* output_stream;
+        AVFormatContext* format_context;
+        AVStream* stream;
 
-    bool exporter_initialized;
+        bool initialized;
+
+        SliceScaler *scaler;            //!< Downscales to the rendition's size, NULL until needed
+        AVFrame *scaled_frame;
+
+        QDir segment_dir;
+        QStringList segments;           //!< Files of the completed segments, in order
+        QFileInfo segment_file;         //!< The segment being encoded
+        int resumed_segments;           //!< Segments taken over from an interrupted export
+        int segment_packets;            //!< Packets written to `segment_file` so far
+
+        PipelineStats stats;            //!< Scale and encode timings, recorded on the rendition's worker
+        const char* failure_message;    //!< Error thrown on the worker, NULL if none
+        int failure_code;               //!< Error code thrown on the worker, 0 if none
+
+        ExportEncoder(const ExportRendition& rendition);
+    };
 
     // Scaler members
 
-    SwsContext *scaler_context;
+    SliceScaler scaler;
     AVFrame* scaler_frame;
     bool scaler_initialized;
 
     // Rescaler members
 
-    SwsContext *rescaler_context;
+    SliceScaler rescaler;
     AVFrame* rescaler_frame;
     bool rescaler_initialized;
 
+    // Cache members
+
+    FrameCache display_cache;   //!< Display sized frames for seeking and replaying without decoding
+    FrameCache proxy_cache;     //!< Small stand-in frames served while scrubbing
+    ZeitFilter cached_filter;   //!< The filter cached frames were rendered with
+
+    SwsContext *proxy_context;      //!< Downscales display frames to proxies
+    SwsContext *present_context;    //!< Upscales proxies to display size
+
     // Play members
 
-    QFileInfoList::const_iterator sequence_iterator;
+    /*!
+     * \brief Position of the frame on display, -1 if none has been shown yet
+     */
+    int sequence_position;
+
+    int playback_direction;     //!< 1 or -1, kept across pauses for ping-pong playback
+    float render_estimate;      //!< Running average of decode and render time in ms
+
+    // Instrumentation members
+
+    PipelineStats stats;        //!< Stage timings of the running operation
+    QElapsedTimer stats_timer;  //!< Time since stats were last reported
+
+    bool playing;       //!< Set while `Play()` runs, guarded by `control_mutex`
+    bool seek_queued;   //!< Set while `ServeSeek()` is queued, guarded by `control_mutex`
 
     /*!
      * \brief Used for one-shot playing, aka first frame preview on footage loading
@@ -202,25 +380,171 @@ class ZeitEngine : public QObject
 
     /*!
      * \brief Read a frame from disk into the `decoder_frame` buffer
-     *
-     * Read a frame from disk into the `decoder_frame` buffer. The image
-     * currently pointed to by the `sequence_iterator` variable tells the
-     * function which image to decode from the whole sequence.
+     * \param position Position of the image to decode in the whole sequence
      *
      * \return True for successful decode, False otherwise (indicating we should skip to next frame altogether)
      */
-    bool DecodeFrame();
+    bool DecodeFrame(const int position);
+
+    /*!
+     * \brief Fit the display geometry to the decoded frame and screen
+     * \param rotate_90d_cw Whether the display shows the footage rotated
+     *
+     * Frees everything depending on the previous display geometry (including
+     * cached frames) and tells the display about the new one. Calibrates the
+     * preview scaler for the new geometry if `calibrate_scaler_flag` is set.
+     */
+    void InitDisplay(const bool rotate_90d_cw);
+
+    /*!
+     * \brief Pick the best preview scaling algorithm that keeps up with playback
+     *
+     * Times each algorithm, from the best looking to the fastest, scaling the
+     * decoded frame to the display size and sets `preview_scaler_flag` to the
+     * first one within `1/SCALER_BUDGET_SHARE` of a frame interval at the
+     * configured framerate, or to the fastest one if none is.
+     *
+     * Each choice is remembered by source size and format, display size and
+     * framerate; opening footage or rotating to a combination that was
+     * measured before reuses it without scaling a frame.
+     */
+    void CalibrateScaler();
+
+    /*!
+     * \brief Milliseconds between two frames at a framerate
+     */
+    static float FrameInterval(const ZeitRate rate);
+
+    /*!
+     * \brief Scaling algorithm for a conversion, see `SWS_BILINEAR` etc.
+     * \param purpose What the scaled frames are used for
+     *
+     * Previews use `preview_scaler_flag`. Exports use `export_scaler_flag`,
+     * or area averaging when downscaling by `AREA_SCALE_RATIO` or more, where
+     * interpolating filters alias or (with wide kernels) get slow.
+     */
+    int ScalerFlags(const ZeitScalePurpose purpose,
+                    const int source_width,
+                    const int source_height,
+                    const int target_width,
+                    const int target_height);
+
+    /*!
+     * \brief Debayer, scale and filter the decoded frame for display
+     * \param filter The filter to apply
+     * \return The display sized frame, either `scaler_frame` or `filter_frame`
+     */
+    AVFrame* RenderFrame(const ZeitFilter filter);
+
+    /*!
+     * \brief Move the playhead according to the playback mode
+     * \param playhead Fractional sequence position to move
+     * \param direction Current direction (1 or -1), flipped when ping-ponging
+     * \param distance Frames to move
+     * \param mode The playback mode
+     * \param loop Whether to wrap around (or keep bouncing) at the ends
+     * \return false if the end of the sequence was reached without looping
+     */
+    bool AdvancePlayhead(double *playhead,
+                         int *direction,
+                         const double distance,
+                         const ZeitPlayback mode,
+                         const bool loop) const;
+
+    /*!
+     * \brief Render frames ahead of the playhead into the display cache
+     * \param playhead Current fractional sequence position
+     * \param direction Current direction of playback
+     * \param speed Current playback speed
+     * \param mode The playback mode
+     * \param loop Whether playback loops
+     * \param filter The filter to apply
+     * \param deadline Stop before this many ms into the current frame (per `timer`)
+     *
+     * Follows the direction and speed of playback, so whatever is played
+     * next is served from cache.
+     */
+    void Prefetch(double playhead,
+                  int direction,
+                  const double speed,
+                  const ZeitPlayback mode,
+                  const bool loop,
+                  const ZeitFilter filter,
+                  const float deadline);
+
+    /*!
+     * \brief Store a downscaled copy of a display frame in the proxy cache
+     * \param position Sequence position of the frame
+     * \param frame The display sized frame
+     */
+    void CacheProxy(const int position, AVFrame *frame);
+
+    /*!
+     * \brief Hand a rendered frame over to the display
+     * \param frame Display sized or proxy frame, proxies are scaled up
+     * \param flip_x Orientation to show the frame in
+     * \param flip_y Orientation to show the frame in
+     * \param rotate_90d_cw Orientation to show the frame in
+     */
+    void PresentFrame(AVFrame *frame,
+                      const bool flip_x,
+                      const bool flip_y,
+                      const bool rotate_90d_cw);
+
+    /*!
+     * \brief Display the frame at a position, from cache or freshly decoded
+     * \param position Sequence position of the frame
+     * \param filter The filter to apply
+     * \param flip_x Orientation to show the frame in
+     * \param flip_y Orientation to show the frame in
+     * \param rotate_90d_cw Orientation to show the frame in
+     * \return false if the frame could not be decoded
+     */
+    bool ShowFrame(const int position,
+                   const ZeitFilter filter,
+                   const bool flip_x,
+                   const bool flip_y,
+                   const bool rotate_90d_cw);
 
 
     /*!
      * \brief Debayer a frame
      * \param frame The source frame to debayer
-     * \param fast_debayering true for fast nearest neighbour method, false for slow but higher quality linear filtering
+     * \param fast_debayering true for fast nearest neighbour method, false for
+     *        gradient-corrected filtering in parallel, see `Debayer`
      *
-     * Debayers a frame into debayered_frame
+     * Debayers a frame into debayered_frame, which is allocated on first use
+     * (in `DEBAYER_PIXEL_FORMAT`) and reused as long as the geometry matches
      */
     void DebayerFrame(AVFrame *frame, bool fast_debayering);
 
+    /*!
+     * \brief Debayer a frame at the sensor's precision
+     * \param frame The source frame to debayer
+     *
+     * Like `DebayerFrame()`, with gradient-corrected filtering, into deep_debayered_frame
+     * (in `deep_debayer_pixel_format`)
+     */
+    void DeepDebayerFrame(AVFrame *frame);
+
+    /*!
+     * \brief Prepare `zd_format`'s colour correction and pick the debayer kernels specialised for it
+     * \return false if there are none for its sample depth
+     */
+    bool SelectDebayer();
+
+    /*!
+     * \brief Encoder for 10 bit exports
+     * \return `EXPORT_CODEC_ID` if its encoder takes `DEEP_EXPORT_PIXELFORMAT`,
+     *         `DEEP_FALLBACK_CODEC_ID` otherwise
+     */
+    static AVCodecID DeepCodecId();
+
+    /*!
+     * \brief Free the debayer frames
+     */
+    void FreeDebayer();
+
     /*!
      * \brief Initialise all filter members
      * \param frame The source frame to filter from
@@ -255,6 +579,7 @@ class ZeitEngine : public QObject
      * \param target_width Target frame width
      * \param target_height Target frame height
      * \param target_pixel_format Target frame pixel format
+     * \param flags Scaling algorithm, see `SWS_BILINEAR` etc.
      * \sa ScaleFrame
      *
      * Don't call this yourself, `ScaleFrame()` automatically calls this the
@@ -264,7 +589,8 @@ class ZeitEngine : public QObject
     void InitScaler(AVFrame *frame,
                     const unsigned int target_width,
                     const unsigned int target_height,
-                    const AVPixelFormat target_pixel_format);
+                    const AVPixelFormat target_pixel_format,
+                    const int flags = SWS_BILINEAR);
 
     /*!
      * \brief Scale the currently loaded decoder frame
@@ -272,6 +598,7 @@ class ZeitEngine : public QObject
      * \param target_width Target frame width
      * \param target_height Target frame height
      * \param target_pixel_format Target frame pixel format
+     * \param flags Scaling algorithm, see `SWS_BILINEAR` etc.
      *
      * Provide your source frame and the target format, scaling results go into
      * scaler_frame! Use `FreeScaler()` to clean up after your function that
@@ -280,7 +607,8 @@ class ZeitEngine : public QObject
     void ScaleFrame(AVFrame *frame,
                    const unsigned int target_width,
                    const unsigned int target_height,
-                   const AVPixelFormat target_pixel_format);
+                   const AVPixelFormat target_pixel_format,
+                   const int flags = SWS_BILINEAR);
 
     /*!
      * \brief Free all allocated scaler members
@@ -295,6 +623,7 @@ class ZeitEngine : public QObject
      * \param target_width Target frame width
      * \param target_height Target frame height
      * \param target_pixel_format Target frame pixel format
+     * \param flags Scaling algorithm, see `SWS_BILINEAR` etc.
      * \sa RescaleFrame
      *
      * Don't call this yourself, `RescaleFrame()` automatically calls this the
@@ -304,7 +633,8 @@ class ZeitEngine : public QObject
     void InitRescaler(AVFrame *frame,
                       const unsigned int target_width,
                       const unsigned int target_height,
-                      const AVPixelFormat target_pixel_format);
+                      const AVPixelFormat target_pixel_format,
+                      const int flags = SWS_BILINEAR);
 
     /*!
      * \brief Rescale the currently loaded decoder frame
@@ -312,6 +642,7 @@ class ZeitEngine : public QObject
      * \param target_width Target frame width
      * \param target_height Target frame height
      * \param target_pixel_format Target frame pixel format
+     * \param flags Scaling algorithm, see `SWS_BILINEAR` etc.
      *
      * Provide your source frame and the target format, rescaling results go into
      * rescaler_frame! Use `FreeRescaler()` to clean up after your function that
@@ -320,7 +651,8 @@ class ZeitEngine : public QObject
     void RescaleFrame(AVFrame *frame,
                       const unsigned int target_width,
                       const unsigned int target_height,
-                      const AVPixelFormat target_pixel_format);
+                      const AVPixelFormat target_pixel_format,
+                      const int flags = SWS_BILINEAR);
 
     /*!
      * \brief Free all allocated rescaler members
@@ -331,30 +663,151 @@ class ZeitEngine : public QObject
 
     /*!
      * \brief Initalize the encoder
+     * \param encoder The rendition to encode for
      * \param frame Pointer to the frame that shall be encoded
      * \param output_file The path of the output file to be created
      * \sa ExportFrame
      *
      * Initializes all members of the encoder to a configuration that fits the
-     * passed frame for encoding; Opens the file for output to disk.
+     * passed frame and the rendition's profile; Opens the file for output to disk.
      */
-    void InitExporter(AVFrame* frame, const QFileInfo output_file);
+    void InitExporter(ExportEncoder* encoder, AVFrame* frame, const QFileInfo output_file);
 
     /*!
      * \brief Encode current frame to video file on disk
+     * \param encoder The rendition to encode for
      * \param frame Pointer to the frame that shall be encoded or NULL to write delayed frames
      * \param output_file The path of the output file to be created
+     * \param pts Presentation timestamp of the frame, in frames
      *
      * \return true if an actual frame was sent to the encoder or a delayed frame was written
      */
-    bool ExportFrame(AVFrame *frame, const QFileInfo output_file);
+    bool ExportFrame(ExportEncoder* encoder, AVFrame *frame, const QFileInfo output_file, const int64_t pts);
 
     /*!
      * \brief Free all encoder members
      *
-     * Free all encoder members
+     * Free all encoder members of the rendition, its scaler is kept
+     */
+    void CloseExport(ExportEncoder* encoder);
+
+    /*!
+     * \brief Finish the segment being exported
+     * \param encoder The rendition whose `segment_file` is finished
+     * \param drain Write the frames buffered in the encoder, or drop them
      */
-    void CloseExport();
+    void CloseSegment(ExportEncoder* encoder, const bool drain);
+
+    /*!
+     * \brief Size of a frame downscaled to a video height, aspect preserved
+     * \param max_height Height of the video, 0 or above the frame's to keep its size
+     * \param rotate_90d_cw The video is rotated, so its height is the frame's width
+     * \param target_width Receives the width, even
+     * \param target_height Receives the height, even
+     * \return false if the frame keeps its size
+     */
+    static bool FitHeight(const int width,
+                          const int height,
+                          const unsigned int max_height,
+                          const bool rotate_90d_cw,
+                          int* target_width,
+                          int* target_height);
+
+    /*!
+     * \brief Downscale an export frame to a rendition's size
+     * \param frame Frame in `export_pixel_format` at the source size
+     * \return The frame itself if the rendition is not smaller than the source
+     */
+    AVFrame* RenditionFrame(ExportEncoder* encoder, AVFrame* frame);
+
+    /*!
+     * \brief Free the rendition's scaler
+     */
+    void FreeRenditionScaler(ExportEncoder* encoder);
+
+    /*!
+     * \brief Scale, orient and encode a frame for one rendition, on any thread
+     *
+     * Errors are kept in the encoder's `failure_message` and `failure_code`,
+     * for `EncodeRenditions()` to throw on its own thread.
+     */
+    void EncodeRendition(ExportEncoder* encoder, AVFrame* frame, const int64_t pts);
+
+    /*!
+     * \brief Split the `encoder_threads` budget between the pools and the
+     *        encoders of an export
+     * \param renditions Number of renditions, each with an encoder of its own
+     *
+     * Sizes `band_pool` and `rendition_pool` and sets
+     * `rendition_encoder_threads`, so all of them together stay within the
+     * budget; applies to encoders opened afterwards.
+     */
+    void BudgetThreads(const int renditions);
+
+    /*!
+     * \brief Encode a frame for all renditions in parallel
+     * \param frame Frame in `export_pixel_format` at the source size, shared by all renditions
+     * \param segment Renditions that took this segment over from an earlier run skip the frame
+     *
+     * Every rendition scales, orients and encodes on a thread of its own,
+     * the first one on the calling thread, so a frame takes as long as the
+     * slowest rendition rather than all of them. Returns once all are done,
+     * with their timings moved to `stats`.
+     */
+    void EncodeRenditions(const QList<ExportEncoder*>& encoders, AVFrame* frame, const int segment, const int64_t pts);
+
+    /*!
+     * \brief Identify the sequence and settings an export journal belongs to
+     */
+    QByteArray JournalKey(const ExportRendition& rendition);
+
+    /*!
+     * \brief Pick up the segments of an interrupted export
+     * \param encoder The rendition, receives the files of the usable segments in order
+     * \return Number of segments that need not be exported again
+     *
+     * Starts a new journal (and drops leftover segments) in the rendition's
+     * `segment_dir` if there is none for the current sequence and settings.
+     * Segments are only taken over while they hold as many packets as the
+     * journal says, the first one cut short by a crash and all following
+     * are exported again.
+     */
+    int ResumeJournal(ExportEncoder* encoder);
+
+    /*!
+     * \brief Note a completed segment in the rendition's journal
+     * \param file_name File of the segment, empty if not a single frame was decodable
+     * \param packets Packets written to the segment
+     *
+     * The segment is on disk before its entry is written, and the entry
+     * before this returns, so a power loss never leaves an entry for a
+     * segment that is not complete.
+     */
+    void AppendJournal(ExportEncoder* encoder, const int segment, const QString file_name, const int packets);
+
+    /*!
+     * \brief Count the packets of a segment
+     * \return -1 if the segment cannot be read
+     */
+    int CountPackets(const QString& file);
+
+    /*!
+     * \brief Join segments into the output file without encoding them again
+     * \param segments Files of the segments, in order
+     * \param output_file The file to create
+     */
+    void StitchSegments(const QStringList& segments, const QFileInfo output_file);
+
+    /*!
+     * \brief Throw if `stop_flag` is set, cancelling the running export
+     */
+    void CheckStop();
+
+    /*!
+     * \brief Emit `StatsUpdated()` with a summary of the stage timings
+     * \param force Report even if the last report is less than `STATS_INTERVAL` ago
+     */
+    void ReportStats(const bool force);
 
     /*!
      * \brief Sleep for x msec
@@ -382,6 +835,34 @@ public:
      */
     bool stop_flag;
 
+    /*!
+     * \brief Used for signaling the ZeitEngine to pause playback, see `Pause()`
+     */
+    bool pause_flag;
+
+    /*!
+     * \brief Used to configure the direction of playback
+     */
+    ZeitPlayback playback_flag;
+
+    /*!
+     * \brief Used to configure the playback speed, from 0.25 to 8 times the framerate
+     *
+     * Beyond 1x frames are skipped rather than all decoded, below 1x frames
+     * are held on display for several frame times.
+     */
+    float speed_flag;
+
+    /*!
+     * \brief Pending seek target, -1 if none, see `Seek()`
+     */
+    int seek_flag;
+
+    /*!
+     * \brief Pending relative step in frames, see `Step()`
+     */
+    int step_flag;
+
     /*!
      * \brief Used for signaling the ZeitEngine to x-flip the footage
      */
@@ -408,40 +889,136 @@ public:
      */
     ZeitRate configured_framerate;
 
+    /*!
+     * \brief Used to configure the encoder settings of exports
+     */
+    ZeitProfile profile_flag;
+
+    /*!
+     * \brief Used to configure how many threads an export may use besides
+     *        the engine's, for all its encoders and pools together; 0 for
+     *        as many as there are cores
+     */
+    int encoder_threads;
+
+    /*!
+     * \brief Used to configure whether a cancelled export is finalized into a
+     *        playable (shorter) video instead of being removed
+     */
+    bool keep_partial_flag;
+
+    /*!
+     * \brief Used to configure the first sequence position to export
+     */
+    int export_in_flag;
+
+    /*!
+     * \brief Used to configure the last sequence position to export, -1 for the end of the sequence
+     */
+    int export_out_flag;
+
+    /*!
+     * \brief Used to configure exporting only every n-th frame of the range, 1 for all frames
+     */
+    int export_stride_flag;
+
+    /*!
+     * \brief Used to configure the height of exported videos, see `ZeitResolution`
+     *
+     * Frames are downscaled (area averaged, aspect preserved) right after
+     * decoding, so filter and encoder work on the smaller frame; never upscaled.
+     */
+    unsigned int export_height_flag;
+
+    /*!
+     * \brief Used to configure the sample depth of exported videos, see `ZeitDepth`
+     *
+     * 10 bit exports of ZD footage are debayered and filtered at high
+     * precision; they need .mkv or .mov files if the encoder falls back to
+     * FFV1, see `DeepCodecId()`. Previews always stay 8 bit.
+     */
+    ZeitDepth export_depth_flag;
+
+    /*!
+     * \brief Used to configure the scaling algorithm of previews, see `SWS_FAST_BILINEAR` etc.
+     *
+     * Takes effect when the display is configured next, e.g. on loading footage.
+     */
+    int preview_scaler_flag;
+
+    /*!
+     * \brief Used to configure the scaling algorithm of exports, see `ScalerFlags()`
+     */
+    int export_scaler_flag;
+
+    /*!
+     * \brief Used to configure whether `preview_scaler_flag` is measured for
+     *        each new display geometry, see `CalibrateScaler()`
+     */
+    bool calibrate_scaler_flag;
+
     /*!
      * \brief Initialize the ZeitEngine
-     * \param video_widget The display widget context to output to
+     * \param sink Receives the frames to display
+     * \param display_max_width Largest width frames are displayed at
+     * \param display_max_height Largest height frames are displayed at
      *
      * Internally store references to the images to be processed, and decode
      * the first image of the sequence to initialize the codec, file format,
      * pixel format, width, height, linesize, etc.
      */
-    explicit ZeitEngine(GLVideoWidget* video_widget, QObject *parent = 0);
+    ZeitEngine(FrameSink* sink,
+               const unsigned int display_max_width,
+               const unsigned int display_max_height,
+               QObject *parent = 0);
 
     /*!
      * \brief Free the engine
      */
     ~ZeitEngine();
 
+    /*!
+     * \brief List the supported footage of a folder in playback order
+     * \param directory The folder to search
+     * \return Non-empty .jpg/.jpeg/.png/.zd files, naturally sorted by name
+     */
+    static QFileInfoList FindSequence(const QDir& directory);
+
+    /*!
+     * \brief Number of frames an export of a range produces
+     * \param length Number of frames in the sequence
+     * \param in First position, see `export_in_flag`
+     * \param out Last position or -1, see `export_out_flag`
+     * \param stride See `export_stride_flag`
+     */
+    static int ExportLength(const int length, const int in, const int out, const int stride);
+
+    /*!
+     * \brief Open passed footage without playing it
+     * \return false if not a single frame of the sequence could be decoded
+     */
+    bool Open(const QFileInfoList& sequence);
+
 signals:
     void VideoConfigurationUpdated(const unsigned int width, const unsigned int height, const QImage::Format pixel_format);
     void VideoUpdated();
     void ControlsEnabled(const bool lock);
     void MessageUpdated(const QString text);
     void ProgressUpdated(const QString text, const int current, const int total);
+    void PositionUpdated(const int position, const int length);
+    void StatsUpdated(const PipelineSummary summary);
 public slots:
 
     /*!
-     * \brief Load passed footage
-     *
-     *
+     * \brief Open passed footage and start playing it
      */
     void Load(const QFileInfoList& sequence);
 
     /*!
-     * \brief Build the in-memory video cache
+     * \brief Build the in-memory proxy cache
      *
-     * Decodes and cheaply re-encodes all frames to the in-memory video cache
+     * Decodes frames spread evenly over the sequence into the proxy cache, as
+     * many as fit, so scrubbing can show a stand-in frame everywhere
      */
     void Cache();
 
@@ -453,9 +1030,11 @@ public slots:
     void Refresh();
 
     /*!
-     * \brief Start continuous playback, adhering to loop_flag and stop_flag
+     * \brief Start continuous playback, adhering to loop_flag, stop_flag and pause_flag
      *
-     * Start continuous playback, adhering to loop_flag and stop_flag
+     * Playback continues next to the frame on display, in the direction and
+     * at the speed configured through `playback_flag` and `speed_flag`.
+     * Stopping rewinds to the first frame, pausing keeps the position.
      */
     void Play();
 
@@ -463,8 +1042,70 @@ public slots:
      * \brief Export the sequence from source to a video file with high quality
      * \param The file to export to
      * \return true in case of success, false in case of failure
+     *
+     * Only the frames selected through `export_in_flag`, `export_out_flag`
+     * and `export_stride_flag` are decoded, so the export takes as long as
+     * the video it produces rather than the whole sequence. They are exported
+     * at `export_height_flag`.
+     *
+     * The video is encoded in segments of `SEGMENT_FRAMES` frames, each
+     * noted in a journal once complete, and stitched into the file at the
+     * end. Exporting the same sequence with the same settings to the same
+     * file after a crash or failure resumes after the last complete segment.
+     *
+     * Setting `stop_flag` cancels the export before its next stage. The
+     * frames encoded so far are then either stitched into a shorter video
+     * or dropped, see `keep_partial_flag`.
+     */
+    bool Export(const QFileInfo file);
+
+    /*!
+     * \brief Export the sequence to several videos in a single pass
+     * \param renditions The videos to produce, with distinct files
+     * \return true if all of them were exported
+     *
+     * Every frame is decoded, debayered and filtered once and then handed to
+     * each rendition, which downscales it and encodes it on its own encoder.
+     * Renditions are journaled and resumed independently; otherwise like
+     * `Export()`, whose `profile_flag` is replaced by each rendition's profile.
+     */
+    bool ExportRenditions(const QList<ExportRendition>& renditions);
+
+    /*!
+     * \brief Pause playback, keeping the position
+     *
+     * Thread-safe, meant to be called (or connected) directly rather than
+     * queued, since the engine thread is busy while playing. `Play()` resumes
+     * after the paused frame.
+     */
+    void Pause();
+
+    /*!
+     * \brief Jump to a frame position
+     * \param position The frame to show
+     *
+     * Thread-safe, meant to be called (or connected) directly rather than
+     * queued. During playback the position is taken over by the playback
+     * loop. Otherwise a nearby cached or proxy frame is shown immediately and
+     * then refined to the exact frame; requests arriving in the meantime (e.g.
+     * while scrubbing) are coalesced so only the newest one gets decoded.
+     */
+    void Seek(const int position);
+
+    /*!
+     * \brief Move the position by a number of frames
+     * \param frames Frames to move, negative to step backwards
+     *
+     * Thread-safe like `Seek()`, steps add up until they are served.
+     */
+    void Step(const int frames);
+
+private slots:
+
+    /*!
+     * \brief Serve pending `Seek()` and `Step()` requests while not playing
      */
-    void Export(const QFileInfo file);
+    void ServeSeek();
 
 };
 
@@ -0,0 +1,100 @@
+#include <QCommandLineParser>
+#include <QGuiApplication>
+
+#include <cstdio>
+
+#include "sequencegenerator.h"
+
+int main(int argc, char *argv[])
+{
+    // Images are only written, never shown
+    if(qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+
+    QGuiApplication application(argc, argv);
+    application.setApplicationName("zdgen");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Writes deterministic synthetic ZD, JPEG and PNG sequences");
+    parser.addHelpOption();
+    parser.addPositionalArgument("directory", "Directory to write the sequence to.");
+
+    QCommandLineOption format_option("format", "zd, jpg or png.", "format", "zd");
+    QCommandLineOption count_option("count", "Number of frames.", "count", "24");
+    QCommandLineOption first_option("first", "Index of the first frame.", "index", "0");
+    QCommandLineOption seed_option("seed", "Seed of the patterns.", "seed", "1");
+    QCommandLineOption pattern_option("pattern", "Comma separated gradient, noise, edges, flicker.", "patterns", "gradient,edges,noise");
+    QCommandLineOption size_option("size", "Size of JPEG/PNG frames, ZD frames are always 1944x1944.", "WxH", "1944x1944");
+    QCommandLineOption quality_option("quality", "JPEG quality.", "quality", "90");
+    QCommandLineOption prefix_option("prefix", "Start of every file name.", "prefix", "frame");
+    QCommandLineOption describe_option("describe", "Describe ZD frames in a zdinfo.txt sidecar and a header in every frame.");
+
+    parser.addOption(format_option);
+    parser.addOption(count_option);
+    parser.addOption(first_option);
+    parser.addOption(seed_option);
+    parser.addOption(pattern_option);
+    parser.addOption(size_option);
+    parser.addOption(quality_option);
+    parser.addOption(prefix_option);
+    parser.addOption(describe_option);
+    parser.process(application);
+
+    if(parser.positionalArguments().size() != 1) {
+        parser.showHelp(1);
+    }
+
+    const QString format = parser.value(format_option).toLower();
+    const int patterns = SequenceGenerator::ParsePatterns(parser.value(pattern_option));
+    const QStringList size = parser.value(size_option).split('x');
+
+    if(format != "zd" && format != "jpg" && format != "png") {
+        std::fprintf(stderr, "Unknown format %s\n", format.toUtf8().constData());
+        return 1;
+    }
+
+    if(patterns == 0) {
+        std::fprintf(stderr, "Unknown pattern in %s\n", parser.value(pattern_option).toUtf8().constData());
+        return 1;
+    }
+
+    if(size.size() != 2 || size[0].toInt() <= 0 || size[1].toInt() <= 0) {
+        std::fprintf(stderr, "Invalid size %s\n", parser.value(size_option).toUtf8().constData());
+        return 1;
+    }
+
+    QDir directory(parser.positionalArguments().first());
+
+    if(!directory.mkpath(".")) {
+        std::fprintf(stderr, "Could not create %s\n", directory.path().toUtf8().constData());
+        return 1;
+    }
+
+    SequenceGenerator generator(parser.value(seed_option).toUInt(), patterns);
+    generator.SetSize(size[0].toInt(), size[1].toInt());
+    generator.SetDescribed(parser.isSet(describe_option));
+
+    const int first = parser.value(first_option).toInt();
+    const int count = parser.value(count_option).toInt();
+
+    // One frame at a time, so progress shows on long runs
+    for(int index = first; index < first + count; index++) {
+        if(generator.WriteSequence(directory,
+                                   parser.value(prefix_option),
+                                   format,
+                                   index,
+                                   1,
+                                   parser.value(quality_option).toInt()).isEmpty()) {
+            std::fprintf(stderr, "Could not write frame %d\n", index);
+            return 1;
+        }
+
+        std::printf("\r%d/%d", index - first + 1, count);
+        std::fflush(stdout);
+    }
+
+    std::printf("\n");
+
+    return 0;
+}
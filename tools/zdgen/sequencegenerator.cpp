@@ -0,0 +1,241 @@
+#include "sequencegenerator.h"
+
+#include <QDateTime>
+#include <QFile>
+#include <QStringList>
+#include <QtEndian>
+
+#include <algorithm>
+
+SequenceGenerator::SequenceGenerator(const quint32 seed, const int patterns)
+{
+    this->seed = seed;
+    this->patterns = patterns;
+
+    width = ZD_SIZE;
+    height = ZD_SIZE;
+    described = false;
+}
+
+void SequenceGenerator::SetDescribed(const bool described)
+{
+    this->described = described;
+}
+
+void SequenceGenerator::SetSize(const int width, const int height)
+{
+    this->width = width;
+    this->height = height;
+}
+
+quint32 SequenceGenerator::Hash(const quint32 a, const quint32 b, const quint32 c) const
+{
+    // Murmur3 style finalizer over the mixed inputs
+    quint32 h = seed ^ (a * 0x9e3779b1u) ^ (b * 0x85ebca77u) ^ (c * 0xc2b2ae3du);
+
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+
+    return h;
+}
+
+int SequenceGenerator::Sample(const int index, const int x, const int y, const int channel) const
+{
+    // Coordinates normalized to the ZD frame, so all sizes show the same scene
+    const int u = x * ZD_SIZE / width;
+    const int v = y * ZD_SIZE / height;
+
+    int value = MAX_VALUE / 2;
+
+    if(patterns & ZEIT_PATTERN_GRADIENT) {
+        const int drift = index * 8;
+
+        switch(channel) {
+        case 0:
+            value = (u + drift) % ZD_SIZE * MAX_VALUE / ZD_SIZE;
+            break;
+        case 1:
+            value = v * MAX_VALUE / ZD_SIZE;
+            break;
+        default:
+            value = (2 * ZD_SIZE - u - v + drift) % ZD_SIZE * MAX_VALUE / ZD_SIZE;
+            break;
+        }
+    }
+
+    if(patterns & ZEIT_PATTERN_EDGES) {
+        // Bars with hard edges moving right, a fixed diagonal edge below
+        const int bar = (u + index * 24) / 96;
+
+        if(v < ZD_SIZE / 2) {
+            value = (bar % 2 == 0) ? MAX_VALUE * 7 / 8 : MAX_VALUE / 16;
+        } else if(u > v - ZD_SIZE / 2) {
+            value = MAX_VALUE - value / 2;
+        }
+    }
+
+    if(patterns & ZEIT_PATTERN_FLICKER) {
+        // Exposure varying between 60% and 100% from frame to frame
+        const int exposure = 60 + Hash(index, 0xf11c, 0) % 41;
+        value = value * exposure / 100;
+    }
+
+    if(patterns & ZEIT_PATTERN_NOISE) {
+        const int noise = Hash(index, y * width + x, channel) % 4096;
+
+        if(patterns == ZEIT_PATTERN_NOISE) {
+            value = noise;
+        } else {
+            value += (noise - 2048) / 32;
+        }
+    }
+
+    return std::min(std::max(value, 0), (int)MAX_VALUE);
+}
+
+void SequenceGenerator::RenderZD(const int index, QVector<quint16>* samples) const
+{
+    SequenceGenerator zd(*this);
+    zd.SetSize(ZD_SIZE, ZD_SIZE);
+
+    samples->resize(ZD_SIZE * ZD_SIZE);
+    quint16* data = samples->data();
+
+    for(int y = 0; y < ZD_SIZE; y++) {
+        for(int x = 0; x < ZD_SIZE; x++) {
+            // GRBG mosaic: G R on even rows, B G on odd rows
+            int channel;
+
+            if(y % 2 == 0) {
+                channel = (x % 2 == 0) ? 1 : 0;
+            } else {
+                channel = (x % 2 == 0) ? 2 : 1;
+            }
+
+            data[y * ZD_SIZE + x] = qToLittleEndian((quint16)zd.Sample(index, x, y, channel));
+        }
+    }
+}
+
+QImage SequenceGenerator::RenderImage(const int index) const
+{
+    QImage image(width, height, QImage::Format_RGB32);
+
+    for(int y = 0; y < height; y++) {
+        QRgb* line = (QRgb*)image.scanLine(y);
+
+        for(int x = 0; x < width; x++) {
+            line[x] = qRgb(Sample(index, x, y, 0) >> 4,
+                           Sample(index, x, y, 1) >> 4,
+                           Sample(index, x, y, 2) >> 4);
+        }
+    }
+
+    return image;
+}
+
+QFileInfoList SequenceGenerator::WriteSequence(const QDir& directory,
+                                               const QString& prefix,
+                                               const QString& format,
+                                               const int first,
+                                               const int count,
+                                               const int quality) const
+{
+    QFileInfoList sequence;
+    QVector<quint16> samples;
+
+    if(format == "zd" && described) {
+        QFile sidecar(directory.filePath("zdinfo.txt"));
+        const QByteArray description = QString("# zdgen seed %1\n"
+                                               "width=%2\n"
+                                               "height=%2\n"
+                                               "pattern=GRBG\n"
+                                               "bits=12\n"
+                                               "black_level=0\n"
+                                               "white_level=%3\n")
+                                       .arg(seed)
+                                       .arg(ZD_SIZE)
+                                       .arg(MAX_VALUE)
+                                       .toUtf8();
+
+        if(!sidecar.open(QIODevice::WriteOnly | QIODevice::Truncate) || sidecar.write(description) < 0) {
+            return QFileInfoList();
+        }
+    }
+
+    for(int index = first; index < first + count; index++) {
+        // Zero padded, so even 100k frame folders sort correctly by name
+        QString path = directory.filePath(QString("%1_%2.%3")
+                                          .arg(prefix)
+                                          .arg(index, 6, 10, QChar('0'))
+                                          .arg(format));
+
+        if(format == "zd") {
+            RenderZD(index, &samples);
+
+            QFile file(path);
+
+            if(!file.open(QIODevice::WriteOnly)) {
+                return QFileInfoList();
+            }
+
+            if(described) {
+                // Fixed capture times, one frame a second, keep the files identical across runs
+                const QDateTime captured = QDateTime(QDate(2017, 9, 1), QTime(12, 0), Qt::UTC).addSecs(index);
+                QByteArray header("ZDHD");
+
+                for(int shift = 0; shift < 32; shift += 8) {
+                    header.append((char)((HEADER_SIZE >> shift) & 0xff));
+                }
+
+                header.append(QString("# zdgen frame %1\ntimestamp=%2\n")
+                              .arg(index)
+                              .arg(captured.toString(Qt::ISODate))
+                              .toUtf8());
+                header.append(QByteArray(HEADER_SIZE - header.size(), '\0'));
+
+                if(file.write(header) < 0) {
+                    return QFileInfoList();
+                }
+            }
+
+            if(file.write((const char*)samples.constData(), samples.size() * sizeof(quint16)) < 0) {
+                return QFileInfoList();
+            }
+        } else {
+            if(!RenderImage(index).save(path, format.toLatin1().constData(), quality)) {
+                return QFileInfoList();
+            }
+        }
+
+        sequence.append(QFileInfo(path));
+    }
+
+    return sequence;
+}
+
+int SequenceGenerator::ParsePatterns(const QString& names)
+{
+    int patterns = 0;
+
+    for(const QString& name : names.split(',', QString::SkipEmptyParts)) {
+        const QString pattern = name.trimmed().toLower();
+
+        if(pattern == "gradient") {
+            patterns |= ZEIT_PATTERN_GRADIENT;
+        } else if(pattern == "noise") {
+            patterns |= ZEIT_PATTERN_NOISE;
+        } else if(pattern == "edges") {
+            patterns |= ZEIT_PATTERN_EDGES;
+        } else if(pattern == "flicker") {
+            patterns |= ZEIT_PATTERN_FLICKER;
+        } else {
+            return 0;
+        }
+    }
+
+    return patterns;
+}
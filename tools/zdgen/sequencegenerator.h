@@ -0,0 +1,115 @@
+#ifndef SEQUENCEGENERATOR_H
+#define SEQUENCEGENERATOR_H
+
+/** \file
+ * SequenceGenerator header
+ * Declares the `SequenceGenerator` class, writing synthetic footage
+ */
+
+#include <QDir>
+#include <QFileInfoList>
+#include <QImage>
+#include <QString>
+#include <QVector>
+
+/*!
+ * \brief Identifies the patterns a synthetic sequence is composed of
+ *
+ * Patterns are flags and can be combined.
+ */
+enum ZeitPattern {
+    ZEIT_PATTERN_GRADIENT = 0x1,    //!< Colour gradients, slowly drifting
+    ZEIT_PATTERN_NOISE = 0x2,       //!< Per pixel noise, sensor like on top of other patterns
+    ZEIT_PATTERN_EDGES = 0x4,       //!< Hard edged bars moving across the frame
+    ZEIT_PATTERN_FLICKER = 0x8      //!< Brightness changing from frame to frame
+};
+
+/*!
+ * \brief Writes deterministic synthetic ZD, JPEG and PNG sequences
+ *
+ * Every sample is a pure function of the seed, the patterns, the frame
+ * index and the position in the frame, so any frame of a sequence can be
+ * (re)generated on its own and the same arguments always give identical
+ * files on every machine.
+ */
+class SequenceGenerator
+{
+    const static int ZD_SIZE = 1944;        //!< ZD frames are always 1944x1944
+    const static int MAX_VALUE = 4095;      //!< Samples are 12 bit
+    const static int HEADER_SIZE = 256;     //!< Headers are padded to the same size in every frame
+
+    quint32 seed;
+    int patterns;
+    int width;
+    int height;
+    bool described;
+
+    /*!
+     * \brief Hash inputs to a well distributed 32 bit value
+     */
+    quint32 Hash(const quint32 a, const quint32 b, const quint32 c) const;
+
+    /*!
+     * \brief The 12 bit scene value of a channel at a position
+     * \param channel 0 for red, 1 for green, 2 for blue
+     */
+    int Sample(const int index, const int x, const int y, const int channel) const;
+
+public:
+    /*!
+     * \param seed Seed all patterns derive from
+     * \param patterns Combination of `ZeitPattern` flags
+     */
+    SequenceGenerator(const quint32 seed, const int patterns);
+
+    /*!
+     * \brief Set the size of image (not ZD) frames
+     */
+    void SetSize(const int width, const int height);
+
+    /*!
+     * \brief Describe ZD sequences in a `zdinfo.txt` sidecar and a `ZDHD`
+     *        header in front of every frame, as cameras other than the
+     *        original do
+     *
+     * The sidecar holds the geometry and levels, the headers the capture
+     * time. The samples stay the same as in bare frames.
+     */
+    void SetDescribed(const bool described);
+
+    /*!
+     * \brief Render frame `index` as a `bayer_grbg16le` ZD frame
+     * \param samples Receives 1944x1944 little endian 12 bit samples
+     */
+    void RenderZD(const int index, QVector<quint16>* samples) const;
+
+    /*!
+     * \brief Render frame `index` as an 8 bit image
+     */
+    QImage RenderImage(const int index) const;
+
+    /*!
+     * \brief Write a sequence of frames
+     * \param directory Directory to write to, must exist
+     * \param prefix Start of every file name
+     * \param format "zd", "jpg" or "png"
+     * \param first Index of the first frame, to extend existing sequences
+     * \param count Number of frames
+     * \param quality JPEG quality
+     * \return The written files, empty if any write failed
+     */
+    QFileInfoList WriteSequence(const QDir& directory,
+                                const QString& prefix,
+                                const QString& format,
+                                const int first,
+                                const int count,
+                                const int quality = 90) const;
+
+    /*!
+     * \brief Parse a comma separated list of pattern names
+     * \return Combination of `ZeitPattern` flags, 0 if a name is unknown
+     */
+    static int ParsePatterns(const QString& names);
+};
+
+#endif // SEQUENCEGENERATOR_H
@@ -0,0 +1,7 @@
+# Synthetic sequence generator, shared by zdgen and the benchmarks
+
+INCLUDEPATH += $$PWD
+
+HEADERS  += $$PWD/sequencegenerator.h
+
+SOURCES +=  $$PWD/sequencegenerator.cpp
@@ -0,0 +1,15 @@
+# zdgen, writes synthetic ZD/JPEG/PNG sequences
+
+QT += core      \
+      gui
+
+TARGET = zdgen
+
+TEMPLATE = app
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+include(sequencegenerator.pri)
+
+SOURCES +=  main.cpp